@@ -0,0 +1,100 @@
+#include "anel_lotes.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+// Voltas de espera ativa antes de dormir: o outro lado costuma liberar um lote em poucos
+// microssegundos, bem menos que o custo de ir ao kernel
+#define VOLTAS_ANTES_DE_DORMIR 256
+
+static void pausar(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static void dormir(atomic_uint *sinal, unsigned valor) {
+    syscall(SYS_futex, (unsigned *)sinal, FUTEX_WAIT_PRIVATE, valor, NULL, NULL, 0);
+}
+
+static void acordar(atomic_uint *sinal) {
+    atomic_fetch_add(sinal, 1);
+    syscall(SYS_futex, (unsigned *)sinal, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+int iniciar_anel_lotes(AnelLotes *anel, unsigned capacidade, size_t tamanho_lote) {
+    unsigned potencia = 1;
+    while (potencia < capacidade) potencia *= 2;
+    // Cada lote alinhado a linha de cache: os dois lados nunca escrevem na mesma linha
+    tamanho_lote = (tamanho_lote + 63) & ~(size_t)63;
+    anel->lotes = aligned_alloc(64, (size_t)potencia * tamanho_lote);
+    if (!anel->lotes) return -1;
+    anel->capacidade = potencia;
+    anel->tamanho_lote = tamanho_lote;
+    atomic_init(&anel->publicados, 0);
+    atomic_init(&anel->devolvidos, 0);
+    atomic_init(&anel->sinal_produtor, 0);
+    atomic_init(&anel->produtor_esperando, 0);
+    atomic_init(&anel->sinal_consumidor, 0);
+    atomic_init(&anel->consumidor_esperando, 0);
+    atomic_init(&anel->cancelado, 0);
+    return 0;
+}
+
+void liberar_anel_lotes(AnelLotes *anel) {
+    free(anel->lotes);
+    anel->lotes = NULL;
+}
+
+// Espera ate pronto() valer, o anel ser cancelado ou o outro lado dar sinal. O flag de
+// espera e ligado antes de conferir de novo: ou esta conferencia ve o contador novo, ou o
+// outro lado ve o flag e muda o sinal, e o futex nao dorme com o sinal diferente de valor
+#define ESPERAR(anel, pronto, sinal, esperando)                                  \
+    do {                                                                         \
+        for (int volta = 0; !(pronto); volta++) {                                \
+            if (atomic_load(&(anel)->cancelado)) return NULL;                    \
+            if (volta < VOLTAS_ANTES_DE_DORMIR) {                                \
+                pausar();                                                        \
+                continue;                                                        \
+            }                                                                    \
+            unsigned valor = atomic_load(&(anel)->sinal);                        \
+            atomic_store(&(anel)->esperando, 1);                                 \
+            if (!(pronto) && !atomic_load(&(anel)->cancelado)) {                 \
+                dormir(&(anel)->sinal, valor);                                   \
+            }                                                                    \
+            atomic_store(&(anel)->esperando, 0);                                 \
+        }                                                                        \
+        if (atomic_load(&(anel)->cancelado)) return NULL;                        \
+    } while (0)
+
+void *lote_para_escrever(AnelLotes *anel) {
+    unsigned publicados = atomic_load_explicit(&anel->publicados, memory_order_relaxed);
+    ESPERAR(anel, publicados - atomic_load(&anel->devolvidos) < anel->capacidade,
+            sinal_produtor, produtor_esperando);
+    return anel->lotes + (size_t)(publicados & (anel->capacidade - 1)) * anel->tamanho_lote;
+}
+
+void publicar_lote(AnelLotes *anel) {
+    atomic_fetch_add(&anel->publicados, 1);
+    if (atomic_load(&anel->consumidor_esperando)) acordar(&anel->sinal_consumidor);
+}
+
+void *lote_para_ler(AnelLotes *anel) {
+    unsigned devolvidos = atomic_load_explicit(&anel->devolvidos, memory_order_relaxed);
+    ESPERAR(anel, atomic_load(&anel->publicados) != devolvidos, sinal_consumidor, consumidor_esperando);
+    return anel->lotes + (size_t)(devolvidos & (anel->capacidade - 1)) * anel->tamanho_lote;
+}
+
+void devolver_lote(AnelLotes *anel) {
+    atomic_fetch_add(&anel->devolvidos, 1);
+    if (atomic_load(&anel->produtor_esperando)) acordar(&anel->sinal_produtor);
+}
+
+void cancelar_anel_lotes(AnelLotes *anel) {
+    atomic_store(&anel->cancelado, 1);
+    acordar(&anel->sinal_produtor);
+    acordar(&anel->sinal_consumidor);
+}
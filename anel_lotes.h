@@ -0,0 +1,42 @@
+#ifndef ANEL_LOTES_H
+#define ANEL_LOTES_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+// Fila circular sem trava entre uma thread produtora e uma consumidora (SPSC), com um
+// numero fixo de lotes de tamanho fixo alocados no inicio: a memoria nao cresce com o
+// tamanho da entrada. Cada lado so altera o seu contador, entao publicar e devolver sao
+// um store atomico. Com a fila cheia (ou vazia) o lado que espera gira um pouco e depois
+// dorme num futex, acordado pelo outro lado so quando ha alguem esperando
+typedef struct {
+    _Alignas(64) atomic_uint publicados;    // so o produtor altera
+    _Alignas(64) atomic_uint devolvidos;    // so o consumidor altera
+    _Alignas(64) atomic_uint sinal_produtor;
+    atomic_int produtor_esperando;
+    _Alignas(64) atomic_uint sinal_consumidor;
+    atomic_int consumidor_esperando;
+    atomic_int cancelado;
+    unsigned capacidade;                    // potencia de 2
+    size_t tamanho_lote;
+    char *lotes;
+} AnelLotes;
+
+// Retorna 0 ou -1 sem memoria
+int iniciar_anel_lotes(AnelLotes *anel, unsigned capacidade, size_t tamanho_lote);
+void liberar_anel_lotes(AnelLotes *anel);
+
+// Produtor: o proximo lote livre, esperando se a fila estiver cheia; NULL se cancelada.
+// O lote so fica visivel ao consumidor em publicar_lote
+void *lote_para_escrever(AnelLotes *anel);
+void publicar_lote(AnelLotes *anel);
+
+// Consumidor: o lote publicado mais antigo, esperando se nao houver; NULL se cancelada.
+// O lote continua valido ate devolver_lote
+void *lote_para_ler(AnelLotes *anel);
+void devolver_lote(AnelLotes *anel);
+
+// Acorda e libera os dois lados: daqui em diante as esperas retornam NULL
+void cancelar_anel_lotes(AnelLotes *anel);
+
+#endif
@@ -0,0 +1,69 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "memoria.h"
+
+#define TAMANHO_BLOCO_ARENA (64 * 1024)
+#define ALINHAMENTO_ARENA 16
+
+struct BlocoArena {
+    BlocoArena *proximo;
+    size_t tamanho;
+    _Alignas(ALINHAMENTO_ARENA) char dados[];
+};
+
+void iniciar_arena(Arena *arena) {
+    memset(arena, 0, sizeof(*arena));
+}
+
+void liberar_arena(Arena *arena) {
+    BlocoArena *bloco = arena->primeiro;
+    while (bloco) {
+        BlocoArena *proximo = bloco->proximo;
+        free(bloco);
+        bloco = proximo;
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+void reiniciar_arena(Arena *arena) {
+    arena->atual = NULL;
+    arena->livre = NULL;
+    arena->limite = NULL;
+}
+
+// Passa para o proximo bloco com espaco, reaproveitando os de compilacoes anteriores
+static void trocar_bloco(Arena *arena, size_t tamanho) {
+    BlocoArena *bloco = arena->atual ? arena->atual->proximo : arena->primeiro;
+    while (bloco && bloco->tamanho < tamanho) bloco = bloco->proximo;
+
+    if (!bloco) {
+        size_t tamanho_bloco = tamanho > TAMANHO_BLOCO_ARENA ? tamanho : TAMANHO_BLOCO_ARENA;
+        bloco = malloc(sizeof(BlocoArena) + tamanho_bloco);
+        if (!bloco) memoria_insuficiente();
+        bloco->tamanho = tamanho_bloco;
+        // Inserido logo depois do atual para manter a ordem de reuso
+        if (arena->atual) {
+            bloco->proximo = arena->atual->proximo;
+            arena->atual->proximo = bloco;
+        } else {
+            bloco->proximo = arena->primeiro;
+            arena->primeiro = bloco;
+        }
+    }
+
+    arena->atual = bloco;
+    arena->livre = bloco->dados;
+    arena->limite = bloco->dados + bloco->tamanho;
+}
+
+void *alocar_arena(Arena *arena, size_t tamanho) {
+    tamanho = (tamanho + ALINHAMENTO_ARENA - 1) & ~(size_t)(ALINHAMENTO_ARENA - 1);
+    if ((size_t)(arena->limite - arena->livre) < tamanho) trocar_bloco(arena, tamanho);
+    void *ptr = arena->livre;
+    arena->livre += tamanho;
+    memset(ptr, 0, tamanho);
+    return ptr;
+}
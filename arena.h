@@ -0,0 +1,23 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct BlocoArena BlocoArena;
+
+// Alocador por regiao: aloca avancando um ponteiro e libera tudo de uma vez.
+// reiniciar_arena mantem os blocos, entao a proxima compilacao nao chama malloc
+typedef struct {
+    BlocoArena *primeiro;
+    BlocoArena *atual;
+    char *livre;
+    char *limite;
+} Arena;
+
+void iniciar_arena(Arena *arena);
+void liberar_arena(Arena *arena);
+void reiniciar_arena(Arena *arena);
+// Memoria zerada, alinhada para qualquer tipo
+void *alocar_arena(Arena *arena, size_t tamanho);
+
+#endif
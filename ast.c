@@ -0,0 +1,75 @@
+#include "ast.h"
+
+NoAst *criar_no_ast(Arena *arena, TipoNo tipo, int linha) {
+    NoAst *no = alocar_arena(arena, sizeof(NoAst));
+    no->tipo = tipo;
+    no->linha = linha;
+    return no;
+}
+
+NoAst *criar_numero_ast(Arena *arena, int valor, int linha) {
+    NoAst *no = criar_no_ast(arena, NO_NUMERO, linha);
+    no->valor = valor;
+    return no;
+}
+
+NoAst *criar_variavel_ast(Arena *arena, int endereco, int linha) {
+    NoAst *no = criar_no_ast(arena, NO_VARIAVEL, linha);
+    no->endereco = endereco;
+    return no;
+}
+
+int profundidade_ast(const NoAst *no) {
+    if (!no) return 0;
+    if (no_binario(no->tipo)) return no->binario.profundidade;
+    if (no->tipo == NO_NAO) return no->unario.profundidade;
+    return 1;
+}
+
+NoAst *criar_binario_ast(Arena *arena, TipoNo tipo, NoAst *esquerda, NoAst *direita, int linha) {
+    NoAst *no = criar_no_ast(arena, tipo, linha);
+    no->binario.esquerda = esquerda;
+    no->binario.direita = direita;
+    int a = profundidade_ast(esquerda);
+    int b = profundidade_ast(direita);
+    if (tipo == NO_E || tipo == NO_OU) {
+        // Cada lado e testado e desempilhado antes do outro
+        no->binario.profundidade = a > b ? a : b;
+    } else if (no_ordem_trocavel(tipo)) {
+        no->binario.profundidade = a == b ? a + 1 : a > b ? a : b;
+    } else {
+        no->binario.profundidade = a > b + 1 ? a : b + 1;
+    }
+    return no;
+}
+
+NoAst *criar_unario_ast(Arena *arena, TipoNo tipo, NoAst *operando, int linha) {
+    NoAst *no = criar_no_ast(arena, tipo, linha);
+    no->unario.operando = operando;
+    no->unario.profundidade = profundidade_ast(operando);
+    return no;
+}
+
+NoAst *copiar_expressao_ast(Arena *arena, const NoAst *no) {
+    if (!no) return NULL;
+    NoAst *copia = criar_no_ast(arena, no->tipo, no->linha);
+    *copia = *no;
+    if (no->tipo == NO_NAO) {
+        copia->unario.operando = copiar_expressao_ast(arena, no->unario.operando);
+    } else if (no_binario(no->tipo)) {
+        copia->binario.esquerda = copiar_expressao_ast(arena, no->binario.esquerda);
+        copia->binario.direita = copiar_expressao_ast(arena, no->binario.direita);
+    }
+    return copia;
+}
+
+int expressao_pode_falhar(const NoAst *no) {
+    if (!no) return 0;
+    if (no->tipo == NO_NAO) return expressao_pode_falhar(no->unario.operando);
+    if (!no_binario(no->tipo)) return 0;
+    if ((no->tipo == NO_DIVISAO || no->tipo == NO_RESTO) &&
+        (!no->binario.direita || no->binario.direita->tipo != NO_NUMERO || no->binario.direita->valor == 0)) {
+        return 1;
+    }
+    return expressao_pode_falhar(no->binario.esquerda) || expressao_pode_falhar(no->binario.direita);
+}
@@ -0,0 +1,84 @@
+#ifndef AST_H
+#define AST_H
+
+#include "arena.h"
+
+// Nos da arvore sintatica; identificadores ja chegam resolvidos para enderecos
+typedef enum {
+    // Expressoes
+    NO_NUMERO, NO_VARIAVEL,
+    // Operadores binarios (campo binario): aritmeticos, comparacoes e logicos
+    NO_MULTIPLICACAO, NO_SOMA, NO_SUBTRACAO, NO_DIVISAO, NO_RESTO,
+    NO_IGUAL, NO_DIFERENTE, NO_MENOR, NO_MENOR_IGUAL, NO_MAIOR, NO_MAIOR_IGUAL,
+    NO_E, NO_OU,
+    // not (campo unario); o menos unario vira 0 - x e true/false, os numeros 1/0
+    NO_NAO,
+    // Comandos
+    NO_LEIA, NO_ESCREVA, NO_ATRIBUICAO, NO_PARA
+} TipoNo;
+
+static inline int no_binario(TipoNo tipo) {
+    return tipo >= NO_MULTIPLICACAO && tipo <= NO_OU;
+}
+
+static inline int no_comparacao(TipoNo tipo) {
+    return tipo >= NO_IGUAL && tipo <= NO_MAIOR_IGUAL;
+}
+
+// O operador aceita avaliar o operando da direita primeiro: +, *, = e <> trocando os
+// operandos, as demais comparacoes trocando para a espelhada (a < b e b > a).
+// - e div/mod ficam na ordem escrita; and/or decidem a ordem pelo curto-circuito
+static inline int no_ordem_trocavel(TipoNo tipo) {
+    return no_binario(tipo) && tipo != NO_SUBTRACAO && tipo != NO_DIVISAO && tipo != NO_RESTO &&
+           tipo != NO_E && tipo != NO_OU;
+}
+
+// and, or e not: o resultado e 0 ou 1 e o operando da direita do and/or so e avaliado
+// quando o da esquerda nao decide
+static inline int no_logico(TipoNo tipo) {
+    return tipo == NO_E || tipo == NO_OU || tipo == NO_NAO;
+}
+
+typedef struct NoAst NoAst;
+
+struct NoAst {
+    TipoNo tipo;
+    int linha;
+    NoAst *proximo;  // comando seguinte do bloco
+    union {
+        int valor;      // NO_NUMERO
+        int endereco;   // NO_VARIAVEL, NO_LEIA
+        // profundidade: posicoes da pilha de avaliacao que a expressao ocupa no pior
+        // momento, com os operandos na ordem de Sethi-Ullman (ver profundidade_ast)
+        struct { NoAst *esquerda, *direita; int profundidade; } binario;
+        struct { NoAst *operando; int profundidade; } unario;
+        struct { NoAst *valor; } escrita;
+        struct { int endereco; NoAst *valor; } atribuicao;
+        struct { int contador; NoAst *inicio, *limite, *corpo; } para;
+    };
+};
+
+typedef struct {
+    int num_variaveis;
+    NoAst *comandos;
+} ProgramaAst;
+
+NoAst *criar_no_ast(Arena *arena, TipoNo tipo, int linha);
+NoAst *criar_numero_ast(Arena *arena, int valor, int linha);
+NoAst *criar_variavel_ast(Arena *arena, int endereco, int linha);
+NoAst *criar_binario_ast(Arena *arena, TipoNo tipo, NoAst *esquerda, NoAst *direita, int linha);
+NoAst *criar_unario_ast(Arena *arena, TipoNo tipo, NoAst *operando, int linha);
+// Copia profunda: os passes reescrevem os nos no lugar, entao um no nunca tem dois pais
+NoAst *copiar_expressao_ast(Arena *arena, const NoAst *no);
+
+// Altura maxima da pilha ao avaliar a expressao: 1 para numeros e variaveis; num operador
+// aritmetico ou comparacao, o lado mais fundo vai primeiro quando a ordem pode ser trocada.
+// E calculada na criacao do no; um filho reescrito depois (por exemplo dobrado em numero)
+// so deixa a estimativa do pai maior, nunca o codigo errado
+int profundidade_ast(const NoAst *no);
+
+// div ou mod por algo que pode ser zero: a avaliacao pode parar a execucao com erro, entao a
+// expressao nao pode ser levada para um caminho que nunca a avaliaria nem descartada
+int expressao_pode_falhar(const NoAst *no);
+
+#endif
@@ -0,0 +1,256 @@
+// Benchmark do compilador por fase (lexico, analise, geracao e VM) em programas
+// sinteticos de 1 KB a 100 MB, com o resultado em JSON para comparar entre versoes.
+// O driver e incluido inteiro para que as fases possam ser chamadas separadamente
+#define main main_compiladorparte2
+#include "../compiladorparte2.c"
+#undef main
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include "gerador.h"
+
+// Cada tamanho repete ate processar pelo menos este volume, para medir entradas pequenas
+#define VOLUME_MINIMO (8u * 1024 * 1024)
+#define MAX_REPETICOES 2000
+
+typedef struct {
+    size_t bytes;
+    long linhas;
+    long tokens;
+    int instrucoes;
+    long long instrucoes_executadas;
+    int repeticoes;
+    double tempo_lexico;
+    double tempo_analise;
+    double tempo_geracao;
+    double tempo_vm;
+    long pico_rss_kb;
+} ResultadoBenchmark;
+
+static double agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// "1K", "64K", "100M" ou bytes
+static int ler_tamanho(const char *texto, size_t *bytes) {
+    char *fim;
+    unsigned long long valor = strtoull(texto, &fim, 10);
+    if (fim == texto) return -1;
+    if (*fim == 'K' || *fim == 'k') {
+        valor *= 1024;
+        fim++;
+    } else if (*fim == 'M' || *fim == 'm') {
+        valor *= 1024 * 1024;
+        fim++;
+    }
+    if (*fim != '\0' || valor == 0) return -1;
+    *bytes = (size_t)valor;
+    return 0;
+}
+
+// Entrada para os read do programa: um inteiro pequeno por leitura
+static FILE *criar_entrada_vm(long leituras) {
+    FILE *entrada = tmpfile();
+    if (!entrada) return NULL;
+    for (long i = 0; i < leituras; i++) {
+        fprintf(entrada, "%ld\n", i % 7 + 1);
+    }
+    rewind(entrada);
+    return entrada;
+}
+
+static int medir_tamanho(ContextoCompilador *ctx, const ParametrosGerador *parametros,
+                         ResultadoBenchmark *resultado) {
+    char *texto = NULL;
+    size_t tamanho = 0;
+    FILE *memoria = open_memstream(&texto, &tamanho);
+    ResumoGerador resumo;
+    if (!memoria || gerar_programa(memoria, parametros, &resumo) != 0 || fclose(memoria) != 0) {
+        fprintf(stderr, "Erro ao gerar o programa de %zu bytes\n", parametros->bytes_alvo);
+        return -1;
+    }
+
+    FILE *entrada = criar_entrada_vm(resumo.leituras);
+    FILE *descarte = fopen("/dev/null", "w");
+    if (!entrada || !descarte) {
+        fprintf(stderr, "Erro ao preparar a entrada da VM: %s\n", strerror(errno));
+        return -1;
+    }
+
+    memset(resultado, 0, sizeof(*resultado));
+    resultado->bytes = tamanho;
+    resultado->linhas = resumo.linhas;
+    resultado->repeticoes = tamanho >= VOLUME_MINIMO ? 1 : (int)(VOLUME_MINIMO / tamanho);
+    if (resultado->repeticoes > MAX_REPETICOES) resultado->repeticoes = MAX_REPETICOES;
+
+    // O buffer gerado faz o papel do arquivo mapeado
+    ctx->fonte.dados = texto;
+    ctx->fonte.tamanho = tamanho;
+    ctx->fonte.mapeado = 0;
+
+    int falhou = 0;
+    for (int r = 0; r < resultado->repeticoes && !falhou; r++) {
+        AnalisadorLexico lexico;
+        long tokens = 0;
+        double inicio = agora();
+        iniciar_analisador_lexico(&lexico, texto, tamanho);
+        while (proximo_token(&lexico).tipo != TOKEN_EOF) tokens++;
+        resultado->tempo_lexico += agora() - inicio;
+        resultado->tokens = tokens;
+
+        reiniciar_contexto(ctx);
+        inicio = agora();
+        if (setjmp(ctx->recuperacao_erro) != 0) {
+            falhou = 1;
+            break;
+        }
+        analisar_programa(ctx);
+        if (ctx->num_erros > 0) {
+            falhou = 1;
+            break;
+        }
+        double fim_analise = agora();
+        gerar_ir(&ctx->programa, &ctx->ir);
+        falhou = gerar_mepa_de_ir(&ctx->ir, &ctx->codigo, ctx->diagnosticos) != 0;
+        double fim_geracao = agora();
+        resultado->tempo_analise += fim_analise - inicio;
+        resultado->tempo_geracao += fim_geracao - fim_analise;
+        resultado->instrucoes = ctx->codigo.num_instrucoes;
+
+        ProgramaVM programa;
+        rewind(entrada);
+        inicio = agora();
+        if (!falhou && preparar_programa_vm(&programa, &ctx->codigo, ctx->diagnosticos) == 0) {
+            falhou = executar_programa_vm(&programa, entrada, descarte, &resultado->instrucoes_executadas) != 0;
+            liberar_programa_vm(&programa);
+        } else {
+            falhou = 1;
+        }
+        resultado->tempo_vm += agora() - inicio;
+    }
+    if (falhou) {
+        fprintf(stderr, "Erro: o programa gerado de %zu bytes nao compilou ou nao executou\n", tamanho);
+    }
+
+    // Os tamanhos crescem, entao o pico do processo ate aqui e o deste tamanho
+    struct rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+    resultado->pico_rss_kb = uso.ru_maxrss;
+
+    fclose(entrada);
+    fclose(descarte);
+    free(texto);
+    return falhou ? -1 : 0;
+}
+
+static void escrever_json(FILE *saida, const ParametrosGerador *parametros,
+                          const ResultadoBenchmark *resultados, int num_resultados) {
+    fprintf(saida, "{\n  \"semente\": %u,\n  \"percentual_comentarios\": %d,\n  \"resultados\": [\n",
+            parametros->semente, parametros->percentual_comentarios);
+    for (int i = 0; i < num_resultados; i++) {
+        const ResultadoBenchmark *r = &resultados[i];
+        double n = r->repeticoes;
+        fprintf(saida,
+                "    {\"bytes\": %zu, \"linhas\": %ld, \"tokens\": %ld, \"instrucoes\": %d, "
+                "\"instrucoes_executadas\": %lld, \"repeticoes\": %d,\n"
+                "     \"tempo_lexico_s\": %.6f, \"tempo_analise_s\": %.6f, \"tempo_geracao_s\": %.6f, "
+                "\"tempo_vm_s\": %.6f,\n"
+                "     \"tokens_por_s\": %.0f, \"linhas_por_s\": %.0f, \"instrucoes_por_s\": %.0f, "
+                "\"pico_rss_kb\": %ld}%s\n",
+                r->bytes, r->linhas, r->tokens, r->instrucoes, r->instrucoes_executadas, r->repeticoes,
+                r->tempo_lexico / n, r->tempo_analise / n, r->tempo_geracao / n, r->tempo_vm / n,
+                r->tokens * n / r->tempo_lexico, r->linhas * n / r->tempo_analise,
+                r->instrucoes * n / r->tempo_geracao, r->pico_rss_kb,
+                i + 1 < num_resultados ? "," : "");
+    }
+    fprintf(saida, "  ]\n}\n");
+}
+
+static void imprimir_uso_benchmark(const char *programa) {
+    fprintf(stderr, "Uso: %s [--tamanhos 1K,64K,...] [--semente N] [--comentarios P] [-o resultados.json]\n"
+                    "     %s --gerar <bytes> [--semente N] [--comentarios P]\n",
+            programa, programa);
+}
+
+int main(int argc, char *argv[]) {
+    static const char *const tamanhos_padrao = "1K,16K,256K,4M,32M,100M";
+    const char *tamanhos = tamanhos_padrao;
+    const char *caminho_json = "benchmark_compilador.json";
+    const char *gerar = NULL;
+    ParametrosGerador parametros;
+    parametros_padrao_gerador(&parametros, 0);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tamanhos") == 0 && i + 1 < argc) {
+            tamanhos = argv[++i];
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            parametros.semente = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--comentarios") == 0 && i + 1 < argc) {
+            parametros.percentual_comentarios = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--gerar") == 0 && i + 1 < argc) {
+            gerar = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            caminho_json = argv[++i];
+        } else {
+            imprimir_uso_benchmark(argv[0]);
+            return 1;
+        }
+    }
+
+    // --gerar so escreve o programa, para usar com o compilador ou guardar como teste
+    if (gerar) {
+        ResumoGerador resumo;
+        if (ler_tamanho(gerar, &parametros.bytes_alvo) != 0) {
+            imprimir_uso_benchmark(argv[0]);
+            return 1;
+        }
+        return gerar_programa(stdout, &parametros, &resumo) == 0 && fflush(stdout) == 0 ? 0 : 1;
+    }
+
+    ResultadoBenchmark resultados[32];
+    int num_resultados = 0;
+    ContextoCompilador ctx;
+    iniciar_contexto(&ctx);
+
+    printf("%10s %10s %10s %9s %9s %9s %9s %12s %10s\n", "bytes", "tokens", "instrucoes",
+           "lexico", "analise", "geracao", "vm", "Mtokens/s", "pico RSS");
+    char *lista = copiar_texto(tamanhos, strlen(tamanhos));
+    int resultado = 0;
+    for (char *item = strtok(lista, ","); item && num_resultados < 32; item = strtok(NULL, ",")) {
+        if (ler_tamanho(item, &parametros.bytes_alvo) != 0) {
+            fprintf(stderr, "Erro: tamanho invalido: %s\n", item);
+            resultado = 1;
+            break;
+        }
+        ResultadoBenchmark *r = &resultados[num_resultados];
+        if (medir_tamanho(&ctx, &parametros, r) != 0) {
+            resultado = 1;
+            break;
+        }
+        num_resultados++;
+        double n = r->repeticoes;
+        printf("%10zu %10ld %10d %8.2fms %8.2fms %8.2fms %8.2fms %12.1f %8ld KB\n", r->bytes, r->tokens,
+               r->instrucoes, r->tempo_lexico / n * 1e3, r->tempo_analise / n * 1e3,
+               r->tempo_geracao / n * 1e3, r->tempo_vm / n * 1e3, r->tokens * n / r->tempo_lexico / 1e6,
+               r->pico_rss_kb);
+        fflush(stdout);
+    }
+    free(lista);
+    liberar_contexto(&ctx);
+
+    FILE *json = fopen(caminho_json, "w");
+    if (!json) {
+        perror("Erro ao criar o arquivo de resultados");
+        return 1;
+    }
+    escrever_json(json, &parametros, resultados, num_resultados);
+    if (fclose(json) != 0) {
+        perror("Erro ao escrever o arquivo de resultados");
+        return 1;
+    }
+    printf("resultados em %s\n", caminho_json);
+    return resultado;
+}
@@ -0,0 +1,148 @@
+// Teste diferencial e medida da compilacao em fluxo (--stream). Primeiro passa lotes
+// numerados por uma fila de 2 lotes, que enche e esvazia o tempo todo, e confere a ordem.
+// Depois compila programas sinteticos com e sem --stream, cada compilacao num processo
+// filho (para o pico de RSS ser so dela), e exige saidas identicas byte a byte
+#define main main_compiladorparte2
+#include "../compiladorparte2.c"
+#undef main
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "gerador.h"
+
+#define LOTES_TESTE_ANEL 200000
+
+typedef struct {
+    long sequencia;
+    long soma;
+} LoteTeste;
+
+static double agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void *produzir_teste(void *argumento) {
+    AnelLotes *anel = argumento;
+    for (long i = 0; i < LOTES_TESTE_ANEL; i++) {
+        LoteTeste *lote = lote_para_escrever(anel);
+        if (!lote) return NULL;
+        lote->sequencia = i;
+        lote->soma = i * 3 + 1;
+        publicar_lote(anel);
+    }
+    return NULL;
+}
+
+// Retorna 0 ou -1 com algum lote fora de ordem ou corrompido
+static int testar_anel(void) {
+    AnelLotes anel;
+    if (iniciar_anel_lotes(&anel, 2, sizeof(LoteTeste)) != 0) return -1;
+    pthread_t produtor;
+    pthread_create(&produtor, NULL, produzir_teste, &anel);
+    int resultado = 0;
+    for (long i = 0; i < LOTES_TESTE_ANEL && resultado == 0; i++) {
+        LoteTeste *lote = lote_para_ler(&anel);
+        if (lote->sequencia != i || lote->soma != i * 3 + 1) {
+            fprintf(stderr, "Erro: lote %ld da fila chegou como %ld\n", i, lote->sequencia);
+            resultado = -1;
+        }
+        devolver_lote(&anel);
+    }
+    // O produtor parado na fila cheia tambem tem de sair pelo cancelamento
+    cancelar_anel_lotes(&anel);
+    pthread_join(produtor, NULL);
+    liberar_anel_lotes(&anel);
+    return resultado;
+}
+
+// Compila num processo filho; retorna o codigo de saida (-1 se nao terminou) e preenche
+// o tempo e o pico de RSS dele
+static int compilar_filho(const char *fonte, const char *saida, int fluxo, double *tempo, long *pico_rss_kb) {
+    double inicio = agora();
+    pid_t filho = fork();
+    if (filho < 0) return -1;
+    if (filho == 0) {
+        OpcoesCompilacao opcoes = { SAIDA_TEXTO, 0, 0, FATOR_DESENROLAR_PADRAO, 0, ESTATISTICAS_DESLIGADAS, 0, NULL, 0,
+                                    { NULL, LIMITE_CACHE_PADRAO }, LIMITE_ERROS_PADRAO, 0, 1, fluxo,
+                                    stdin, stdout, stderr };
+        ContextoCompilador ctx;
+        iniciar_contexto(&ctx);
+        _exit(compilar_arquivo(&ctx, fonte, &opcoes, saida));
+    }
+    int estado;
+    struct rusage uso;
+    if (wait4(filho, &estado, 0, &uso) < 0) return -1;
+    *tempo = agora() - inicio;
+    *pico_rss_kb = uso.ru_maxrss;
+    return WIFEXITED(estado) ? WEXITSTATUS(estado) : -1;
+}
+
+// 0 se os dois arquivos tem o mesmo conteudo
+static int comparar_arquivos(const char *a, const char *b) {
+    ArquivoFonte x, y;
+    if (abrir_fonte(&x, a) != 0) return -1;
+    if (abrir_fonte(&y, b) != 0) {
+        fechar_fonte(&x);
+        return -1;
+    }
+    int diferentes = x.tamanho != y.tamanho || memcmp(x.dados, y.dados, x.tamanho) != 0;
+    fechar_fonte(&x);
+    fechar_fonte(&y);
+    return diferentes ? -1 : 0;
+}
+
+int main(void) {
+    size_t tamanhos[] = { 4u << 10, 1u << 20, 32u << 20, 200u << 20 };
+    int num_tamanhos = (int)(sizeof(tamanhos) / sizeof(tamanhos[0]));
+
+    if (testar_anel() != 0) return 1;
+    printf("fila: %d lotes em ordem por uma fila de 2\n", LOTES_TESTE_ANEL);
+
+    char fonte[] = "/tmp/bench_fluxo_XXXXXX.pas";
+    int fd = mkstemps(fonte, 4);
+    if (fd < 0) {
+        perror("Erro ao criar o fonte temporario");
+        return 1;
+    }
+    close(fd);
+    const char *saida_normal = "/tmp/bench_fluxo_normal.mepa";
+    const char *saida_fluxo = "/tmp/bench_fluxo_stream.mepa";
+
+    printf("%10s %10s %10s %12s %12s\n", "bytes", "normal", "--stream", "RSS normal", "RSS stream");
+    int resultado = 0;
+    for (int i = 0; i < num_tamanhos && resultado == 0; i++) {
+        ParametrosGerador parametros;
+        parametros_padrao_gerador(&parametros, tamanhos[i]);
+        ResumoGerador resumo;
+        FILE *arquivo = fopen(fonte, "w");
+        if (!arquivo || gerar_programa(arquivo, &parametros, &resumo) != 0 || fclose(arquivo) != 0) {
+            fprintf(stderr, "Erro ao gerar o programa de %zu bytes\n", tamanhos[i]);
+            resultado = 1;
+            break;
+        }
+        double tempo_normal, tempo_fluxo;
+        long rss_normal, rss_fluxo;
+        if (compilar_filho(fonte, saida_normal, 0, &tempo_normal, &rss_normal) != 0 ||
+            compilar_filho(fonte, saida_fluxo, 1, &tempo_fluxo, &rss_fluxo) != 0) {
+            fprintf(stderr, "Erro: o programa de %zu bytes nao compilou\n", resumo.bytes);
+            resultado = 1;
+            break;
+        }
+        if (comparar_arquivos(saida_normal, saida_fluxo) != 0) {
+            fprintf(stderr, "Erro: a saida com --stream difere no programa de %zu bytes\n", resumo.bytes);
+            resultado = 1;
+            break;
+        }
+        printf("%10zu %8.1fms %8.1fms %9ld KB %9ld KB\n", resumo.bytes, tempo_normal * 1e3, tempo_fluxo * 1e3,
+               rss_normal, rss_fluxo);
+        fflush(stdout);
+    }
+    remove(fonte);
+    remove(saida_normal);
+    remove(saida_fluxo);
+    return resultado;
+}
@@ -0,0 +1,154 @@
+// Gerador deterministico de programas da linguagem para os benchmarks
+#include "gerador.h"
+
+#include <stdarg.h>
+
+#define VARIAVEIS_POR_DECLARACAO 12
+#define NUM_CONTADORES 4
+#define LIMITE_LACOS 4
+
+typedef struct {
+    FILE *saida;
+    uint32_t aleatorio;
+    int num_variaveis;
+    ResumoGerador *resumo;
+    int erro;
+} EstadoGerador;
+
+// xorshift32: o mesmo em qualquer libc, ao contrario de rand()
+static uint32_t sortear(EstadoGerador *estado, uint32_t limite) {
+    uint32_t x = estado->aleatorio;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    estado->aleatorio = x;
+    return x % limite;
+}
+
+// Escreve uma linha inteira (o '\n' e acrescentado aqui)
+static void linha(EstadoGerador *estado, const char *formato, ...) {
+    va_list argumentos;
+    va_start(argumentos, formato);
+    int escritos = vfprintf(estado->saida, formato, argumentos);
+    va_end(argumentos);
+    if (escritos < 0 || fputc('\n', estado->saida) == EOF) {
+        estado->erro = 1;
+        return;
+    }
+    estado->resumo->bytes += (size_t)escritos + 1;
+    estado->resumo->linhas++;
+}
+
+static int variavel(EstadoGerador *estado) {
+    return (int)sortear(estado, (uint32_t)estado->num_variaveis);
+}
+
+static void gerar_comentario(EstadoGerador *estado) {
+    if (sortear(estado, 2) == 0) {
+        linha(estado, "%*s# comentario %u sobre v%d", (int)sortear(estado, 12), "",
+              sortear(estado, 100000), variavel(estado));
+        return;
+    }
+    int num_linhas = 2 + (int)sortear(estado, 5);
+    linha(estado, "{-");
+    for (int i = 0; i < num_linhas; i++) {
+        linha(estado, "   ====================== bloco %u gerado automaticamente ======================",
+              sortear(estado, 100000));
+    }
+    linha(estado, "-}");
+}
+
+// Valor constante: decimal na maior parte das vezes, as vezes binario
+static void gerar_atribuicao(EstadoGerador *estado) {
+    int destino = variavel(estado);
+    switch (sortear(estado, 4)) {
+        case 0:
+            linha(estado, "    set v%d to %u;", destino, sortear(estado, 1000));
+            break;
+        case 1:
+            linha(estado, "    set v%d to 0b%u%u%u%u;", destino, sortear(estado, 2), sortear(estado, 2),
+                  sortear(estado, 2), sortear(estado, 2));
+            break;
+        case 2:
+            linha(estado, "    set v%d to v%d;", destino, variavel(estado));
+            break;
+        default:
+            linha(estado, "    set v%d to v%d * v%d;", destino, variavel(estado), variavel(estado));
+            break;
+    }
+}
+
+// O corpo de um for e um unico set, entao o aninhamento vira sequencias de lacos;
+// contador e limite sao variaveis proprias que o corpo nunca altera
+static void gerar_laco(EstadoGerador *estado) {
+    int contador = (int)sortear(estado, NUM_CONTADORES);
+    linha(estado, "    for c%d of %u to lim:", contador, sortear(estado, 2));
+    linha(estado, "        set v%d to v%d * c%d;", variavel(estado), variavel(estado), contador);
+}
+
+static void gerar_bloco(EstadoGerador *estado, int percentual_comentarios) {
+    if ((int)sortear(estado, 100) < percentual_comentarios) {
+        gerar_comentario(estado);
+        return;
+    }
+    uint32_t tipo = sortear(estado, 10);
+    int repeticoes = 1 + (int)sortear(estado, 12);
+    for (int i = 0; i < repeticoes; i++) {
+        if (tipo < 4) {
+            gerar_atribuicao(estado);
+        } else if (tipo < 6) {
+            gerar_laco(estado);
+        } else if (tipo < 8) {
+            if (sortear(estado, 4) == 0) {
+                linha(estado, "    write(%u);", sortear(estado, 1000));
+            } else {
+                linha(estado, "    write(v%d);", variavel(estado));
+            }
+        } else {
+            linha(estado, "    read(v%d);", variavel(estado));
+            estado->resumo->leituras++;
+        }
+        estado->resumo->comandos++;
+    }
+}
+
+void parametros_padrao_gerador(ParametrosGerador *parametros, size_t bytes_alvo) {
+    parametros->bytes_alvo = bytes_alvo;
+    parametros->num_variaveis = 0;
+    parametros->percentual_comentarios = 15;
+    parametros->semente = 42;
+}
+
+int gerar_programa(FILE *saida, const ParametrosGerador *parametros, ResumoGerador *resumo) {
+    EstadoGerador estado = { saida, parametros->semente ? parametros->semente : 1, parametros->num_variaveis,
+                             resumo, 0 };
+    resumo->bytes = 0;
+    resumo->linhas = 0;
+    resumo->comandos = 0;
+    resumo->leituras = 0;
+
+    // Uma variavel a cada ~256 bytes de programa, entre 16 e 2^20
+    if (estado.num_variaveis <= 0) {
+        size_t n = parametros->bytes_alvo / 256;
+        estado.num_variaveis = n < 16 ? 16 : n > (1u << 20) ? 1 << 20 : (int)n;
+    }
+
+    linha(&estado, "{- programa sintetico: semente %u, %zu bytes -}", parametros->semente, parametros->bytes_alvo);
+    linha(&estado, "program sintetico;");
+    linha(&estado, "integer lim, c0, c1, c2, c3;");
+    for (int i = 0; i < estado.num_variaveis && !estado.erro; i += VARIAVEIS_POR_DECLARACAO) {
+        char declaracao[VARIAVEIS_POR_DECLARACAO * 12];
+        int n = 0;
+        for (int j = i; j < i + VARIAVEIS_POR_DECLARACAO && j < estado.num_variaveis; j++) {
+            n += snprintf(declaracao + n, sizeof(declaracao) - (size_t)n, j == i ? "v%d" : ", v%d", j);
+        }
+        linha(&estado, "integer %s;", declaracao);
+    }
+    linha(&estado, "begin");
+    linha(&estado, "    set lim to %d;", LIMITE_LACOS);
+    while (resumo->bytes < parametros->bytes_alvo && !estado.erro) {
+        gerar_bloco(&estado, parametros->percentual_comentarios);
+    }
+    linha(&estado, "end");
+    return estado.erro ? -1 : 0;
+}
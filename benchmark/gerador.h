@@ -0,0 +1,29 @@
+#ifndef GERADOR_H
+#define GERADOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Parametros do gerador de programas sinteticos; a mesma semente gera sempre o mesmo texto
+typedef struct {
+    size_t bytes_alvo;        // o programa termina no primeiro comando que passar deste tamanho
+    int num_variaveis;        // declaracoes "integer"; 0 escolhe pelo tamanho
+    int percentual_comentarios;
+    uint32_t semente;
+} ParametrosGerador;
+
+// O que foi gerado, para o harness conferir e alimentar a VM
+typedef struct {
+    size_t bytes;
+    long linhas;
+    long comandos;
+    long leituras;            // inteiros que a execucao vai pedir na entrada
+} ResumoGerador;
+
+void parametros_padrao_gerador(ParametrosGerador *parametros, size_t bytes_alvo);
+
+// Escreve o programa em saida. Retorna 0 ou -1 (erro de escrita)
+int gerar_programa(FILE *saida, const ParametrosGerador *parametros, ResumoGerador *resumo);
+
+#endif
@@ -0,0 +1,152 @@
+// Microbenchmark: analisador lexico caractere a caractere (isalpha/isdigit, como
+// estava nas duas partes) contra o automato de lexico.c, em um fonte sintetico de 50 MB
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "../lexico.h"
+#include "../palavras_reservadas.h"
+#include "../varredura.h"
+
+#define TAMANHO_FONTE (50 * 1024 * 1024)
+#define REPETICOES 5
+
+static double agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Copia do analisador anterior: um caractere de lookahead e classificacao pela ctype.h
+typedef struct {
+    const char *cursor;
+    const char *fim;
+    int linha;
+    int caractere;
+} LexicoAnterior;
+
+static void avancar(LexicoAnterior *l) {
+    if (l->cursor < l->fim) {
+        l->caractere = (unsigned char)*l->cursor++;
+        if (l->caractere == '\n') l->linha++;
+    } else {
+        l->caractere = EOF;
+    }
+}
+
+static void reposicionar(LexicoAnterior *l, const char *p) {
+    l->cursor = p;
+    avancar(l);
+}
+
+// Devolve 0 no fim do arquivo; identificadores e palavras reservadas contam igual
+static int proximo_anterior(LexicoAnterior *l) {
+    for (;;) {
+        if (isspace(l->caractere)) {
+            reposicionar(l, pular_espacos(l->cursor, l->fim, &l->linha));
+        } else if (l->caractere == '#') {
+            reposicionar(l, buscar_nova_linha(l->cursor, l->fim));
+        } else if (l->caractere == '{') {
+            const char *inicio = l->cursor;
+            if (inicio < l->fim && *inicio == '-') inicio++;
+            reposicionar(l, buscar_fim_comentario(inicio, l->fim, &l->linha));
+        } else {
+            break;
+        }
+    }
+    if (l->caractere == EOF) return 0;
+
+    if (isalpha(l->caractere)) {
+        const char *inicio = l->cursor - 1;
+        while (isalnum(l->caractere) || l->caractere == '_') avancar(l);
+        const char *fim = l->caractere == EOF ? l->fim : l->cursor - 1;
+        return buscar_palavra_reservada(inicio, (size_t)(fim - inicio)) == PALAVRA_NENHUMA ? 1 : 2;
+    }
+    if (isdigit(l->caractere)) {
+        while (isdigit(l->caractere)) avancar(l);
+        return 3;
+    }
+    avancar(l);
+    return 4;
+}
+
+static long contar_anterior(const char *fonte, size_t tamanho, int *linhas) {
+    LexicoAnterior l = {fonte, fonte + tamanho, 1, 0};
+    long tokens = 0;
+    avancar(&l);
+    while (proximo_anterior(&l)) tokens++;
+    *linhas = l.linha;
+    return tokens;
+}
+
+static long contar_automato(const char *fonte, size_t tamanho, int *linhas) {
+    AnalisadorLexico lexico;
+    long tokens = 0;
+    iniciar_analisador_lexico(&lexico, fonte, tamanho);
+    while (proximo_token(&lexico).tipo != TOKEN_EOF) tokens++;
+    *linhas = lexico.linha;
+    return tokens;
+}
+
+// Programa no estilo dos testes, sem literais 0b (que o analisador anterior partia em dois)
+static char *gerar_fonte(size_t *tamanho) {
+    char *fonte = malloc(TAMANHO_FONTE + 256);
+    size_t n = 0;
+    srand(42);
+    n += (size_t)sprintf(fonte + n, "program bench;\ninteger v0, v1, v2;\nbegin\n");
+    while (n < TAMANHO_FONTE) {
+        int tipo = rand() % 12;
+        if (tipo == 0) {
+            n += (size_t)sprintf(fonte + n, "{- bloco %d -}\n", rand());
+        } else if (tipo == 1) {
+            n += (size_t)sprintf(fonte + n, "    # comentario %d\n", rand());
+        } else if (tipo < 4) {
+            n += (size_t)sprintf(fonte + n, "    write(contador_%d);\n", rand() % 1000);
+        } else if (tipo < 6) {
+            n += (size_t)sprintf(fonte + n, "    for i of %d to limite_%d set x to y * z;\n",
+                                 rand() % 10, rand() % 100);
+        } else {
+            n += (size_t)sprintf(fonte + n, "    set variavel_%d to %d * valor%d;\n",
+                                 rand() % 1000, rand(), rand() % 100);
+        }
+    }
+    n += (size_t)sprintf(fonte + n, "end\n");
+    *tamanho = n;
+    return fonte;
+}
+
+int main(void) {
+    size_t tamanho;
+    char *fonte = gerar_fonte(&tamanho);
+
+    int linhas_anterior = 0, linhas_automato = 0;
+    long tokens_anterior = 0, tokens_automato = 0;
+
+    double inicio = agora();
+    for (int r = 0; r < REPETICOES; r++) {
+        tokens_anterior = contar_anterior(fonte, tamanho, &linhas_anterior);
+    }
+    double tempo_anterior = agora() - inicio;
+
+    inicio = agora();
+    for (int r = 0; r < REPETICOES; r++) {
+        tokens_automato = contar_automato(fonte, tamanho, &linhas_automato);
+    }
+    double tempo_automato = agora() - inicio;
+
+    if (tokens_anterior != tokens_automato || linhas_anterior != linhas_automato) {
+        fprintf(stderr, "Erro: analisadores divergem (%ld/%d tokens/linhas contra %ld/%d)\n",
+                tokens_anterior, linhas_anterior, tokens_automato, linhas_automato);
+        return 1;
+    }
+
+    double milhoes = (double)tokens_automato * REPETICOES / 1e6;
+    printf("%.1f MB, %ld tokens, %d linhas\n", (double)tamanho / 1e6, tokens_automato, linhas_automato);
+    printf("caractere a caractere: %8.1f Mtokens/s\n", milhoes / tempo_anterior);
+    printf("automato:              %8.1f Mtokens/s (%.2fx)\n", milhoes / tempo_automato,
+           tempo_anterior / tempo_automato);
+    free(fonte);
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Microbenchmark e teste diferencial da analise lexica por trechos (lexico_paralelo.c):
+// a sequencia de tokens tem de ser identica a de proximo_token, campo a campo, em um fonte
+// com banners {- -} de varias linhas e em entradas aleatorias divididas em muitos trechos
+// pequenos. Depois mede a vazao com 1, 2, 4 e 8 threads em um fonte de 200 MB
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lexico.h"
+#include "../lexico_paralelo.h"
+
+#define TAMANHO_FONTE (200 * 1024 * 1024)
+#define TAMANHO_ALEATORIO 4096
+#define ENTRADAS_ALEATORIAS 2000
+#define REPETICOES 3
+
+static double agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int tokens_iguais(Token a, Token b) {
+    return a.tipo == b.tipo && a.linha == b.linha && a.inicio == b.inicio && a.tamanho == b.tamanho &&
+           a.valor.valor_inteiro == b.valor.valor_inteiro;
+}
+
+// Compara com o analisador sequencial, incluindo o TOKEN_EOF. Retorna 0 ou -1
+static int comparar(const char *fonte, size_t tamanho, int num_threads, int num_trechos) {
+    TokensParalelos paralelos;
+    if (analisar_lexico_em_trechos(&paralelos, fonte, tamanho, num_threads, num_trechos) != 0) {
+        perror("Erro na analise por trechos");
+        return -1;
+    }
+    AnalisadorLexico lexico;
+    iniciar_analisador_lexico(&lexico, fonte, tamanho);
+    long n = 0;
+    int resultado = 0;
+    for (;; n++) {
+        Token esperado = proximo_token(&lexico);
+        Token obtido = proximo_token_paralelo(&paralelos);
+        if (!tokens_iguais(esperado, obtido)) {
+            fprintf(stderr, "Erro: token %ld diverge com %d trechos (%d trechos reais): esperado %s linha %d "
+                            "posicao %u, obtido %s linha %d posicao %u\n",
+                    n, num_trechos, paralelos.num_trechos, nome_token(esperado.tipo), esperado.linha,
+                    esperado.inicio, nome_token(obtido.tipo), obtido.linha, obtido.inicio);
+            resultado = -1;
+            break;
+        }
+        if (esperado.tipo == TOKEN_EOF) break;
+    }
+    liberar_tokens_paralelos(&paralelos);
+    return resultado;
+}
+
+// Programa no estilo dos testes, com banners de varias linhas, comentarios que contem
+// "{-" e "-}" fora de comentario (subtracao seguida do simbolo '}')
+static char *gerar_fonte(size_t *tamanho) {
+    char *fonte = malloc(TAMANHO_FONTE + 1024);
+    size_t n = 0;
+    srand(42);
+    n += (size_t)sprintf(fonte + n, "program bench;\ninteger v0, v1, v2;\nbegin\n");
+    while (n < TAMANHO_FONTE) {
+        int tipo = rand() % 16;
+        if (tipo == 0) {
+            n += (size_t)sprintf(fonte + n, "{-\n");
+            for (int i = rand() % 40; i > 0; i--) {
+                n += (size_t)sprintf(fonte + n, "   set comentado_%d to %d; { write(x)\n", rand() % 100, rand());
+            }
+            n += (size_t)sprintf(fonte + n, "-}\n");
+        } else if (tipo == 1) {
+            n += (size_t)sprintf(fonte + n, "    # comentario {- que nao abre %d\n", rand());
+        } else if (tipo == 2) {
+            n += (size_t)sprintf(fonte + n, "    set v%d to v1 -} 0b1011 {- curto -} 99999999999;\n", rand() % 3);
+        } else if (tipo < 6) {
+            n += (size_t)sprintf(fonte + n, "    write(contador_%d);\n", rand() % 1000);
+        } else if (tipo < 8) {
+            n += (size_t)sprintf(fonte + n, "    for i of %d to limite_%d: set x to y * z;\n",
+                                 rand() % 10, rand() % 100);
+        } else {
+            n += (size_t)sprintf(fonte + n, "    set variavel_%d to %d * valor%d <= 3 <> 4;\n",
+                                 rand() % 1000, rand(), rand() % 100);
+        }
+    }
+    n += (size_t)sprintf(fonte + n, "end.\n{- sem fechar\n");
+    *tamanho = n;
+    return fonte;
+}
+
+// Bytes de um alfabeto pequeno, com muitas aberturas e fechamentos de comentario
+static void gerar_aleatorio(char *fonte, size_t tamanho) {
+    static const char alfabeto[] = "{{--}}\n\n\n  ##ab01;<>=x9";
+    for (size_t i = 0; i < tamanho; i++) fonte[i] = alfabeto[rand() % (sizeof(alfabeto) - 1)];
+}
+
+int main(void) {
+    char aleatorio[TAMANHO_ALEATORIO];
+    srand(7);
+    for (int i = 0; i < ENTRADAS_ALEATORIAS; i++) {
+        size_t tamanho = (size_t)(rand() % TAMANHO_ALEATORIO) + 1;
+        gerar_aleatorio(aleatorio, tamanho);
+        if (comparar(aleatorio, tamanho, 1 + i % 4, 1 + rand() % 64) != 0) return 1;
+    }
+
+    size_t tamanho;
+    char *fonte = gerar_fonte(&tamanho);
+    int trechos_teste[] = {1, 2, 3, 7, 64, 1000};
+    for (size_t i = 0; i < sizeof(trechos_teste) / sizeof(trechos_teste[0]); i++) {
+        if (comparar(fonte, tamanho, 4, trechos_teste[i]) != 0) return 1;
+    }
+
+    long num_tokens = 0;
+    AnalisadorLexico lexico;
+    double inicio = agora();
+    for (int r = 0; r < REPETICOES; r++) {
+        iniciar_analisador_lexico(&lexico, fonte, tamanho);
+        num_tokens = 0;
+        while (proximo_token(&lexico).tipo != TOKEN_EOF) num_tokens++;
+    }
+    double tempo_sequencial = agora() - inicio;
+    double milhoes = (double)num_tokens * REPETICOES / 1e6;
+    printf("%.1f MB, %ld tokens, %d linhas; tokens identicos ao sequencial\n", (double)tamanho / 1e6,
+           num_tokens, lexico.linha);
+    printf("sequencial:       %8.1f Mtokens/s\n", milhoes / tempo_sequencial);
+
+    int threads_teste[] = {1, 2, 4, 8};
+    for (size_t i = 0; i < sizeof(threads_teste) / sizeof(threads_teste[0]); i++) {
+        // Analise por trechos e leitura de todos os tokens, como faz o analisador sintatico
+        inicio = agora();
+        for (int r = 0; r < REPETICOES; r++) {
+            TokensParalelos paralelos;
+            if (analisar_lexico_paralelo(&paralelos, fonte, tamanho, threads_teste[i]) != 0) {
+                perror("Erro na analise por trechos");
+                return 1;
+            }
+            while (proximo_token_paralelo(&paralelos).tipo != TOKEN_EOF) {}
+            liberar_tokens_paralelos(&paralelos);
+        }
+        double tempo = agora() - inicio;
+        printf("%d thread(s):      %8.1f Mtokens/s (%.2fx)\n", threads_teste[i], milhoes / tempo,
+               tempo_sequencial / tempo);
+    }
+    free(fonte);
+    return 0;
+}
@@ -0,0 +1,320 @@
+// Teste diferencial do executavel nativo (--emit=exe) contra a VM (--run). Gera programas
+// aleatorios com div e mod sobre valores extremos, mais casos fixos de divisao por zero e de
+// INT_MIN div -1 (constantes, que -O1 dobra, e lidos da entrada), e compila cada um em -O0,
+// -O1 e -O2. A saida padrao, a de erros e o codigo de saida do executavel tem de ser iguais
+// aos da execucao na VM
+#define main main_compiladorparte2
+#include "../compiladorparte2.c"
+#undef main
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#define NUM_PROGRAMAS_ALEATORIOS 150
+#define NUM_VARIAVEIS_TESTE 8
+#define NUM_CONTADORES_TESTE 2
+#define NUM_LEITURAS_ENTRADA 64
+#define PROFUNDIDADE_EXPRESSAO 3
+
+typedef struct {
+    FILE *saida;
+    uint32_t aleatorio;
+} GeradorTeste;
+
+static double agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// xorshift32, como em gerador.c
+static uint32_t sortear(GeradorTeste *gerador, uint32_t limite) {
+    uint32_t x = gerador->aleatorio;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gerador->aleatorio = x;
+    return x % limite;
+}
+
+// Constantes que exercitam os casos de borda: 0, -1 e os extremos de 32 bits. INT_MIN nao
+// cabe num literal decimal e sai como expressao
+static void gerar_constante(GeradorTeste *gerador) {
+    static const char *extremos[] = { "0", "1", "-1", "2", "-2", "2147483647", "-2147483647",
+                                      "(-2147483647 - 1)", "0b11111111111111111111111111111111" };
+    if (sortear(gerador, 3) == 0) {
+        fprintf(gerador->saida, "%s", extremos[sortear(gerador, sizeof(extremos) / sizeof(extremos[0]))]);
+    } else {
+        fprintf(gerador->saida, "%u", sortear(gerador, 100));
+    }
+}
+
+static void gerar_expressao(GeradorTeste *gerador, int profundidade) {
+    static const char *operadores[] = { "+", "-", "*", "div", "mod", "div", "mod", "=", "<>", "<",
+                                        "<=", ">", ">=", "and", "or" };
+    uint32_t tipo = profundidade == 0 ? sortear(gerador, 2) : sortear(gerador, 6);
+    switch (tipo) {
+        case 0:
+            gerar_constante(gerador);
+            break;
+        case 1:
+            fprintf(gerador->saida, "v%u", sortear(gerador, NUM_VARIAVEIS_TESTE));
+            break;
+        case 2:
+            fprintf(gerador->saida, sortear(gerador, 2) ? "-" : "not ");
+            gerar_expressao(gerador, profundidade - 1);
+            break;
+        default: {
+            const char *operador = operadores[sortear(gerador, sizeof(operadores) / sizeof(operadores[0]))];
+            fputc('(', gerador->saida);
+            gerar_expressao(gerador, profundidade - 1);
+            fprintf(gerador->saida, " %s ", operador);
+            // Divisor quase sempre folha: comparacoes valem 0 metade das vezes e parariam o
+            // programa logo na primeira divisao
+            int divisao = operador[0] == 'd' || operador[0] == 'm';
+            gerar_expressao(gerador, divisao && sortear(gerador, 4) != 0 ? 0 : profundidade - 1);
+            fputc(')', gerador->saida);
+            break;
+        }
+    }
+}
+
+// O limite do for e "v mod 16", entao cada laco da no maximo 16 voltas mesmo com o corpo
+// alterando a variavel; os contadores c0.. so sao escritos pelo proprio for
+static void gerar_programa_teste(GeradorTeste *gerador) {
+    FILE *saida = gerador->saida;
+    fprintf(saida, "program diferencial;\ninteger ");
+    for (int i = 0; i < NUM_VARIAVEIS_TESTE; i++) fprintf(saida, "v%d, ", i);
+    for (int i = 0; i < NUM_CONTADORES_TESTE; i++) {
+        fprintf(saida, "c%d%s", i, i + 1 < NUM_CONTADORES_TESTE ? ", " : ";\nbegin\n");
+    }
+    for (int i = 0; i < NUM_VARIAVEIS_TESTE; i++) fprintf(saida, "    read(v%d);\n", i);
+    int num_comandos = 4 + (int)sortear(gerador, 24);
+    for (int i = 0; i < num_comandos; i++) {
+        switch (sortear(gerador, 8)) {
+            case 0:
+                fprintf(saida, "    read(v%u)", sortear(gerador, NUM_VARIAVEIS_TESTE));
+                break;
+            case 1:
+            case 2:
+                fprintf(saida, "    write(");
+                gerar_expressao(gerador, PROFUNDIDADE_EXPRESSAO);
+                fputc(')', saida);
+                break;
+            case 3:
+                fprintf(saida, "    for c%u of %u to v%u mod 16:\n        set v%u to ",
+                        sortear(gerador, NUM_CONTADORES_TESTE), sortear(gerador, 3),
+                        sortear(gerador, NUM_VARIAVEIS_TESTE), sortear(gerador, NUM_VARIAVEIS_TESTE));
+                gerar_expressao(gerador, PROFUNDIDADE_EXPRESSAO - 1);
+                break;
+            default:
+                fprintf(saida, "    set v%u to ", sortear(gerador, NUM_VARIAVEIS_TESTE));
+                gerar_expressao(gerador, PROFUNDIDADE_EXPRESSAO);
+                break;
+        }
+        fprintf(saida, "%s\n", i + 1 < num_comandos ? ";" : "");
+    }
+    fprintf(saida, "end.\n");
+}
+
+// Entrada dos programas aleatorios: inteiros com sinal, muitos pequenos e alguns extremos
+static void gerar_entrada(GeradorTeste *gerador) {
+    static const int extremos[] = { 0, 1, -1, 2147483647, -2147483647 };
+    for (int i = 0; i < NUM_LEITURAS_ENTRADA; i++) {
+        uint32_t tipo = sortear(gerador, 4);
+        int valor = tipo == 0   ? extremos[sortear(gerador, sizeof(extremos) / sizeof(extremos[0]))]
+                    : tipo == 1 ? (int)sortear(gerador, 2147483647u) - (int)sortear(gerador, 2147483647u)
+                                : (int)sortear(gerador, 41) - 20;
+        fprintf(gerador->saida, "%d\n", valor);
+    }
+}
+
+// Casos fixos: programa e entrada
+static const char *casos_fixos[][2] = {
+    { "program d; integer a; begin write(1); write(7 div 0) end.", "" },
+    { "program d; integer a; begin write(1); write(7 mod 0) end.", "" },
+    { "program d; integer a, b; begin read(a); read(b); write(a); write(a div b); write(2) end.", "5 0" },
+    { "program d; integer a, b; begin read(a); read(b); write(a mod b) end.", "-9 0" },
+    { "program d; integer a; begin set a to 0; for a of 0 to 3: set a to 10 div a end.", "" },
+    { "program d; integer a; begin write((-2147483647 - 1) div -1); write((-2147483647 - 1) mod -1) end.", "" },
+    { "program d; integer a, b; begin read(a); read(b); set a to a - 1; write(a div b); write(a mod b) end.",
+      "-2147483647 -1" },
+    { "program d; integer a, b; begin read(a); read(b); write((a - 1) div b); write((a - 1) mod b);"
+      " write((a - 1) div 7); write((a - 1) mod -7) end.", "-2147483647 -1" },
+    { "program d; integer a, b; begin set b to -1; read(a); set a to a - 1; write(a div b * 1 + 0) end.",
+      "-2147483647" },
+    { "program d; integer a; begin read(a); write(a); read(a); write(a) end.", "3" },
+};
+
+// Codigo de saida do processo ou -1 se nao terminou normalmente
+static int executar_nativo(const char *executavel, const char *entrada, const char *saida, const char *erros) {
+    pid_t filho = fork();
+    if (filho < 0) return -1;
+    if (filho == 0) {
+        int fd_entrada = open(entrada, O_RDONLY);
+        int fd_saida = open(saida, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        int fd_erros = open(erros, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd_entrada < 0 || fd_saida < 0 || fd_erros < 0) _exit(126);
+        dup2(fd_entrada, 0);
+        dup2(fd_saida, 1);
+        dup2(fd_erros, 2);
+        execl(executavel, executavel, (char *)NULL);
+        _exit(127);
+    }
+    int estado;
+    if (waitpid(filho, &estado, 0) < 0) return -1;
+    return WIFEXITED(estado) ? WEXITSTATUS(estado) : -1;
+}
+
+// 0 se os dois arquivos tem o mesmo conteudo
+static int comparar_arquivos(const char *a, const char *b) {
+    ArquivoFonte x, y;
+    if (abrir_fonte(&x, a) != 0) return -1;
+    if (abrir_fonte(&y, b) != 0) {
+        fechar_fonte(&x);
+        return -1;
+    }
+    int diferentes = x.tamanho != y.tamanho || (x.tamanho > 0 && memcmp(x.dados, y.dados, x.tamanho) != 0);
+    fechar_fonte(&x);
+    fechar_fonte(&y);
+    return diferentes ? -1 : 0;
+}
+
+// Compila e executa o fonte dos dois jeitos num nivel. Retorna 0, 1 com alguma diferenca
+// (ja reportada) ou -1 se nem compilou; *erro_execucao diz se a VM parou com erro
+static int comparar_nivel(ContextoCompilador *ctx, FILE *descarte, const char *fonte, const char *entrada,
+                          int nivel, int *erro_execucao) {
+    const char *executavel = "/tmp/bench_nativo.exe";
+    const char *saida_nativa = "/tmp/bench_nativo_exe.out";
+    const char *erros_nativos = "/tmp/bench_nativo_exe.err";
+    const char *saida_vm = "/tmp/bench_nativo_vm.out";
+    const char *erros_vm = "/tmp/bench_nativo_vm.err";
+
+    OpcoesCompilacao opcoes = { SAIDA_EXECUTAVEL, 0, nivel, FATOR_DESENROLAR_PADRAO, 0, ESTATISTICAS_DESLIGADAS, 0, NULL,
+                                0, { NULL, LIMITE_CACHE_PADRAO }, LIMITE_ERROS_PADRAO, 0, 1, 0,
+                                stdin, descarte, descarte };
+    ctx->diagnosticos = descarte;
+    if (compilar_arquivo(ctx, fonte, &opcoes, executavel) != 0) return -1;
+    int status_nativo = executar_nativo(executavel, entrada, saida_nativa, erros_nativos);
+
+    FILE *arquivo_entrada = fopen(entrada, "r");
+    FILE *arquivo_saida = fopen(saida_vm, "w");
+    FILE *arquivo_erros = fopen(erros_vm, "w");
+    if (!arquivo_entrada || !arquivo_saida || !arquivo_erros) {
+        if (arquivo_entrada) fclose(arquivo_entrada);
+        if (arquivo_saida) fclose(arquivo_saida);
+        if (arquivo_erros) fclose(arquivo_erros);
+        return -1;
+    }
+    opcoes.formato = SAIDA_TEXTO;
+    opcoes.executar = 1;
+    opcoes.entrada = arquivo_entrada;
+    opcoes.saida = arquivo_saida;
+    opcoes.erros = arquivo_erros;
+    int status_vm = compilar_arquivo(ctx, fonte, &opcoes, NULL);
+    fclose(arquivo_entrada);
+    fclose(arquivo_saida);
+    fclose(arquivo_erros);
+    *erro_execucao = status_vm != 0;
+
+    if (status_nativo != status_vm) {
+        fprintf(stderr, "Erro: -O%d: o executavel saiu com %d e a VM com %d\n", nivel, status_nativo, status_vm);
+        return 1;
+    }
+    if (comparar_arquivos(saida_nativa, saida_vm) != 0) {
+        fprintf(stderr, "Erro: -O%d: a saida do executavel difere da VM\n", nivel);
+        return 1;
+    }
+    if (comparar_arquivos(erros_nativos, erros_vm) != 0) {
+        fprintf(stderr, "Erro: -O%d: os erros do executavel diferem da VM\n", nivel);
+        return 1;
+    }
+    return 0;
+}
+
+// Compara os tres niveis; com diferenca mostra o programa e a entrada
+static int comparar_programa(ContextoCompilador *ctx, FILE *descarte, const char *fonte, const char *entrada,
+                             int *erros_execucao) {
+    for (int nivel = 0; nivel <= 2; nivel++) {
+        int erro_execucao = 0;
+        int resultado = comparar_nivel(ctx, descarte, fonte, entrada, nivel, &erro_execucao);
+        if (resultado < 0) fprintf(stderr, "Erro: -O%d: o programa nao compilou\n", nivel);
+        if (resultado != 0) {
+            ArquivoFonte texto;
+            if (abrir_fonte(&texto, fonte) == 0) {
+                fprintf(stderr, "%.*s", (int)texto.tamanho, texto.dados);
+                fechar_fonte(&texto);
+            }
+            if (abrir_fonte(&texto, entrada) == 0) {
+                fprintf(stderr, "entrada:\n%.*s\n", (int)texto.tamanho, texto.dados);
+                fechar_fonte(&texto);
+            }
+            return 1;
+        }
+        *erros_execucao += erro_execucao;
+    }
+    return 0;
+}
+
+int main(void) {
+    const char *fonte = "/tmp/bench_nativo.pas";
+    const char *entrada = "/tmp/bench_nativo.in";
+    FILE *descarte = fopen("/dev/null", "w");
+    if (!descarte) {
+        perror("Erro ao abrir /dev/null");
+        return 1;
+    }
+    ContextoCompilador ctx;
+    iniciar_contexto(&ctx);
+
+    double inicio = agora();
+    int resultado = 0;
+    int erros_execucao = 0;
+    int num_fixos = (int)(sizeof(casos_fixos) / sizeof(casos_fixos[0]));
+    for (int i = 0; i < num_fixos && resultado == 0; i++) {
+        FILE *arquivo_fonte = fopen(fonte, "w");
+        FILE *arquivo_entrada = fopen(entrada, "w");
+        if (!arquivo_fonte || !arquivo_entrada) {
+            fprintf(stderr, "Erro ao criar os arquivos temporarios\n");
+            return 1;
+        }
+        fprintf(arquivo_fonte, "%s\n", casos_fixos[i][0]);
+        fprintf(arquivo_entrada, "%s\n", casos_fixos[i][1]);
+        fclose(arquivo_fonte);
+        fclose(arquivo_entrada);
+        resultado = comparar_programa(&ctx, descarte, fonte, entrada, &erros_execucao);
+    }
+    if (resultado == 0) {
+        printf("casos fixos: %d programas em -O0, -O1 e -O2 (%d execucoes com erro)\n", num_fixos, erros_execucao);
+    }
+
+    erros_execucao = 0;
+    GeradorTeste gerador = { NULL, 2463534242u };
+    for (int i = 0; i < NUM_PROGRAMAS_ALEATORIOS && resultado == 0; i++) {
+        gerador.saida = fopen(fonte, "w");
+        if (!gerador.saida) break;
+        gerar_programa_teste(&gerador);
+        fclose(gerador.saida);
+        gerador.saida = fopen(entrada, "w");
+        if (!gerador.saida) break;
+        gerar_entrada(&gerador);
+        fclose(gerador.saida);
+        resultado = comparar_programa(&ctx, descarte, fonte, entrada, &erros_execucao);
+    }
+    if (resultado == 0) {
+        printf("aleatorios: %d programas em -O0, -O1 e -O2 (%d execucoes com erro), %.1fs no total\n",
+               NUM_PROGRAMAS_ALEATORIOS, erros_execucao, agora() - inicio);
+    }
+
+    liberar_contexto(&ctx);
+    fclose(descarte);
+    remove(fonte);
+    remove(entrada);
+    remove("/tmp/bench_nativo.exe");
+    remove("/tmp/bench_nativo_exe.out");
+    remove("/tmp/bench_nativo_exe.err");
+    remove("/tmp/bench_nativo_vm.out");
+    remove("/tmp/bench_nativo_vm.err");
+    return resultado;
+}
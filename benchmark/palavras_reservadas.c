@@ -0,0 +1,85 @@
+// Microbenchmark: reconhecimento de palavras reservadas por identificador,
+// cadeia de strcmp antiga contra o reconhecedor por tamanho + primeiro caractere
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../palavras_reservadas.h"
+
+#define NUM_LEXEMAS 4096
+#define REPETICOES 2000
+
+// Cadeia original de compiladorparte1.c, mantida apenas para comparacao
+static PalavraReservada cadeia_strcmp(const char *lexema) {
+    if (strcmp(lexema, "program") == 0) return PALAVRA_PROGRAM;
+    if (strcmp(lexema, "integer") == 0) return PALAVRA_INTEGER;
+    if (strcmp(lexema, "boolean") == 0) return PALAVRA_BOOLEAN;
+    if (strcmp(lexema, "begin") == 0) return PALAVRA_BEGIN;
+    if (strcmp(lexema, "end") == 0) return PALAVRA_END;
+    if (strcmp(lexema, "read") == 0) return PALAVRA_READ;
+    if (strcmp(lexema, "write") == 0) return PALAVRA_WRITE;
+    if (strcmp(lexema, "if") == 0) return PALAVRA_IF;
+    if (strcmp(lexema, "elif") == 0) return PALAVRA_ELIF;
+    if (strcmp(lexema, "for") == 0) return PALAVRA_FOR;
+    if (strcmp(lexema, "set") == 0) return PALAVRA_SET;
+    if (strcmp(lexema, "to") == 0) return PALAVRA_TO;
+    if (strcmp(lexema, "of") == 0) return PALAVRA_OF;
+    if (strcmp(lexema, "true") == 0) return PALAVRA_TRUE;
+    if (strcmp(lexema, "false") == 0) return PALAVRA_FALSE;
+    if (strcmp(lexema, "and") == 0) return PALAVRA_AND;
+    if (strcmp(lexema, "or") == 0) return PALAVRA_OR;
+    if (strcmp(lexema, "not") == 0) return PALAVRA_NOT;
+    return PALAVRA_NENHUMA;
+}
+
+static double agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void) {
+    static const char *palavras[] = {
+        "program", "integer", "boolean", "begin", "end", "read", "write", "if", "elif",
+        "for", "set", "to", "of", "true", "false", "and", "or", "not"
+    };
+    static char lexemas[NUM_LEXEMAS][16];
+    static size_t tamanhos[NUM_LEXEMAS];
+
+    // Mistura tipica de programa gerado: 1 palavra reservada para cada 4 identificadores
+    srand(42);
+    for (int i = 0; i < NUM_LEXEMAS; i++) {
+        if (i % 5 == 0) {
+            strcpy(lexemas[i], palavras[rand() % 18]);
+        } else {
+            snprintf(lexemas[i], sizeof(lexemas[i]), "%c%s_%d", 'a' + rand() % 26,
+                     (i & 1) ? "var" : "n", rand() % 10000);
+        }
+        tamanhos[i] = strlen(lexemas[i]);
+    }
+
+    unsigned long soma_cadeia = 0, soma_trie = 0;
+    double inicio = agora();
+    for (int r = 0; r < REPETICOES; r++) {
+        for (int i = 0; i < NUM_LEXEMAS; i++) soma_cadeia += cadeia_strcmp(lexemas[i]);
+    }
+    double tempo_cadeia = agora() - inicio;
+
+    inicio = agora();
+    for (int r = 0; r < REPETICOES; r++) {
+        for (int i = 0; i < NUM_LEXEMAS; i++) soma_trie += buscar_palavra_reservada(lexemas[i], tamanhos[i]);
+    }
+    double tempo_trie = agora() - inicio;
+
+    if (soma_cadeia != soma_trie) {
+        fprintf(stderr, "Erro: reconhecedores divergem (%lu != %lu)\n", soma_cadeia, soma_trie);
+        return 1;
+    }
+
+    double total = (double)NUM_LEXEMAS * REPETICOES;
+    printf("cadeia strcmp : %6.2f ns/identificador\n", tempo_cadeia * 1e9 / total);
+    printf("switch trie   : %6.2f ns/identificador\n", tempo_trie * 1e9 / total);
+    printf("aceleracao    : %6.1fx\n", tempo_cadeia / tempo_trie);
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Microbenchmark: pular espacos e comentarios byte a byte contra os blocos SIMD
+// de varredura.c, em um fonte no estilo dos programas gerados (banners e indentacao)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../varredura.h"
+
+#define TAMANHO_FONTE (8 * 1024 * 1024)
+#define REPETICOES 20
+
+typedef const char *(*FuncaoEspacos)(const char *, const char *, int *);
+typedef const char *(*FuncaoComentario)(const char *, const char *, int *);
+
+static double agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Mesmo laco de ignorar_espacos_e_comentarios; cada "token" vai ate o proximo espaco
+static long varrer(const char *p, const char *fim, FuncaoEspacos espacos, FuncaoComentario comentario,
+                   int *linhas) {
+    long tokens = 0;
+    while (p < fim) {
+        if (*p == ' ' || (*p >= '\t' && *p <= '\r')) {
+            p = espacos(p, fim, linhas);
+        } else if (*p == '#') {
+            p = buscar_nova_linha(p, fim);
+        } else if (*p == '{') {
+            p = comentario(p + 1 < fim && p[1] == '-' ? p + 2 : p + 1, fim, linhas);
+        } else {
+            tokens++;
+            while (p < fim && *p != ' ' && *p != '\n') p++;
+        }
+    }
+    return tokens;
+}
+
+static char *gerar_fonte(size_t *tamanho) {
+    char *fonte = malloc(TAMANHO_FONTE + 256);
+    size_t n = 0;
+    srand(42);
+    while (n < TAMANHO_FONTE) {
+        int tipo = rand() % 10;
+        if (tipo == 0) {
+            // Banner de varias linhas
+            n += (size_t)sprintf(fonte + n, "{-\n");
+            for (int i = 0; i < 6; i++) {
+                n += (size_t)sprintf(fonte + n, "   ==================== bloco %d gerado automaticamente ====\n", rand());
+            }
+            n += (size_t)sprintf(fonte + n, "-}\n");
+        } else if (tipo == 1) {
+            n += (size_t)sprintf(fonte + n, "%*s# comentario de linha %d\n", rand() % 24, "", rand());
+        } else {
+            n += (size_t)sprintf(fonte + n, "%*sset v%d to v%d * v%d;\n", 4 * (rand() % 8), "",
+                                 rand() % 100, rand() % 100, rand() % 100);
+        }
+    }
+    *tamanho = n;
+    return fonte;
+}
+
+int main(void) {
+    size_t tamanho;
+    char *fonte = gerar_fonte(&tamanho);
+    const char *fim = fonte + tamanho;
+
+    int linhas_escalar = 0, linhas_simd = 0;
+    long tokens_escalar = 0, tokens_simd = 0;
+
+    double inicio = agora();
+    for (int r = 0; r < REPETICOES; r++) {
+        tokens_escalar += varrer(fonte, fim, pular_espacos_escalar, buscar_fim_comentario_escalar, &linhas_escalar);
+    }
+    double tempo_escalar = agora() - inicio;
+
+    inicio = agora();
+    for (int r = 0; r < REPETICOES; r++) {
+        tokens_simd += varrer(fonte, fim, pular_espacos, buscar_fim_comentario, &linhas_simd);
+    }
+    double tempo_simd = agora() - inicio;
+
+    if (tokens_escalar != tokens_simd || linhas_escalar != linhas_simd) {
+        fprintf(stderr, "Erro: varreduras divergem (%ld/%d tokens/linhas contra %ld/%d)\n",
+                tokens_escalar, linhas_escalar, tokens_simd, linhas_simd);
+        return 1;
+    }
+
+    double megabytes = (double)tamanho * REPETICOES / 1e6;
+    printf("%.1f MB, %d linhas por passada\n", (double)tamanho / 1e6, linhas_simd / REPETICOES);
+    printf("byte a byte: %8.1f MB/s\n", megabytes / tempo_escalar);
+    printf("blocos SIMD: %8.1f MB/s (%.2fx)\n", megabytes / tempo_simd, tempo_escalar / tempo_simd);
+    free(fonte);
+    return 0;
+}
@@ -0,0 +1,380 @@
+#include "cache_compilacao.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#define TAMANHO_CABECALHO_CACHE (8 + TAMANHO_CHAVE_CACHE + 8 + TAMANHO_CHAVE_CACHE)
+#define TAMANHO_NOME_CACHE (2 * TAMANHO_CHAVE_CACHE)
+// Temporarios de um processo que morreu no meio da gravacao saem no despejo depois disto
+#define IDADE_TEMPORARIO_ABANDONADO 3600
+
+static const uint32_t constantes_sha256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+// Extensoes SHA do x86 (compile com -msha ou -march=native): duas rodadas por instrucao, com
+// o estado nos registradores como ABEF/CDGH
+static void processar_blocos(uint32_t estado[8], const unsigned char *dados, size_t num_blocos) {
+#ifdef __AVX__
+    // As instrucoes SHA so tem a codificacao SSE antiga: com a metade alta dos registradores
+    // AVX suja, cada uma pagaria a transicao de estado
+    _mm256_zeroupper();
+#endif
+    const __m128i inverter_bytes = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+    __m128i cdab = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&estado[0]), 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&estado[4]), 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    for (; num_blocos > 0; num_blocos--, dados += 64) {
+        __m128i abef_anterior = abef, cdgh_anterior = cdgh;
+        __m128i w[4];
+        for (int i = 0; i < 16; i++) {
+            if (i < 4) {
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(dados + 16 * i)), inverter_bytes);
+            } else {
+                __m128i soma = _mm_add_epi32(_mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]),
+                                             _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                w[i & 3] = _mm_sha256msg2_epu32(soma, w[(i + 3) & 3]);
+            }
+            __m128i rodada = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&constantes_sha256[4 * i]));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, rodada);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(rodada, 0x0E));
+        }
+        abef = _mm_add_epi32(abef, abef_anterior);
+        cdgh = _mm_add_epi32(cdgh, cdgh_anterior);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i *)&estado[0], _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128((__m128i *)&estado[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+#else
+static inline uint32_t rotacionar(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static void processar_blocos(uint32_t estado[8], const unsigned char *dados, size_t num_blocos) {
+    for (; num_blocos > 0; num_blocos--, dados += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t)dados[4 * i] << 24 | (uint32_t)dados[4 * i + 1] << 16 |
+                   (uint32_t)dados[4 * i + 2] << 8 | dados[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotacionar(w[i - 15], 7) ^ rotacionar(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotacionar(w[i - 2], 17) ^ rotacionar(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = estado[0], b = estado[1], c = estado[2], d = estado[3];
+        uint32_t e = estado[4], f = estado[5], g = estado[6], h = estado[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotacionar(e, 6) ^ rotacionar(e, 11) ^ rotacionar(e, 25)) + ((e & f) ^ (~e & g)) +
+                          constantes_sha256[i] + w[i];
+            uint32_t t2 = (rotacionar(a, 2) ^ rotacionar(a, 13) ^ rotacionar(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        estado[0] += a;
+        estado[1] += b;
+        estado[2] += c;
+        estado[3] += d;
+        estado[4] += e;
+        estado[5] += f;
+        estado[6] += g;
+        estado[7] += h;
+    }
+}
+#endif
+
+void iniciar_sha256(Sha256 *sha) {
+    static const uint32_t inicial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(sha->estado, inicial, sizeof(inicial));
+    sha->total = 0;
+    sha->usado = 0;
+}
+
+void atualizar_sha256(Sha256 *sha, const void *dados, size_t tamanho) {
+    const unsigned char *p = dados;
+    sha->total += tamanho;
+    if (sha->usado) {
+        size_t falta = sizeof(sha->bloco) - sha->usado;
+        size_t n = tamanho < falta ? tamanho : falta;
+        memcpy(sha->bloco + sha->usado, p, n);
+        sha->usado += n;
+        p += n;
+        tamanho -= n;
+        if (sha->usado < sizeof(sha->bloco)) return;
+        processar_blocos(sha->estado, sha->bloco, 1);
+        sha->usado = 0;
+    }
+    // Blocos inteiros direto dos dados, sem copiar
+    size_t inteiros = tamanho / sizeof(sha->bloco);
+    processar_blocos(sha->estado, p, inteiros);
+    p += inteiros * sizeof(sha->bloco);
+    tamanho -= inteiros * sizeof(sha->bloco);
+    memcpy(sha->bloco, p, tamanho);
+    sha->usado = tamanho;
+}
+
+void concluir_sha256(Sha256 *sha, unsigned char resumo[TAMANHO_CHAVE_CACHE]) {
+    uint64_t bits = sha->total * 8;
+    unsigned char preenchimento[72] = { 0x80 };
+    size_t n = (sha->usado < 56 ? 56 : 120) - sha->usado;
+    for (int i = 0; i < 8; i++) preenchimento[n + i] = (unsigned char)(bits >> (56 - 8 * i));
+    atualizar_sha256(sha, preenchimento, n + 8);
+    for (int i = 0; i < 8; i++) {
+        resumo[4 * i] = (unsigned char)(sha->estado[i] >> 24);
+        resumo[4 * i + 1] = (unsigned char)(sha->estado[i] >> 16);
+        resumo[4 * i + 2] = (unsigned char)(sha->estado[i] >> 8);
+        resumo[4 * i + 3] = (unsigned char)sha->estado[i];
+    }
+}
+
+static unsigned char identidade_compilador[TAMANHO_CHAVE_CACHE];
+static pthread_once_t identidade_calculada = PTHREAD_ONCE_INIT;
+
+// Sem /proc, a data da compilacao deste arquivo faz o papel de versao
+static void calcular_identidade(void) {
+    Sha256 sha;
+    iniciar_sha256(&sha);
+    ArquivoFonte executavel;
+    if (abrir_fonte(&executavel, "/proc/self/exe") == 0) {
+        atualizar_sha256(&sha, executavel.dados, executavel.tamanho);
+        fechar_fonte(&executavel);
+    } else {
+        static const char compilacao[] = __DATE__ " " __TIME__;
+        atualizar_sha256(&sha, compilacao, sizeof(compilacao));
+    }
+    concluir_sha256(&sha, identidade_compilador);
+}
+
+void iniciar_chave_cache(Sha256 *chave) {
+    pthread_once(&identidade_calculada, calcular_identidade);
+    iniciar_sha256(chave);
+    const unsigned char versao = VERSAO_ENTRADA_CACHE;
+    atualizar_sha256(chave, &versao, 1);
+    atualizar_sha256(chave, identidade_compilador, sizeof(identidade_compilador));
+}
+
+// diretorio/<chave em hexadecimal>, em malloc
+static char *caminho_entrada(const CacheCompilacao *cache, const unsigned char chave[TAMANHO_CHAVE_CACHE]) {
+    static const char hexadecimal[] = "0123456789abcdef";
+    size_t tamanho_diretorio = strlen(cache->diretorio);
+    char *caminho = malloc(tamanho_diretorio + 1 + TAMANHO_NOME_CACHE + 1);
+    if (!caminho) return NULL;
+    memcpy(caminho, cache->diretorio, tamanho_diretorio);
+    char *nome = caminho + tamanho_diretorio;
+    *nome++ = '/';
+    for (int i = 0; i < TAMANHO_CHAVE_CACHE; i++) {
+        *nome++ = hexadecimal[chave[i] >> 4];
+        *nome++ = hexadecimal[chave[i] & 15];
+    }
+    *nome = '\0';
+    return caminho;
+}
+
+static void escrever_u64(unsigned char *destino, uint64_t valor) {
+    for (int i = 0; i < 8; i++) destino[i] = (unsigned char)(valor >> (8 * i));
+}
+
+static uint64_t ler_u64(const unsigned char *origem) {
+    uint64_t valor = 0;
+    for (int i = 0; i < 8; i++) valor |= (uint64_t)origem[i] << (8 * i);
+    return valor;
+}
+
+int ler_cache(const CacheCompilacao *cache, const unsigned char chave[TAMANHO_CHAVE_CACHE], EntradaCache *entrada) {
+    char *caminho = caminho_entrada(cache, chave);
+    if (!caminho) return 0;
+    if (abrir_fonte(&entrada->arquivo, caminho) != 0) {
+        free(caminho);
+        return 0;
+    }
+
+    const unsigned char *cabecalho = (const unsigned char *)entrada->arquivo.dados;
+    size_t tamanho = entrada->arquivo.tamanho;
+    int valida = tamanho >= TAMANHO_CABECALHO_CACHE && memcmp(cabecalho, "MEPC", 4) == 0 &&
+                 cabecalho[4] == VERSAO_ENTRADA_CACHE && memcmp(cabecalho + 8, chave, TAMANHO_CHAVE_CACHE) == 0 &&
+                 ler_u64(cabecalho + 8 + TAMANHO_CHAVE_CACHE) == tamanho - TAMANHO_CABECALHO_CACHE;
+    if (valida) {
+        // O resumo pega a entrada que chegou inteira ao nome, mas nao ao disco, antes de uma queda
+        unsigned char resumo[TAMANHO_CHAVE_CACHE];
+        Sha256 sha;
+        iniciar_sha256(&sha);
+        atualizar_sha256(&sha, cabecalho + TAMANHO_CABECALHO_CACHE, tamanho - TAMANHO_CABECALHO_CACHE);
+        concluir_sha256(&sha, resumo);
+        valida = memcmp(resumo, cabecalho + 16 + TAMANHO_CHAVE_CACHE, TAMANHO_CHAVE_CACHE) == 0;
+    }
+    if (!valida) {
+        fechar_fonte(&entrada->arquivo);
+        free(caminho);
+        return 0;
+    }
+
+    utimensat(AT_FDCWD, caminho, NULL, 0);
+    free(caminho);
+    entrada->dados = entrada->arquivo.dados + TAMANHO_CABECALHO_CACHE;
+    entrada->tamanho = tamanho - TAMANHO_CABECALHO_CACHE;
+    return 1;
+}
+
+void fechar_entrada_cache(EntradaCache *entrada) {
+    fechar_fonte(&entrada->arquivo);
+}
+
+static int escrever_tudo(int fd, const void *dados, size_t tamanho) {
+    const char *p = dados;
+    while (tamanho > 0) {
+        ssize_t escritos = write(fd, p, tamanho);
+        if (escritos < 0 && errno == EINTR) continue;
+        if (escritos <= 0) return -1;
+        p += escritos;
+        tamanho -= (size_t)escritos;
+    }
+    return 0;
+}
+
+typedef struct {
+    char nome[TAMANHO_NOME_CACHE + 1];
+    long long tamanho;
+    struct timespec modificacao;
+} ArquivoCache;
+
+static int nome_de_entrada(const char *nome) {
+    for (int i = 0; i < TAMANHO_NOME_CACHE; i++) {
+        if (!((nome[i] >= '0' && nome[i] <= '9') || (nome[i] >= 'a' && nome[i] <= 'f'))) return 0;
+    }
+    return nome[TAMANHO_NOME_CACHE] == '\0';
+}
+
+// Mais antigas primeiro
+static int comparar_modificacao(const void *a, const void *b) {
+    const ArquivoCache *x = a, *y = b;
+    if (x->modificacao.tv_sec != y->modificacao.tv_sec) return x->modificacao.tv_sec < y->modificacao.tv_sec ? -1 : 1;
+    if (x->modificacao.tv_nsec != y->modificacao.tv_nsec) return x->modificacao.tv_nsec < y->modificacao.tv_nsec ? -1 : 1;
+    return strcmp(x->nome, y->nome);
+}
+
+// Outro processo pode estar despejando ao mesmo tempo: arquivos que somem no caminho sao
+// ignorados, e quem ja abriu uma entrada removida continua lendo o arquivo
+static void despejar(const CacheCompilacao *cache) {
+    DIR *diretorio = opendir(cache->diretorio);
+    if (!diretorio) return;
+    int fd = dirfd(diretorio);
+    time_t agora = time(NULL);
+
+    ArquivoCache *arquivos = NULL;
+    size_t num_arquivos = 0, capacidade = 0;
+    long long total = 0;
+    struct dirent *item;
+    while ((item = readdir(diretorio)) != NULL) {
+        struct stat info;
+        if (strncmp(item->d_name, ".tmp-", 5) == 0) {
+            if (fstatat(fd, item->d_name, &info, AT_SYMLINK_NOFOLLOW) == 0 &&
+                agora - info.st_mtime > IDADE_TEMPORARIO_ABANDONADO) {
+                unlinkat(fd, item->d_name, 0);
+            }
+            continue;
+        }
+        if (!nome_de_entrada(item->d_name) || fstatat(fd, item->d_name, &info, AT_SYMLINK_NOFOLLOW) != 0 ||
+            !S_ISREG(info.st_mode)) {
+            continue;
+        }
+        if (num_arquivos == capacidade) {
+            capacidade = capacidade ? capacidade * 2 : 256;
+            ArquivoCache *novos = realloc(arquivos, capacidade * sizeof(ArquivoCache));
+            if (!novos) break;
+            arquivos = novos;
+        }
+        ArquivoCache *arquivo = &arquivos[num_arquivos++];
+        memcpy(arquivo->nome, item->d_name, sizeof(arquivo->nome));
+        arquivo->tamanho = (long long)info.st_size;
+        arquivo->modificacao = info.st_mtim;
+        total += arquivo->tamanho;
+    }
+
+    if (total > cache->limite) {
+        qsort(arquivos, num_arquivos, sizeof(ArquivoCache), comparar_modificacao);
+        for (size_t i = 0; i < num_arquivos && total > cache->limite; i++) {
+            unlinkat(fd, arquivos[i].nome, 0);
+            total -= arquivos[i].tamanho;
+        }
+    }
+    free(arquivos);
+    closedir(diretorio);
+}
+
+int gravar_cache(const CacheCompilacao *cache, const unsigned char chave[TAMANHO_CHAVE_CACHE],
+                 const void *dados, size_t tamanho) {
+    if (mkdir(cache->diretorio, 0777) != 0 && errno != EEXIST) return -1;
+    char *caminho = caminho_entrada(cache, chave);
+    size_t tamanho_diretorio = strlen(cache->diretorio);
+    char *temporario = malloc(tamanho_diretorio + sizeof("/.tmp-XXXXXX"));
+    if (!caminho || !temporario) {
+        free(caminho);
+        free(temporario);
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(temporario, cache->diretorio, tamanho_diretorio);
+    strcpy(temporario + tamanho_diretorio, "/.tmp-XXXXXX");
+
+    unsigned char cabecalho[TAMANHO_CABECALHO_CACHE] = { 'M', 'E', 'P', 'C', VERSAO_ENTRADA_CACHE };
+    memcpy(cabecalho + 8, chave, TAMANHO_CHAVE_CACHE);
+    escrever_u64(cabecalho + 8 + TAMANHO_CHAVE_CACHE, tamanho);
+    Sha256 sha;
+    iniciar_sha256(&sha);
+    atualizar_sha256(&sha, dados, tamanho);
+    concluir_sha256(&sha, cabecalho + 16 + TAMANHO_CHAVE_CACHE);
+
+    int resultado = -1;
+    int fd = mkstemp(temporario);
+    if (fd >= 0) {
+        // mkstemp cria com 0600; a entrada pode ser lida por quem mais usar o diretorio
+        int erro = fchmod(fd, 0644) != 0 || escrever_tudo(fd, cabecalho, sizeof(cabecalho)) != 0 ||
+                   escrever_tudo(fd, dados, tamanho) != 0;
+        erro |= close(fd) != 0;
+        // rename troca o nome de uma vez: um leitor ve a entrada antiga, nenhuma ou a nova inteira
+        if (!erro && rename(temporario, caminho) == 0) {
+            resultado = 0;
+        } else {
+            int salvo = errno;
+            unlink(temporario);
+            errno = salvo;
+        }
+    }
+    free(temporario);
+    free(caminho);
+    if (resultado == 0) despejar(cache);
+    return resultado;
+}
@@ -0,0 +1,56 @@
+#ifndef CACHE_COMPILACAO_H
+#define CACHE_COMPILACAO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fonte.h"
+
+// Cache de compilacao em disco, enderecado pelo conteudo: cada entrada e um arquivo com o
+// nome do SHA-256 (em hexadecimal) da chave, que cobre o compilador, as opcoes e o fonte.
+//   entrada: "MEPC" versao:u8 0 0 0  chave[32]  tamanho:u64 (little-endian)
+//            resumo[32] (SHA-256 dos dados)  dados[tamanho]
+// A gravacao e atomica (arquivo temporario + rename), entao varios processos podem usar o
+// mesmo diretorio. O acerto renova a data de modificacao, que e a ordem do despejo (LRU)
+#define TAMANHO_CHAVE_CACHE 32
+#define VERSAO_ENTRADA_CACHE 1
+#define LIMITE_CACHE_PADRAO (256LL << 20)
+
+typedef struct {
+    uint32_t estado[8];
+    uint64_t total;
+    unsigned char bloco[64];
+    size_t usado;
+} Sha256;
+
+void iniciar_sha256(Sha256 *sha);
+void atualizar_sha256(Sha256 *sha, const void *dados, size_t tamanho);
+void concluir_sha256(Sha256 *sha, unsigned char resumo[TAMANHO_CHAVE_CACHE]);
+
+// Comeca a chave de uma entrada com a identidade do compilador: o resumo do proprio
+// executavel (/proc/self/exe), calculado uma vez por processo, e a versao das entradas
+void iniciar_chave_cache(Sha256 *chave);
+
+typedef struct {
+    const char *diretorio;
+    long long limite;       // bytes; passando dele, as entradas mais antigas sao removidas
+} CacheCompilacao;
+
+// Dados de uma entrada lida; apontam para dentro do arquivo mapeado
+typedef struct {
+    ArquivoFonte arquivo;
+    const char *dados;
+    size_t tamanho;
+} EntradaCache;
+
+// Retorna 1 no acerto (feche com fechar_entrada_cache) e 0 se a entrada nao existe ou nao
+// confere (truncada, de outra versao ou corrompida)
+int ler_cache(const CacheCompilacao *cache, const unsigned char chave[TAMANHO_CHAVE_CACHE], EntradaCache *entrada);
+void fechar_entrada_cache(EntradaCache *entrada);
+
+// Grava a entrada, criando o diretorio se preciso, e despeja as menos usadas ate o total
+// caber no limite. Retorna 0 ou -1 (errno definido)
+int gravar_cache(const CacheCompilacao *cache, const unsigned char chave[TAMANHO_CHAVE_CACHE],
+                 const void *dados, size_t tamanho);
+
+#endif
@@ -0,0 +1,175 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "servidor_compilacao.h"
+
+// Cliente do compiladorparte2 --daemon: aceita a mesma linha de comando do compiladorparte2
+// e termina com o mesmo codigo de saida. Sem servidor no socket, executa o compilador
+
+static void executar_compilador(char *argv[]) {
+    const char *compilador = getenv(VARIAVEL_COMPILADOR);
+    if (compilador && *compilador) {
+        execv(compilador, argv);
+        perror(compilador);
+        exit(1);
+    }
+    // O compiladorparte2 do mesmo diretorio do cliente ou, sem diretorio no argv[0], do PATH
+    const char *barra = strrchr(argv[0], '/');
+    if (barra) {
+        size_t tamanho = (size_t)(barra - argv[0]) + 1;
+        char *caminho = malloc(tamanho + sizeof("compiladorparte2"));
+        if (!caminho) {
+            fprintf(stderr, "Erro: memoria insuficiente\n");
+            exit(1);
+        }
+        memcpy(caminho, argv[0], tamanho);
+        strcpy(caminho + tamanho, "compiladorparte2");
+        execv(caminho, argv);
+        perror(caminho);
+        exit(1);
+    }
+    execvp("compiladorparte2", argv);
+    perror("compiladorparte2");
+    exit(1);
+}
+
+static int conectar(void) {
+    struct sockaddr_un endereco;
+    memset(&endereco, 0, sizeof(endereco));
+    endereco.sun_family = AF_UNIX;
+    const char *caminho = getenv(VARIAVEL_SOCKET);
+    if (caminho && *caminho) {
+        int tamanho = snprintf(endereco.sun_path, sizeof(endereco.sun_path), "%s", caminho);
+        if (tamanho < 0 || (size_t)tamanho >= sizeof(endereco.sun_path)) return -1;
+    } else if (caminho_socket_padrao(endereco.sun_path, sizeof(endereco.sun_path), 0) != 0) {
+        return -1;
+    }
+
+    int conexao = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (conexao < 0) return -1;
+    if (connect(conexao, (struct sockaddr *)&endereco, sizeof(endereco)) != 0) {
+        close(conexao);
+        return -1;
+    }
+    return conexao;
+}
+
+static int escrever_tudo(int fd, const void *dados, size_t tamanho) {
+    const char *p = dados;
+    while (tamanho > 0) {
+        ssize_t escritos = write(fd, p, tamanho);
+        if (escritos < 0 && errno == EINTR) continue;
+        if (escritos <= 0) return -1;
+        p += escritos;
+        tamanho -= (size_t)escritos;
+    }
+    return 0;
+}
+
+// Envia a linha de comando; o cabecalho leva os descritores. Retorna 0 ou -1
+static int enviar_pedido(int conexao, int argc, char *argv[], const int descritores[DESCRITORES_PEDIDO]) {
+    size_t tamanho = 0;
+    for (int i = 0; i < argc; i++) tamanho += strlen(argv[i]) + 1;
+    if (tamanho > MAX_TAMANHO_PEDIDO) {
+        fprintf(stderr, "Erro: linha de comando longa demais para o servidor\n");
+        return -1;
+    }
+    char *texto = malloc(tamanho);
+    if (!texto) {
+        fprintf(stderr, "Erro: memoria insuficiente\n");
+        return -1;
+    }
+    char *p = texto;
+    for (int i = 0; i < argc; i++) {
+        size_t n = strlen(argv[i]) + 1;
+        memcpy(p, argv[i], n);
+        p += n;
+    }
+
+    mode_t mascara = umask(0);
+    umask(mascara);
+    CabecalhoPedido cabecalho = { (uint32_t)tamanho, (uint32_t)mascara, (uint32_t)argc };
+    union {
+        struct cmsghdr alinhamento;
+        char dados[CMSG_SPACE(sizeof(int) * DESCRITORES_PEDIDO)];
+    } controle;
+    memset(&controle, 0, sizeof(controle));
+    struct iovec vetor = { &cabecalho, sizeof(cabecalho) };
+    struct msghdr mensagem;
+    memset(&mensagem, 0, sizeof(mensagem));
+    mensagem.msg_iov = &vetor;
+    mensagem.msg_iovlen = 1;
+    mensagem.msg_control = controle.dados;
+    mensagem.msg_controllen = sizeof(controle.dados);
+    struct cmsghdr *anexo = CMSG_FIRSTHDR(&mensagem);
+    anexo->cmsg_level = SOL_SOCKET;
+    anexo->cmsg_type = SCM_RIGHTS;
+    anexo->cmsg_len = CMSG_LEN(sizeof(int) * DESCRITORES_PEDIDO);
+    memcpy(CMSG_DATA(anexo), descritores, sizeof(int) * DESCRITORES_PEDIDO);
+
+    ssize_t enviados;
+    do {
+        enviados = sendmsg(conexao, &mensagem, MSG_NOSIGNAL);
+    } while (enviados < 0 && errno == EINTR);
+    int resultado = enviados < 0 ? -1 : 0;
+    if (resultado == 0 && (size_t)enviados < sizeof(cabecalho)) {
+        resultado = escrever_tudo(conexao, (char *)&cabecalho + enviados, sizeof(cabecalho) - (size_t)enviados);
+    }
+    if (resultado == 0) resultado = escrever_tudo(conexao, texto, tamanho);
+    free(texto);
+    return resultado;
+}
+
+int main(int argc, char *argv[]) {
+    // Descritor padrao fechado vai como /dev/null; antes de conectar, para o socket nao
+    // ocupar o numero dele
+    int descritores[DESCRITORES_PEDIDO];
+    for (int i = 0; i < 3; i++) {
+        descritores[i] = fcntl(i, F_GETFD) != -1 ? i : open("/dev/null", i == 0 ? O_RDONLY : O_WRONLY);
+    }
+    descritores[3] = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (descritores[3] < 0) {
+        perror("Erro ao abrir o diretorio atual");
+        return 1;
+    }
+    for (int i = 0; i < DESCRITORES_PEDIDO; i++) {
+        if (descritores[i] < 0) {
+            perror("Erro ao abrir /dev/null");
+            return 1;
+        }
+    }
+
+    int conexao = conectar();
+    if (conexao < 0) executar_compilador(argv);
+    // Os descritores dao acesso ao terminal e aos arquivos: so vao para um servidor do mesmo usuario
+    if (!mesmo_usuario(conexao)) {
+        fprintf(stderr, "Erro: o servidor de compilacao no socket e de outro usuario\n");
+        return 1;
+    }
+    if (enviar_pedido(conexao, argc, argv, descritores) != 0) {
+        fprintf(stderr, "Erro ao enviar o pedido ao servidor de compilacao: %s\n", strerror(errno));
+        return 1;
+    }
+    int32_t status;
+    size_t lidos = 0;
+    while (lidos < sizeof(status)) {
+        ssize_t n = read(conexao, (char *)&status + lidos, sizeof(status) - lidos);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            fprintf(stderr, "Erro: o servidor de compilacao encerrou a conexao\n");
+            return 1;
+        }
+        lidos += (size_t)n;
+    }
+    close(conexao);
+    return status;
+}
@@ -1,488 +1,2021 @@
+// unshare(CLONE_FS) no modo servidor
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
 
-#define TAMANHO_MAX_LEXEMA 16
-#define TAMANHO_TABELA_SIMBOLOS 100
+#include "fonte.h"
+#include "lexico.h"
+#include "lexico_paralelo.h"
+#include "tabela_simbolos.h"
+#include "arena.h"
+#include "ast.h"
+#include "ir.h"
+#include "mepa.h"
+#include "maquina_mepa.h"
+#include "gerador_x86_64.h"
+#include "otimizador.h"
+#include "constantes.h"
+#include "lacos.h"
+#include "vivacidade.h"
+#include "estatisticas.h"
+#include "perfil_mepa.h"
+#include "cache_compilacao.h"
+#include "servidor_compilacao.h"
+#include "anel_lotes.h"
+#include "memoria.h"
 
-//Tipos de token possiveis pro compilador
+//Erros por arquivo ate a analise desistir (--max-errors)
+#define LIMITE_ERROS_PADRAO 20
+
+//Formatos de saida do codigo gerado
 typedef enum {
-    TOKEN_PROGRAM, TOKEN_ID, TOKEN_INTEIRO, TOKEN_BOOLEANO,
-    TOKEN_INICIO, TOKEN_FIM, TOKEN_LEIA, TOKEN_ESCREVA, TOKEN_SE,
-    TOKEN_SENAOSE, TOKEN_FOR, TOKEN_SET, TOKEN_ATE, TOKEN_DE,
-    TOKEN_NUMERO, TOKEN_SIMBOLO, TOKEN_ERRO, TOKEN_EOF,
-    TOKEN_PONTO_VIRGULA, TOKEN_ABRE_PARENTESES, TOKEN_FECHA_PARENTESES,
-    TOKEN_MULTIPLICACAO, TOKEN_DOIS_PONTOS
-} TipoToken;
+    SAIDA_TEXTO, SAIDA_BINARIA, SAIDA_ASSEMBLY, SAIDA_EXECUTAVEL, SAIDA_IR, SAIDA_TOKENS
+} FormatoSaida;
+
+typedef struct FluxoCompilacao FluxoCompilacao;
 
+//Estado de uma compilacao: cada arquivo usa o seu, entao varios podem ser compilados em paralelo
 typedef struct {
-    TipoToken tipo;
-    char lexema[TAMANHO_MAX_LEXEMA];
-    int linha;
-    union {
-        int valor_inteiro;
-        char str_valor[TAMANHO_MAX_LEXEMA];
-    } valor;
-} Token;
+    ArquivoFonte fonte;
+    AnalisadorLexico lexico;
+    TokensParalelos tokens_paralelos;
+    int lexico_paralelo;                   // --lex-threads: tokens lidos de tokens_paralelos
+    FluxoCompilacao *fluxo;                // --stream: tokens da fila do lexico, codigo gerado por comando
+    Token token_atual;
+    int proximo_endereco;
+    PoolIdentificadores pool_identificadores;
+    TabelaSimbolos tabela_simbolos;
+    Arena arena;
+    ProgramaAst programa;
+    CodigoIR ir;
+    CodigoMepa codigo;
+    FILE *diagnosticos;
+    const char *prefixo_diagnostico;
+    const char *arquivo_diagnostico;       // campo "arquivo" dos diagnosticos em JSON
+    int diagnosticos_json;                 // cada linha de diagnostico vira um objeto JSON
+    jmp_buf recuperacao_erro;              // abandona o arquivo
+    jmp_buf sincronizacao;                 // modo panico: volta ao inicio da regiao em analise
+    int sincronizacao_ativa;
+    int num_erros;
+    int limite_erros;                      // 0 sem limite
+    EstatisticasCompilacao *estatisticas;  // NULL sem --stats
+} ContextoCompilador;
 
+//Formato do relatorio de --stats
+typedef enum {
+    ESTATISTICAS_DESLIGADAS, ESTATISTICAS_TEXTO, ESTATISTICAS_JSON
+} FormatoEstatisticas;
+
+//Opcoes da linha de comando que valem para todos os arquivos
 typedef struct {
-    char identificador[TAMANHO_MAX_LEXEMA];
-    int endereco;
-} SimboloTabela;
-
-// Variáveis globais
-FILE *arquivo_fonte;
-int linha_atual = 1;
-char caractere_atual;
-Token token_atual;
-int proximo_endereco = 0;
-static int rotulo_atual = 1;
-SimboloTabela tabela_simbolos[TAMANHO_TABELA_SIMBOLOS];
-int num_simbolos = 0;
+    FormatoSaida formato;
+    int executar;
+    int nivel_otimizacao;
+    int fator_desenrolar;          // --unroll=N, usado em -O2
+    int relatorio_otimizacao;
+    FormatoEstatisticas estatisticas;
+    int perfil;                    // --profile: conta as instrucoes executadas por --run
+    const char *caminho_pilhas;    // --profile=arquivo: pilhas para o flamegraph.pl
+    int desvios_absolutos;         // --labels=absolute: desvios para indices, sem NADA
+    CacheCompilacao cache;         // --cache=dir e --cache-size=N; diretorio NULL desliga
+    int limite_erros;              // --max-errors=N; 0 sem limite
+    int diagnosticos_json;         // --diagnostics=json
+    int threads_lexico;            // --lex-threads=N; 1 analisa o fonte em sequencia
+    int fluxo;                     // --stream
+    FILE *entrada;                 // stdin, stdout e stderr da invocacao; no modo servidor,
+    FILE *saida;                   // os do cliente
+    FILE *erros;
+} OpcoesCompilacao;
+
+//--stream: lexico, analise e escrita em tres threads ligadas por duas filas de lotes de
+//tamanho fixo. A memoria nao cresce com o fonte: as filas sao alocadas no inicio, a arvore
+//e o codigo de cada comando sao descartados depois de enviados e as paginas do fonte ja
+//lidas sao devolvidas ao sistema
+#define TOKENS_POR_LOTE 4096
+#define INSTRUCOES_POR_LOTE 8192
+#define LOTES_POR_FILA 8
+#define TAMANHO_ESCRITA_FLUXO (1 << 20)
+
+typedef struct {
+    int num_tokens;
+    Token tokens[TOKENS_POR_LOTE];
+} LoteTokens;
+
+typedef struct {
+    int num_instrucoes;
+    int ultimo;                    // o fim do programa: a escrita para depois dele
+    InstrucaoMepa instrucoes[INSTRUCOES_POR_LOTE];
+} LoteInstrucoes;
+
+struct FluxoCompilacao {
+    AnelLotes tokens;
+    AnelLotes instrucoes;
+    AnalisadorLexico lexico;       // o da thread do lexico
+    const ArquivoFonte *fonte;
+    // Lado da analise
+    LoteTokens *lote_tokens;       // NULL antes do primeiro
+    int proximo_token;
+    uint32_t inicio_lote;          // posicao do primeiro token de lote_tokens
+    int fim_alcancado;
+    Token fim_arquivo;
+    LoteInstrucoes *lote_saida;    // em montagem; NULL se nenhum
+    int falhou;                    // erro interno na geracao
+    // Lado da escrita
+    FILE *escrita;
+    int erro_escrita;
+    // --stats: cada thread mede o seu trabalho, sem as esperas nas filas
+    const EstatisticasCompilacao *estatisticas;
+    uint64_t ciclos_lexico;
+    uint64_t ciclos_escrita;
+};
 
 // Protótipos
-void avancar_caractere();
-void ignorar_espacos_e_comentarios();
-Token obter_proximo_token();
-void erro_sintatico(const char *esperado);
-TipoToken verificar_palavra_reservada(const char *lexema);
-void funcao_for();
-void funcao_set();
-void funcao_read();
-void funcao_write();
-void declaracao_variaveis();
-int busca_tabela_simbolos(const char *id);
-void inserir_simbolo(const char *id);
-int proximo_rotulo(void);
-int converter_binario(const char* str);
-void funcao_composto();
-
-// Avança para o próximo caractere no arquivo fonte e atualiza a contagem de linhas
-void avancar_caractere() {
-    caractere_atual = fgetc(arquivo_fonte);
-    if (caractere_atual == '\n') {
-        linha_atual++;
-    }
-}
-
-// Ignora espaços em branco e comentários (# para linha única, {-} para múltiplas linhas)
-void ignorar_espacos_e_comentarios() {
-    while (isspace(caractere_atual) || caractere_atual == '#' || caractere_atual == '{') {
-        if (caractere_atual == '#') {
-            while (caractere_atual != '\n' && caractere_atual != EOF) {
-                avancar_caractere();
-            }
-        } else if (caractere_atual == '{') {
-            avancar_caractere();
-            while (caractere_atual != EOF) {
-                if (caractere_atual == '-' && fgetc(arquivo_fonte) == '}') {
-                    avancar_caractere();
-                    break;
-                }
-                if (caractere_atual == '\n') linha_atual++;
-                avancar_caractere();
-            }
+Token obter_proximo_token(ContextoCompilador *ctx);
+void erro_sintatico(ContextoCompilador *ctx, const char *esperado);
+void erro_lexico(ContextoCompilador *ctx, Token token);
+NoAst *funcao_for(ContextoCompilador *ctx);
+NoAst *funcao_set(ContextoCompilador *ctx);
+NoAst *funcao_read(ContextoCompilador *ctx);
+NoAst *funcao_write(ContextoCompilador *ctx);
+void declaracao_variaveis(ContextoCompilador *ctx);
+int busca_tabela_simbolos(ContextoCompilador *ctx, int id);
+void inserir_simbolo(ContextoCompilador *ctx, int id);
+NoAst *funcao_composto(ContextoCompilador *ctx);
+
+//Token da fila do lexico; depois do TOKEN_EOF, ele de novo. Ao passar para o lote seguinte,
+//as paginas do fonte antes do lote que acabou de ser lido sao devolvidas
+static Token proximo_token_fluxo(FluxoCompilacao *fluxo) {
+    if (fluxo->fim_alcancado) return fluxo->fim_arquivo;
+    if (!fluxo->lote_tokens || fluxo->proximo_token == fluxo->lote_tokens->num_tokens) {
+        if (fluxo->lote_tokens) {
+            descartar_inicio_fonte(fluxo->fonte, fluxo->inicio_lote);
+            devolver_lote(&fluxo->tokens);
         }
-        avancar_caractere();
+        fluxo->lote_tokens = lote_para_ler(&fluxo->tokens);
+        fluxo->proximo_token = 0;
+        fluxo->inicio_lote = fluxo->lote_tokens->tokens[0].inicio;
     }
-}
-//Converte em decimal os valores em binario
-int converter_binario(const char* str) {
-    str += 2; 
-    int resultado = 0;
-    while (*str) {
-        resultado = (resultado << 1) + (*str - '0');
-        str++;
+    Token token = fluxo->lote_tokens->tokens[fluxo->proximo_token++];
+    if (token.tipo == TOKEN_EOF) {
+        fluxo->fim_alcancado = 1;
+        fluxo->fim_arquivo = token;
     }
-    return resultado;
+    return token;
 }
-// Verifica se um lexema é uma palavra reservada da linguagem
-TipoToken verificar_palavra_reservada(const char *lexema) {
-    if (strcmp(lexema, "program") == 0) return TOKEN_PROGRAM;
-    if (strcmp(lexema, "integer") == 0) return TOKEN_INTEIRO;
-    if (strcmp(lexema, "begin") == 0) return TOKEN_INICIO;
-    if (strcmp(lexema, "end") == 0) return TOKEN_FIM;
-    if (strcmp(lexema, "read") == 0) return TOKEN_LEIA;
-    if (strcmp(lexema, "write") == 0) return TOKEN_ESCREVA;
-    if (strcmp(lexema, "for") == 0) return TOKEN_FOR;
-    if (strcmp(lexema, "set") == 0) return TOKEN_SET;
-    if (strcmp(lexema, "to") == 0) return TOKEN_ATE;
-    if (strcmp(lexema, "of") == 0) return TOKEN_DE;
-    return TOKEN_ID;
-}
-// Obtém o próximo token do arquivo fonte
-Token obter_proximo_token() {
-    Token token;
-    token.linha = linha_atual;
-    ignorar_espacos_e_comentarios();
 
-    if (caractere_atual == EOF) {
-        token.tipo = TOKEN_EOF;
-        strcpy(token.lexema, "EOF");
-        return token;
+// Próximo token do analisador comum; identificadores ja saem internados
+Token obter_proximo_token(ContextoCompilador *ctx) {
+    EstatisticasCompilacao *estatisticas = ctx->estatisticas;
+    // Ler o contador a cada token custaria quase o mesmo que o proprio lexico: so um por amostra.
+    // Em fluxo o lexico e medido na thread dele
+    int medir = estatisticas && !ctx->fluxo && estatisticas->amostra_lexico++ % AMOSTRA_LEXICO == 0;
+    uint64_t inicio = medir ? ler_ciclos() : 0;
+    Token token = ctx->lexico_paralelo ? proximo_token_paralelo(&ctx->tokens_paralelos)
+                : ctx->fluxo           ? proximo_token_fluxo(ctx->fluxo)
+                                       : proximo_token(&ctx->lexico);
+    if (token.tipo == TOKEN_ID) {
+        token.valor.id_identificador = internar_identificador(&ctx->pool_identificadores,
+                                                        texto_token(&ctx->lexico, token), token.tamanho);
+    }
+    if (estatisticas) {
+        if (medir) estatisticas->ciclos[FASE_LEXICO] += ciclos_desde(estatisticas, inicio) * AMOSTRA_LEXICO;
+        estatisticas->tokens[token.tipo]++;
     }
+    if (token.tipo == TOKEN_ERRO) {
+        // A analise segue com o numero valendo 0
+        erro_lexico(ctx, token);
+        token.tipo = TOKEN_NUMERO;
+        token.valor.valor_inteiro = 0;
+    }
+    return token;
+}
 
-    if (isalpha(caractere_atual)) {
-        int i = 0;
-        while (isalnum(caractere_atual) || caractere_atual == '_') {
-            if (i < TAMANHO_MAX_LEXEMA - 1) {
-                token.lexema[i++] = caractere_atual;
-            }
-            avancar_caractere();
+//Escreve um texto como string JSON, com aspas
+static void escrever_texto_json(FILE *saida, const char *texto, size_t tamanho) {
+    putc('"', saida);
+    for (size_t i = 0; i < tamanho; i++) {
+        unsigned char c = (unsigned char)texto[i];
+        if (c == '"' || c == '\\') {
+            putc('\\', saida);
+            putc(c, saida);
+        } else if (c == '\n') {
+            fputs("\\n", saida);
+        } else if (c == '\t') {
+            fputs("\\t", saida);
+        } else if (c < 0x20) {
+            fprintf(saida, "\\u%04x", c);
+        } else {
+            putc(c, saida);
         }
-        token.lexema[i] = '\0';
-        token.tipo = verificar_palavra_reservada(token.lexema);
-        return token;
     }
+    putc('"', saida);
+}
 
-    if (caractere_atual == '0' && (fgetc(arquivo_fonte) == 'b' || fgetc(arquivo_fonte) == 'B')) {
-        avancar_caractere();
-        avancar_caractere();
-        int i = 0;
-        while (caractere_atual == '0' || caractere_atual == '1') {
-            if (i < TAMANHO_MAX_LEXEMA - 1) {
-                token.lexema[i++] = caractere_atual;
-            }
-            avancar_caractere();
-        }
-        token.lexema[i] = '\0';
-        token.tipo = TOKEN_NUMERO;
-        return token;
+//Uma linha de diagnostico sem prefixo ("12:erro sintatico, ...", "Erro ao ...").
+//Em JSON vira {"arquivo", "linha", "gravidade", "mensagem"}; linha 0 se o texto nao tem
+static void emitir_diagnostico(ContextoCompilador *ctx, const char *texto, size_t tamanho) {
+    if (!ctx->diagnosticos_json) {
+        fputs(ctx->prefixo_diagnostico, ctx->diagnosticos);
+        fwrite(texto, 1, tamanho, ctx->diagnosticos);
+        return;
     }
+    if (tamanho > 0 && texto[tamanho - 1] == '\n') tamanho--;
+    long linha = 0;
+    size_t i = 0;
+    while (i < tamanho && i < 10 && isdigit((unsigned char)texto[i])) linha = linha * 10 + (texto[i++] - '0');
+    if (i > 0 && i < tamanho && texto[i] == ':') {
+        texto += i + 1;
+        tamanho -= i + 1;
+    } else {
+        linha = 0;
+    }
+    const char *gravidade = tamanho >= 5 && strncmp(texto, "aviso", 5) == 0 ? "aviso"
+                          : tamanho >= 4 && strncasecmp(texto, "erro", 4) == 0 ? "erro" : "nota";
+    FILE *saida = ctx->diagnosticos;
+    fputs("{\"arquivo\": ", saida);
+    escrever_texto_json(saida, ctx->arquivo_diagnostico, strlen(ctx->arquivo_diagnostico));
+    fprintf(saida, ", \"linha\": %ld, \"gravidade\": \"%s\", \"mensagem\": ", linha, gravidade);
+    escrever_texto_json(saida, texto, tamanho);
+    fputs("}\n", saida);
+}
 
-    if (isdigit(caractere_atual)) {
-        int i = 0;
-        while (isdigit(caractere_atual)) {
-            if (i < TAMANHO_MAX_LEXEMA - 1) {
-                token.lexema[i++] = caractere_atual;
-            }
-            avancar_caractere();
-        }
-        token.lexema[i] = '\0';
-        token.tipo = TOKEN_NUMERO;
-        return token;
+//Repete mensagens guardadas sem prefixo, uma linha por vez, no formato do contexto
+static void repetir_diagnosticos(ContextoCompilador *ctx, const char *mensagens, size_t tamanho) {
+    while (tamanho > 0) {
+        const char *fim_linha = memchr(mensagens, '\n', tamanho);
+        size_t n = fim_linha ? (size_t)(fim_linha - mensagens) + 1 : tamanho;
+        emitir_diagnostico(ctx, mensagens, n);
+        mensagens += n;
+        tamanho -= n;
     }
+}
 
-    token.lexema[0] = caractere_atual;
-    token.lexema[1] = '\0';
+//Escreve no destino de diagnosticos do contexto; no modo em lote a mensagem leva o nome do arquivo
+static void reportar_erro(ContextoCompilador *ctx, const char *formato, ...) {
+    va_list argumentos;
+    if (!ctx->diagnosticos_json) {
+        fputs(ctx->prefixo_diagnostico, ctx->diagnosticos);
+        va_start(argumentos, formato);
+        vfprintf(ctx->diagnosticos, formato, argumentos);
+        va_end(argumentos);
+        return;
+    }
+    char buffer[512];
+    char *texto = buffer;
+    va_start(argumentos, formato);
+    int tamanho = vsnprintf(buffer, sizeof(buffer), formato, argumentos);
+    va_end(argumentos);
+    if (tamanho < 0) return;
+    if ((size_t)tamanho >= sizeof(buffer)) {
+        texto = malloc((size_t)tamanho + 1);
+        if (!texto) return;
+        va_start(argumentos, formato);
+        vsnprintf(texto, (size_t)tamanho + 1, formato, argumentos);
+        va_end(argumentos);
+    }
+    repetir_diagnosticos(ctx, texto, (size_t)tamanho);
+    if (texto != buffer) free(texto);
+}
 
-    switch (caractere_atual) {
-        case ';': token.tipo = TOKEN_PONTO_VIRGULA; break;
-        case '(': token.tipo = TOKEN_ABRE_PARENTESES; break;
-        case ')': token.tipo = TOKEN_FECHA_PARENTESES; break;
-        case '*': token.tipo = TOKEN_MULTIPLICACAO; break;
-        case ':': token.tipo = TOKEN_DOIS_PONTOS; break;
-        default: token.tipo = TOKEN_SIMBOLO;
+//Conta um erro ja reportado; no limite de --max-errors abandona o arquivo
+static void contar_erro(ContextoCompilador *ctx) {
+    ctx->num_erros++;
+    if (ctx->limite_erros > 0 && ctx->num_erros >= ctx->limite_erros) {
+        reportar_erro(ctx, "erro: %d erros, analise interrompida\n", ctx->num_erros);
+        longjmp(ctx->recuperacao_erro, 1);
     }
+}
 
-    avancar_caractere();
-    return token;
+//Printa o erro sem sair do lugar: quem chama segue como se o esperado estivesse la
+static void reportar_erro_sintatico(ContextoCompilador *ctx, const char *esperado) {
+    Token token = ctx->token_atual;
+    if (token.tipo == TOKEN_EOF) {
+        reportar_erro(ctx, "%d:erro sintatico, esperado [%s] encontrado [EOF]\n", token.linha, esperado);
+    } else {
+        reportar_erro(ctx, "%d:erro sintatico, esperado [%s] encontrado [%.*s]\n",
+                      token.linha, esperado, (int)token.tamanho, texto_token(&ctx->lexico, token));
+    }
+    contar_erro(ctx);
+    // No fim do arquivo nao ha o que sincronizar: os proximos erros so repetiriam este
+    if (token.tipo == TOKEN_EOF) longjmp(ctx->recuperacao_erro, 1);
 }
-//Printa se encontrar um erro e quebra o codigo
-void erro_sintatico(const char *esperado) {
-    fprintf(stderr, "%d:erro sintatico, esperado [%s] encontrado [%s]\n", 
-            linha_atual, esperado, token_atual.lexema);
-    fclose(arquivo_fonte);
-    exit(1);
+//Printa se encontrar um erro e volta ao inicio da regiao em analise, que descarta tokens
+//ate um ponto de sincronizacao (modo panico)
+void erro_sintatico(ContextoCompilador *ctx, const char *esperado) {
+    reportar_erro_sintatico(ctx, esperado);
+    if (!ctx->sincronizacao_ativa) longjmp(ctx->recuperacao_erro, 1);
+    longjmp(ctx->sincronizacao, 1);
 }
-// Busca um identificador na tabela de símbolos e retorna seu endereço
-int busca_tabela_simbolos(const char *id) {
-    for (int i = 0; i < num_simbolos; i++) {
-        if (strcmp(tabela_simbolos[i].identificador, id) == 0) {
-            return tabela_simbolos[i].endereco;
+//Descarta tokens ate o proximo ; (consumido), begin, end, integer ou comando. Cada regiao
+//com sincronizacao so chama depois de consumir algum token, entao a analise sempre avanca
+static void sincronizar(ContextoCompilador *ctx) {
+    for (;;) {
+        switch (ctx->token_atual.tipo) {
+            case TOKEN_PONTO_VIRGULA:
+                ctx->token_atual = obter_proximo_token(ctx);
+                return;
+            case TOKEN_INICIO:
+            case TOKEN_FIM:
+            case TOKEN_EOF:
+            case TOKEN_INTEIRO:
+            case TOKEN_LEIA:
+            case TOKEN_ESCREVA:
+            case TOKEN_FOR:
+            case TOKEN_SET:
+                return;
+            default:
+                ctx->token_atual = obter_proximo_token(ctx);
         }
     }
-    fprintf(stderr, "%d:erro semantico, identificador [%s] nao declarado\n", 
-            linha_atual, id);
-    exit(1);
 }
-//Salva na tabela de simbolos
-void inserir_simbolo(const char *id) {
-    for (int i = 0; i < num_simbolos; i++) {
-        if (strcmp(tabela_simbolos[i].identificador, id) == 0) {
-            fprintf(stderr, "%d:erro semantico, identificador [%s] ja declarado\n", 
-                    linha_atual, id);
-            exit(1);
-        }
+//O lexico so produz TOKEN_ERRO para um numero que nao cabe em 32 bits
+void erro_lexico(ContextoCompilador *ctx, Token token) {
+    reportar_erro(ctx, "%d:erro lexico, numero [%.*s] fora do intervalo de 32 bits\n",
+                  token.linha, (int)token.tamanho, texto_token(&ctx->lexico, token));
+    contar_erro(ctx);
+}
+// Busca um identificador (id internado) na tabela de símbolos e retorna seu endereço
+int busca_tabela_simbolos(ContextoCompilador *ctx, int id) {
+    SimboloTabela *simbolo = procurar_simbolo(&ctx->tabela_simbolos, id);
+    if (simbolo) {
+        return simbolo->endereco;
     }
-    
-    if (num_simbolos >= TAMANHO_TABELA_SIMBOLOS) {
-        fprintf(stderr, "Erro: Tabela de símbolos cheia\n");
-        exit(1);
+    reportar_erro(ctx, "%d:erro semantico, identificador [%s] nao declarado\n", 
+                  ctx->token_atual.linha, texto_identificador(&ctx->pool_identificadores, id));
+    contar_erro(ctx);
+    // Entra na tabela para os proximos usos nao repetirem o erro
+    adicionar_simbolo(&ctx->tabela_simbolos, id, ctx->proximo_endereco);
+    return ctx->proximo_endereco++;
+}
+//Salva na tabela de simbolos
+void inserir_simbolo(ContextoCompilador *ctx, int id) {
+    if (!adicionar_simbolo(&ctx->tabela_simbolos, id, ctx->proximo_endereco)) {
+        reportar_erro(ctx, "%d:erro semantico, identificador [%s] ja declarado\n", 
+                      ctx->token_atual.linha, texto_identificador(&ctx->pool_identificadores, id));
+        contar_erro(ctx);
+        return;
     }
-    
-    strcpy(tabela_simbolos[num_simbolos].identificador, id);
-    tabela_simbolos[num_simbolos].endereco = proximo_endereco++;
-    num_simbolos++;
+    ctx->proximo_endereco++;
 }
 
-int proximo_rotulo(void) {
-    return rotulo_atual++;
+//Cria um no da AST na arena, na linha do token atual
+static NoAst *novo_no(ContextoCompilador *ctx, TipoNo tipo) {
+    return criar_no_ast(&ctx->arena, tipo, ctx->token_atual.linha);
 }
 
-void declaracao_variaveis() {
-    while (token_atual.tipo == TOKEN_INTEIRO) {
-        token_atual = obter_proximo_token();
-        if (token_atual.tipo != TOKEN_ID) {
-            erro_sintatico("identificador");
+void declaracao_variaveis(ContextoCompilador *ctx) {
+    // Erro numa declaracao: descarta o resto dela e segue com a proxima
+    if (setjmp(ctx->sincronizacao) != 0) {
+        sincronizar(ctx);
+    }
+    ctx->sincronizacao_ativa = 1;
+    while (ctx->token_atual.tipo == TOKEN_INTEIRO) {
+        ctx->token_atual = obter_proximo_token(ctx);
+        if (ctx->token_atual.tipo != TOKEN_ID) {
+            erro_sintatico(ctx, "identificador");
         }
-        inserir_simbolo(token_atual.lexema);
-        token_atual = obter_proximo_token();
+        inserir_simbolo(ctx, ctx->token_atual.valor.id_identificador);
+        ctx->token_atual = obter_proximo_token(ctx);
         
-        while (token_atual.tipo == TOKEN_SIMBOLO && token_atual.lexema[0] == ',') {
-            token_atual = obter_proximo_token();
-            if (token_atual.tipo != TOKEN_ID) {
-                erro_sintatico("identificador");
+        while (ctx->token_atual.tipo == TOKEN_VIRGULA) {
+            ctx->token_atual = obter_proximo_token(ctx);
+            if (ctx->token_atual.tipo != TOKEN_ID) {
+                erro_sintatico(ctx, "identificador");
             }
-            inserir_simbolo(token_atual.lexema);
-            token_atual = obter_proximo_token();
+            inserir_simbolo(ctx, ctx->token_atual.valor.id_identificador);
+            ctx->token_atual = obter_proximo_token(ctx);
         }
         
-        if (token_atual.tipo != TOKEN_PONTO_VIRGULA) {
-            erro_sintatico(";");
+        if (ctx->token_atual.tipo != TOKEN_PONTO_VIRGULA) {
+            erro_sintatico(ctx, ";");
         }
-        token_atual = obter_proximo_token();
+        ctx->token_atual = obter_proximo_token(ctx);
     }
+    ctx->sincronizacao_ativa = 0;
     
-    printf("INPP\n");
-    printf("AMEM %d\n", num_simbolos);
+    ctx->programa.num_variaveis = ctx->tabela_simbolos.num_simbolos;
+}
+// Operador binario do token e sua precedencia, da menor para a maior; 0 se nao for operador
+typedef struct {
+    TipoNo tipo;
+    int precedencia;
+} OperadorBinario;
+
+static OperadorBinario operador_binario(TipoToken tipo) {
+    switch (tipo) {
+        case TOKEN_OU:             return (OperadorBinario){ NO_OU, 1 };
+        case TOKEN_E:              return (OperadorBinario){ NO_E, 2 };
+        case TOKEN_IGUAL:          return (OperadorBinario){ NO_IGUAL, 3 };
+        case TOKEN_DIFERENTE:      return (OperadorBinario){ NO_DIFERENTE, 3 };
+        case TOKEN_MENOR:          return (OperadorBinario){ NO_MENOR, 3 };
+        case TOKEN_MENOR_IGUAL:    return (OperadorBinario){ NO_MENOR_IGUAL, 3 };
+        case TOKEN_MAIOR:          return (OperadorBinario){ NO_MAIOR, 3 };
+        case TOKEN_MAIOR_IGUAL:    return (OperadorBinario){ NO_MAIOR_IGUAL, 3 };
+        case TOKEN_SOMA:           return (OperadorBinario){ NO_SOMA, 4 };
+        case TOKEN_SUBTRACAO:      return (OperadorBinario){ NO_SUBTRACAO, 4 };
+        case TOKEN_MULTIPLICACAO:  return (OperadorBinario){ NO_MULTIPLICACAO, 5 };
+        case TOKEN_DIV:            return (OperadorBinario){ NO_DIVISAO, 5 };
+        case TOKEN_MOD:            return (OperadorBinario){ NO_RESTO, 5 };
+        default:                   return (OperadorBinario){ NO_NUMERO, 0 };
+    }
+}
+
+//Token que pode abrir uma expressao
+static int inicia_expressao(TipoToken tipo) {
+    return tipo == TOKEN_NUMERO || tipo == TOKEN_ID || tipo == TOKEN_ABRE_PARENTESES ||
+           tipo == TOKEN_SUBTRACAO || tipo == TOKEN_NAO || tipo == TOKEN_VERDADEIRO || tipo == TOKEN_FALSO;
+}
+
+static NoAst *funcao_expressao(ContextoCompilador *ctx, int precedencia_minima);
+
+//Operando: numero, variavel, true/false, expressao entre parenteses, not ou menos unario
+static NoAst *funcao_operando(ContextoCompilador *ctx) {
+    Token token = ctx->token_atual;
+    NoAst *no;
+    switch (token.tipo) {
+        case TOKEN_NUMERO:
+            no = criar_numero_ast(&ctx->arena, token.valor.valor_inteiro, token.linha);
+            break;
+        case TOKEN_ID:
+            no = criar_variavel_ast(&ctx->arena, busca_tabela_simbolos(ctx, token.valor.id_identificador),
+                                    token.linha);
+            break;
+        case TOKEN_VERDADEIRO:
+        case TOKEN_FALSO:
+            no = criar_numero_ast(&ctx->arena, token.tipo == TOKEN_VERDADEIRO, token.linha);
+            break;
+        case TOKEN_ABRE_PARENTESES:
+            ctx->token_atual = obter_proximo_token(ctx);
+            no = funcao_expressao(ctx, 1);
+            if (ctx->token_atual.tipo != TOKEN_FECHA_PARENTESES) {
+                erro_sintatico(ctx, ")");
+            }
+            break;
+        case TOKEN_NAO:
+            ctx->token_atual = obter_proximo_token(ctx);
+            return criar_unario_ast(&ctx->arena, NO_NAO, funcao_operando(ctx), token.linha);
+        case TOKEN_SUBTRACAO:
+            ctx->token_atual = obter_proximo_token(ctx);
+            no = funcao_operando(ctx);
+            if (no->tipo == NO_NUMERO) {
+                no->valor = (int)(0u - (unsigned)no->valor);
+                return no;
+            }
+            return criar_binario_ast(&ctx->arena, NO_SUBTRACAO, criar_numero_ast(&ctx->arena, 0, token.linha),
+                                     no, token.linha);
+        default:
+            erro_sintatico(ctx, "expressão");
+            return NULL;
+    }
+    ctx->token_atual = obter_proximo_token(ctx);
+    return no;
+}
+
+//Expressao por precedencia: so consome operadores de precedencia >= precedencia_minima,
+//todos associativos a esquerda; deixa o token seguinte em token_atual
+static NoAst *funcao_expressao(ContextoCompilador *ctx, int precedencia_minima) {
+    NoAst *esquerda = funcao_operando(ctx);
+    for (;;) {
+        OperadorBinario operador = operador_binario(ctx->token_atual.tipo);
+        if (operador.precedencia == 0 || operador.precedencia < precedencia_minima) {
+            return esquerda;
+        }
+        int linha = ctx->token_atual.linha;
+        ctx->token_atual = obter_proximo_token(ctx);
+        NoAst *direita = funcao_expressao(ctx, operador.precedencia + 1);
+        esquerda = criar_binario_ast(&ctx->arena, operador.tipo, esquerda, direita, linha);
+    }
 }
 //Função de leitura
-void funcao_read() {
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_ABRE_PARENTESES) {
-        erro_sintatico("(");
+NoAst *funcao_read(ContextoCompilador *ctx) {
+    NoAst *no = novo_no(ctx, NO_LEIA);
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_ABRE_PARENTESES) {
+        erro_sintatico(ctx, "(");
     }
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_ID) {
-        erro_sintatico("identificador");
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_ID) {
+        erro_sintatico(ctx, "identificador");
     }
     
-    int endereco = busca_tabela_simbolos(token_atual.lexema);
-    printf("LEIT\n");
-    printf("ARMZ %d\n", endereco);
+    no->endereco = busca_tabela_simbolos(ctx, ctx->token_atual.valor.id_identificador);
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_FECHA_PARENTESES) {
-        erro_sintatico(")");
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_FECHA_PARENTESES) {
+        erro_sintatico(ctx, ")");
     }
     
-    token_atual = obter_proximo_token();
+    ctx->token_atual = obter_proximo_token(ctx);
+    return no;
 }
 //Funcao de escrever
-void funcao_write() {
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_ABRE_PARENTESES) {
-        erro_sintatico("(");
+NoAst *funcao_write(ContextoCompilador *ctx) {
+    NoAst *no = novo_no(ctx, NO_ESCREVA);
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_ABRE_PARENTESES) {
+        erro_sintatico(ctx, "(");
     }
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo == TOKEN_ID) {
-        int endereco = busca_tabela_simbolos(token_atual.lexema);
-        printf("CRVL %d\n", endereco);
-    } else if (token_atual.tipo == TOKEN_NUMERO) {
-        printf("CRCT %s\n", token_atual.lexema);
-    } else {
-        erro_sintatico("identificador ou número");
-    }
-    
-    printf("IMPR\n");
+    ctx->token_atual = obter_proximo_token(ctx);
+    no->escrita.valor = funcao_expressao(ctx, 1);
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_FECHA_PARENTESES) {
-        erro_sintatico(")");
+    if (ctx->token_atual.tipo != TOKEN_FECHA_PARENTESES) {
+        erro_sintatico(ctx, ")");
     }
     
-    token_atual = obter_proximo_token();
+    ctx->token_atual = obter_proximo_token(ctx);
+    return no;
 }
 //SET
-void funcao_set() {
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_ID) {
-        erro_sintatico("identificador");
+NoAst *funcao_set(ContextoCompilador *ctx) {
+    NoAst *no = novo_no(ctx, NO_ATRIBUICAO);
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_ID) {
+        erro_sintatico(ctx, "identificador");
     }
     
-    int endereco_destino = busca_tabela_simbolos(token_atual.lexema);
+    no->atribuicao.endereco = busca_tabela_simbolos(ctx, ctx->token_atual.valor.id_identificador);
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_ATE) {
-        erro_sintatico("to");
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_ATE) {
+        erro_sintatico(ctx, "to");
     }
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo == TOKEN_NUMERO) {
-        char* num_str = token_atual.lexema;
-        if (strlen(num_str) >= 2 && num_str[0] == '0' && (num_str[1] == 'b' || num_str[1] == 'B')) {
-            int num_val = converter_binario(num_str);
-            printf("CRCT %d\n", num_val);
-        } else {
-            printf("CRCT %s\n", num_str);
-        }
-    } else if (token_atual.tipo == TOKEN_ID) {
-        int endereco = busca_tabela_simbolos(token_atual.lexema);
-        printf("CRVL %d\n", endereco);
-        
-        token_atual = obter_proximo_token();
-        if (token_atual.tipo == TOKEN_MULTIPLICACAO) {
-            token_atual = obter_proximo_token();
-            if (token_atual.tipo == TOKEN_ID) {
-                endereco = busca_tabela_simbolos(token_atual.lexema);
-                printf("CRVL %d\n", endereco);
-                printf("MULT\n");
-            }
-        }
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (!inicia_expressao(ctx->token_atual.tipo)) {
+        erro_sintatico(ctx, "expressão");
     }
-    
-    printf("ARMZ %d\n", endereco_destino);
-    token_atual = obter_proximo_token();
+    no->atribuicao.valor = funcao_expressao(ctx, 1);
+    return no;
 }
 //FOR
-void funcao_for() {
-    int rotulo_inicio = proximo_rotulo();
-    int rotulo_fim = proximo_rotulo();
+NoAst *funcao_for(ContextoCompilador *ctx) {
+    NoAst *no = novo_no(ctx, NO_PARA);
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_ID) {
-        erro_sintatico("identificador");
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_ID) {
+        erro_sintatico(ctx, "identificador");
     }
     
-    int endereco_contador = busca_tabela_simbolos(token_atual.lexema);
+    no->para.contador = busca_tabela_simbolos(ctx, ctx->token_atual.valor.id_identificador);
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_DE) {
-        erro_sintatico("of");
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_DE) {
+        erro_sintatico(ctx, "of");
     }
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_NUMERO) {
-        erro_sintatico("número");
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_NUMERO) {
+        erro_sintatico(ctx, "número");
     }
     
-    char* num_str = token_atual.lexema;
-    if (strlen(num_str) >= 2 && num_str[0] == '0' && (num_str[1] == 'b' || num_str[1] == 'B')) {
-        int num_val = converter_binario(num_str);
-        printf("CRCT %d\n", num_val);
-    } else {
-        printf("CRCT %s\n", num_str);
-    }
-    printf("ARMZ %d\n", endereco_contador);
+    no->para.inicio = criar_numero_ast(&ctx->arena, ctx->token_atual.valor.valor_inteiro,
+                                       ctx->token_atual.linha);
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_ATE) {
-        erro_sintatico("to");
+    ctx->token_atual = obter_proximo_token(ctx);
+    if (ctx->token_atual.tipo != TOKEN_ATE) {
+        erro_sintatico(ctx, "to");
     }
     
-    token_atual = obter_proximo_token();
-    int endereco_limite;
-    if (token_atual.tipo == TOKEN_ID) {
-        endereco_limite = busca_tabela_simbolos(token_atual.lexema);
-    }
+    // O limite e reavaliado a cada volta
+    ctx->token_atual = obter_proximo_token(ctx);
+    no->para.limite = funcao_expressao(ctx, 1);
     
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_DOIS_PONTOS) {
-        erro_sintatico(":");
+    if (ctx->token_atual.tipo != TOKEN_DOIS_PONTOS) {
+        erro_sintatico(ctx, ":");
     }
     
-    printf("NADA (L%d)\n", rotulo_inicio);
-    printf("CRVL %d\n", endereco_contador);
-    printf("CRVL %d\n", endereco_limite);
-    printf("CMEG\n");
-    printf("DSVF L%d\n", rotulo_fim);
-    
-    token_atual = obter_proximo_token();
-    funcao_set();
-    
-    printf("CRVL %d\n", endereco_contador);
-    printf("CRCT 1\n");
-    printf("SOMA\n");
-    printf("ARMZ %d\n", endereco_contador);
-    printf("DSVS L%d\n", rotulo_inicio);
-    printf("NADA (L%d)\n", rotulo_fim);
+    ctx->token_atual = obter_proximo_token(ctx);
+    no->para.corpo = funcao_set(ctx);
+    return no;
+}
+//Copia as instrucoes para os lotes da escrita, publicando cada lote cheio; com ultimo, o
+//lote final e publicado marcado mesmo que vazio
+static void enviar_instrucoes_fluxo(FluxoCompilacao *fluxo, const InstrucaoMepa *instrucoes, int num, int ultimo) {
+    for (;;) {
+        LoteInstrucoes *lote = fluxo->lote_saida;
+        if (!lote) {
+            lote = fluxo->lote_saida = lote_para_escrever(&fluxo->instrucoes);
+            lote->num_instrucoes = 0;
+            lote->ultimo = 0;
+        }
+        int n = INSTRUCOES_POR_LOTE - lote->num_instrucoes;
+        if (n > num) n = num;
+        if (n > 0) memcpy(lote->instrucoes + lote->num_instrucoes, instrucoes, (size_t)n * sizeof(InstrucaoMepa));
+        lote->num_instrucoes += n;
+        instrucoes += n;
+        num -= n;
+        if (num == 0 && !ultimo) return;
+        lote->ultimo = num == 0;
+        publicar_lote(&fluxo->instrucoes);
+        fluxo->lote_saida = NULL;
+        if (num == 0) return;
+    }
+}
+
+//Traduz o IR acumulado para MEPA e o envia a escrita. Depois de um erro nada mais e gerado:
+//o arquivo nao tera saida
+static void enviar_codigo_fluxo(ContextoCompilador *ctx, int ultimo) {
+    FluxoCompilacao *fluxo = ctx->fluxo;
+    if (ctx->num_erros == 0 && !fluxo->falhou) {
+        fluxo->falhou = gerar_mepa_de_ir(&ctx->ir, &ctx->codigo, ctx->diagnosticos) != 0;
+    }
+    if (ctx->num_erros == 0 && !fluxo->falhou) {
+        if (ctx->estatisticas) {
+            for (int i = 0; i < ctx->codigo.num_instrucoes; i++) {
+                ctx->estatisticas->instrucoes[ctx->codigo.instrucoes[i].opcode]++;
+            }
+        }
+        enviar_instrucoes_fluxo(fluxo, ctx->codigo.instrucoes, ctx->codigo.num_instrucoes, ultimo);
+    } else if (ultimo) {
+        enviar_instrucoes_fluxo(fluxo, NULL, 0, 1);
+    }
+    esvaziar_codigo_ir(&ctx->ir);
+    ctx->codigo.num_instrucoes = 0;
+}
+
+//O comando ja analisado vira codigo e segue para a escrita; a arvore dele nao e mais usada
+static void emitir_comando_fluxo(ContextoCompilador *ctx, const NoAst *comando) {
+    if (ctx->num_erros == 0) {
+        gerar_ir_comando(&ctx->ir, comando);
+        enviar_codigo_fluxo(ctx, 0);
+    }
+    reiniciar_arena(&ctx->arena);
 }
+
 //Caso use mais de uma
-void funcao_composto() {
-    while (token_atual.tipo != TOKEN_FIM && token_atual.tipo != TOKEN_EOF) {
-        switch (token_atual.tipo) {
+NoAst *funcao_composto(ContextoCompilador *ctx) {
+    // volatile: o modo panico volta ao setjmp com parte da lista ja montada
+    NoAst *volatile primeiro = NULL;
+    NoAst *volatile *volatile ultimo = &primeiro;
+    // Erro num comando: descarta o resto dele; os comandos anteriores ficam na lista
+    if (setjmp(ctx->sincronizacao) != 0) {
+        sincronizar(ctx);
+    }
+    ctx->sincronizacao_ativa = 1;
+    while (ctx->token_atual.tipo != TOKEN_FIM && ctx->token_atual.tipo != TOKEN_EOF) {
+        NoAst *comando;
+        switch (ctx->token_atual.tipo) {
             case TOKEN_LEIA:
-                funcao_read();
+                comando = funcao_read(ctx);
                 break;
             case TOKEN_ESCREVA:
-                funcao_write();
+                comando = funcao_write(ctx);
                 break;
             case TOKEN_FOR:
-                funcao_for();
+                comando = funcao_for(ctx);
                 break;
             case TOKEN_SET:
-                funcao_set();
+                comando = funcao_set(ctx);
                 break;
             default:
-                return;
+                // Token que nao comeca comando: sai junto com o resto do comando
+                reportar_erro_sintatico(ctx, "end");
+                ctx->token_atual = obter_proximo_token(ctx);
+                sincronizar(ctx);
+                continue;
+        }
+        if (ctx->fluxo) {
+            emitir_comando_fluxo(ctx, comando);
+        } else {
+            *ultimo = comando;
+            ultimo = &comando->proximo;
         }
         
-        if (token_atual.tipo == TOKEN_PONTO_VIRGULA) {
-            token_atual = obter_proximo_token();
+        if (ctx->token_atual.tipo == TOKEN_PONTO_VIRGULA) {
+            ctx->token_atual = obter_proximo_token(ctx);
         }
     }
+    ctx->sincronizacao_ativa = 0;
+    return primeiro;
 }
 
-void imprimir_tabela_simbolos() {
-    printf("\nTABELA DE SIMBOLOS\n");
-    for (int i = 0; i < num_simbolos; i++) {
-        printf("%s | Endereco: %d\n", 
-               tabela_simbolos[i].identificador, 
-               tabela_simbolos[i].endereco);
+//Variaveis removidas pela compactacao (-O1) ficam com endereco -1 e nao aparecem
+void imprimir_tabela_simbolos(ContextoCompilador *ctx, FILE *saida) {
+    fprintf(saida, "\nTABELA DE SIMBOLOS\n");
+    for (int i = 0; i < ctx->tabela_simbolos.num_simbolos; i++) {
+        if (ctx->tabela_simbolos.simbolos[i].endereco < 0) continue;
+        fprintf(saida, "%s | Endereco: %d\n", 
+               texto_identificador(&ctx->pool_identificadores, ctx->tabela_simbolos.simbolos[i].id), 
+               ctx->tabela_simbolos.simbolos[i].endereco);
     }
 }
-//Main
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Uso: %s <arquivo-fonte>\n", argv[0]);
+
+void iniciar_contexto(ContextoCompilador *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    iniciar_pool_identificadores(&ctx->pool_identificadores);
+    iniciar_tabela_simbolos(&ctx->tabela_simbolos);
+    iniciar_arena(&ctx->arena);
+    iniciar_codigo_ir(&ctx->ir);
+    iniciar_codigo_mepa(&ctx->codigo);
+    ctx->diagnosticos = stderr;
+    ctx->prefixo_diagnostico = "";
+    ctx->arquivo_diagnostico = "";
+}
+
+void liberar_contexto(ContextoCompilador *ctx) {
+    liberar_arena(&ctx->arena);
+    liberar_codigo_ir(&ctx->ir);
+    liberar_codigo_mepa(&ctx->codigo);
+    liberar_tabela_simbolos(&ctx->tabela_simbolos);
+    liberar_pool_identificadores(&ctx->pool_identificadores);
+}
+
+//Prepara o contexto para um novo arquivo reaproveitando tabelas e vetor de codigo
+static void reiniciar_contexto(ContextoCompilador *ctx) {
+    iniciar_analisador_lexico(&ctx->lexico, ctx->fonte.dados, ctx->fonte.tamanho);
+    ctx->proximo_endereco = 0;
+    ctx->programa.num_variaveis = 0;
+    ctx->programa.comandos = NULL;
+    reiniciar_arena(&ctx->arena);
+    limpar_codigo_ir(&ctx->ir);
+    limpar_pool_identificadores(&ctx->pool_identificadores);
+    limpar_tabela_simbolos(&ctx->tabela_simbolos);
+    ctx->codigo.num_instrucoes = 0;
+    ctx->codigo.desvios_absolutos = 0;
+    ctx->sincronizacao_ativa = 0;
+    ctx->num_erros = 0;
+}
+
+//Depois de faltar memoria: devolve a arena e os vetores de codigo crescidos pelo arquivo
+//que falhou, em vez de o contexto (reaproveitado pelo servidor) ficar com eles. Nao aloca
+static void devolver_memoria_contexto(ContextoCompilador *ctx) {
+    liberar_arena(&ctx->arena);
+    liberar_codigo_ir(&ctx->ir);
+    liberar_codigo_mepa(&ctx->codigo);
+    iniciar_arena(&ctx->arena);
+    iniciar_codigo_ir(&ctx->ir);
+    iniciar_codigo_mepa(&ctx->codigo);
+    ctx->programa.comandos = NULL;
+}
+
+//Analisa o programa inteiro montando a AST em ctx->programa
+//Os erros sao contados em ctx->num_erros; a analise so e abandonada no limite de erros
+static void analisar_programa(ContextoCompilador *ctx) {
+    ctx->token_atual = obter_proximo_token(ctx);
+
+    // Erro no cabecalho: descarta ate o ; ou o inicio das declaracoes
+    if (setjmp(ctx->sincronizacao) != 0) {
+        sincronizar(ctx);
+    } else {
+        ctx->sincronizacao_ativa = 1;
+        if (ctx->token_atual.tipo != TOKEN_PROGRAM) {
+            erro_sintatico(ctx, "program");
+        }
+
+        ctx->token_atual = obter_proximo_token(ctx);
+        if (ctx->token_atual.tipo != TOKEN_ID) {
+            erro_sintatico(ctx, "identificador");
+        }
+
+        ctx->token_atual = obter_proximo_token(ctx);
+        if (ctx->token_atual.tipo != TOKEN_PONTO_VIRGULA) {
+            erro_sintatico(ctx, ";");
+        }
+
+        ctx->token_atual = obter_proximo_token(ctx);
+    }
+    ctx->sincronizacao_ativa = 0;
+    
+    MarcaFase fase = iniciar_fase(ctx->estatisticas);
+    declaracao_variaveis(ctx);
+    encerrar_fase(ctx->estatisticas, FASE_DECLARACOES, fase);
+    
+    // Sem o begin, os comandos sao analisados assim mesmo
+    if (ctx->token_atual.tipo == TOKEN_INICIO) {
+        ctx->token_atual = obter_proximo_token(ctx);
+    } else {
+        reportar_erro_sintatico(ctx, "begin");
+    }
+    
+    // Em fluxo o INPP/AMEM sai ja com o primeiro comando
+    if (ctx->fluxo) gerar_ir_inicio(&ctx->ir, ctx->programa.num_variaveis);
+    fase = iniciar_fase(ctx->estatisticas);
+    ctx->programa.comandos = funcao_composto(ctx);
+    encerrar_fase(ctx->estatisticas, FASE_COMANDOS, fase);
+    
+    if (ctx->token_atual.tipo != TOKEN_FIM) {
+        reportar_erro_sintatico(ctx, "end");
+    }
+}
+
+//--lex-threads: o fonte inteiro e analisado por trechos antes da analise sintatica. Fontes
+//pequenos demais para dividir, ou sem memoria, ficam com o analisador sequencial
+static void preparar_lexico_paralelo(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes) {
+    if (opcoes->threads_lexico == 1 || ctx->fonte.tamanho < 2 * (size_t)TAMANHO_MINIMO_TRECHO) return;
+    MarcaFase fase = iniciar_fase(ctx->estatisticas);
+    ctx->lexico_paralelo = analisar_lexico_paralelo(&ctx->tokens_paralelos, ctx->fonte.dados,
+                                                    ctx->fonte.tamanho, opcoes->threads_lexico) == 0;
+    encerrar_fase(ctx->estatisticas, FASE_LEXICO, fase);
+}
+
+static void encerrar_lexico_paralelo(ContextoCompilador *ctx) {
+    if (!ctx->lexico_paralelo) return;
+    liberar_tokens_paralelos(&ctx->tokens_paralelos);
+    ctx->lexico_paralelo = 0;
+}
+
+//Escreve o codigo no formato pedido; caminho_saida NULL usa a saida padrao
+static int escrever_saida(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes, const char *caminho_saida) {
+    // --emit=exe monta e liga um executavel nativo com o as/ld do sistema
+    if (opcoes->formato == SAIDA_EXECUTAVEL) {
+        return gerar_executavel_x86_64(&ctx->codigo, caminho_saida ? caminho_saida : "a.out", opcoes->erros) == 0 ? 0 : 1;
+    }
+
+    // Todo o codigo e escrito de uma vez, ja com a compilacao concluida
+    FILE *saida = opcoes->saida;
+    if (caminho_saida) {
+        saida = fopen(caminho_saida, opcoes->formato == SAIDA_BINARIA ? "wb" : "w");
+        if (!saida) {
+            reportar_erro(ctx, "Erro ao criar o arquivo de saida: %s\n", strerror(errno));
+            return 1;
+        }
+    }
+
+    int erro_escrita;
+    if (opcoes->formato == SAIDA_IR) {
+        erro_escrita = escrever_ir_texto(&ctx->ir, saida);
+    } else if (opcoes->formato == SAIDA_BINARIA) {
+        erro_escrita = escrever_objeto_binario(&ctx->codigo, &ctx->tabela_simbolos, &ctx->pool_identificadores, saida);
+    } else if (opcoes->formato == SAIDA_ASSEMBLY) {
+        erro_escrita = gerar_assembly_x86_64(&ctx->codigo, saida, ctx->diagnosticos);
+    } else {
+        erro_escrita = escrever_codigo_texto(&ctx->codigo, saida);
+        imprimir_tabela_simbolos(ctx, saida);
+    }
+    if (saida != opcoes->saida) {
+        erro_escrita |= fclose(saida);
+    } else {
+        erro_escrita |= fflush(saida);
+    }
+    if (erro_escrita) {
+        reportar_erro(ctx, "Erro ao escrever a saida: %s\n", strerror(errno));
         return 1;
     }
+    return 0;
+}
 
-    arquivo_fonte = fopen(argv[1], "r");
-    if (!arquivo_fonte) {
-        perror("Erro ao abrir o arquivo");
+//Lista os tokens no formato da primeira parte, sem analise sintatica (--emit=tokens)
+static int listar_tokens(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes, const char *caminho_saida) {
+    FILE *saida = opcoes->saida;
+    if (caminho_saida) {
+        saida = fopen(caminho_saida, "w");
+        if (!saida) {
+            reportar_erro(ctx, "Erro ao criar o arquivo de saida: %s\n", strerror(errno));
+            return 1;
+        }
+    }
+
+    Token token;
+    do {
+        token = ctx->lexico_paralelo ? proximo_token_paralelo(&ctx->tokens_paralelos) : proximo_token(&ctx->lexico);
+        imprimir_token(saida, &ctx->lexico, token);
+    } while (token.tipo != TOKEN_EOF);
+
+    int erro_escrita = saida != opcoes->saida ? fclose(saida) : fflush(saida);
+    if (erro_escrita) {
+        reportar_erro(ctx, "Erro ao escrever a saida: %s\n", strerror(errno));
         return 1;
     }
+    return 0;
+}
 
-    avancar_caractere();
-    token_atual = obter_proximo_token();
+//AST -> codigo intermediario -> MEPA, com o peephole em -O1. Retorna 0 ou 1
+static int gerar_codigo(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes) {
+    if (opcoes->nivel_otimizacao >= 1) {
+        EstatisticasConstantes constantes;
+        propagar_constantes(&ctx->programa, &ctx->arena, &constantes, ctx->diagnosticos, ctx->prefixo_diagnostico);
+        if (opcoes->relatorio_otimizacao) {
+            reportar_erro(ctx, "constantes: %d operacoes dobradas, %d variaveis propagadas\n",
+                          constantes.dobradas, constantes.propagadas);
+        }
+    }
+    if (opcoes->nivel_otimizacao >= 2) {
+        EstatisticasLacos lacos;
+        otimizar_lacos(&ctx->programa, &ctx->arena, opcoes->fator_desenrolar, &lacos);
+        if (opcoes->relatorio_otimizacao) {
+            reportar_erro(ctx, "lacos: %d analisados, %d invariantes movidas, %d multiplicacoes reduzidas, %d desenrolados\n",
+                          lacos.lacos, lacos.invariantes, lacos.reduzidas, lacos.desenrolados);
+        }
+    }
+    if (opcoes->nivel_otimizacao >= 1) {
+        EstatisticasVivacidade vivacidade;
+        int *enderecos = compactar_variaveis(&ctx->programa, &ctx->arena, &vivacidade);
+        for (int i = 0; i < ctx->tabela_simbolos.num_simbolos; i++) {
+            SimboloTabela *simbolo = &ctx->tabela_simbolos.simbolos[i];
+            simbolo->endereco = enderecos[simbolo->endereco];
+        }
+        if (opcoes->relatorio_otimizacao) {
+            reportar_erro(ctx, "vivacidade: %d armazenamentos mortos removidos, %d variaveis removidas, AMEM %d -> %d\n",
+                          vivacidade.armazenamentos_removidos, vivacidade.variaveis_removidas,
+                          vivacidade.posicoes_antes, vivacidade.posicoes_depois);
+        }
+    }
+    gerar_ir(&ctx->programa, &ctx->ir);
+    if (opcoes->formato == SAIDA_IR) {
+        return 0;
+    }
+    if (gerar_mepa_de_ir(&ctx->ir, &ctx->codigo, ctx->diagnosticos) != 0) {
+        return 1;
+    }
 
-    if (token_atual.tipo != TOKEN_PROGRAM) {
-        erro_sintatico("program");
+    if (opcoes->nivel_otimizacao >= 1) {
+        EstatisticasPeephole peephole;
+        otimizar_peephole(&ctx->codigo, &peephole);
+        if (opcoes->relatorio_otimizacao) {
+            reportar_erro(ctx, "peephole: %d -> %d instrucoes (%d superinstrucoes fundindo %d, %d removidas)\n",
+                          peephole.instrucoes_antes, peephole.instrucoes_depois, peephole.superinstrucoes,
+                          peephole.fundidas, peephole.removidas);
+        }
     }
-    
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_ID) {
-        erro_sintatico("identificador");
+    // Depois do peephole, que ainda procura os NADA
+    if (opcoes->desvios_absolutos && resolver_rotulos_mepa(&ctx->codigo, ctx->diagnosticos) != 0) {
+        return 1;
     }
-    
-    token_atual = obter_proximo_token();
-    if (token_atual.tipo != TOKEN_PONTO_VIRGULA) {
-        erro_sintatico(";");
+    return 0;
+}
+
+//Relatorio de --profile em stderr e, com --profile=arquivo, as pilhas do flamegraph
+static int escrever_perfil(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes,
+                           const long long *contagens, const char *caminho_fonte) {
+    fflush(opcoes->saida);
+    int resultado = escrever_relatorio_perfil(&ctx->codigo, contagens, opcoes->erros);
+    if (opcoes->caminho_pilhas) {
+        FILE *pilhas = fopen(opcoes->caminho_pilhas, "w");
+        if (!pilhas) {
+            reportar_erro(ctx, "Erro ao criar o arquivo de perfil: %s\n", strerror(errno));
+            return -1;
+        }
+        resultado |= escrever_pilhas_perfil(&ctx->codigo, contagens, caminho_fonte, pilhas);
+        if (fclose(pilhas) != 0) resultado = -1;
     }
-    
-    token_atual = obter_proximo_token();
-    
-    declaracao_variaveis();
-    
-    if (token_atual.tipo != TOKEN_INICIO) {
-        erro_sintatico("begin");
+    return resultado;
+}
+
+//Analisa o fonte aberto em ctx->fonte, que e fechado, e gera o codigo; emissao recebe o
+//inicio da fase de emissao. Retorna -1 com erro na analise ou o resultado de gerar_codigo
+static int traduzir_fonte(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes, MarcaFase *emissao) {
+    // Passando do limite de erros, a analise volta aqui via longjmp
+    if (setjmp(ctx->recuperacao_erro) != 0) {
+        encerrar_lexico_paralelo(ctx);
+        fechar_fonte(&ctx->fonte);
+        return -1;
     }
-    
-    token_atual = obter_proximo_token();
-    funcao_composto();
-    
-    if (token_atual.tipo != TOKEN_FIM) {
-        erro_sintatico("end");
+    preparar_lexico_paralelo(ctx, opcoes);
+    analisar_programa(ctx);
+    encerrar_lexico_paralelo(ctx);
+    fechar_fonte(&ctx->fonte);
+    if (ctx->num_erros > 0) return -1;
+    *emissao = iniciar_fase(ctx->estatisticas);
+    return gerar_codigo(ctx, opcoes);
+}
+
+//Traduz com os diagnosticos guardados em *mensagens (libere com free), sem prefixo e em
+//texto. Sem memoria para guarda-los, eles saem direto e *mensagens fica NULL
+static int traduzir_capturando(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes, MarcaFase *emissao,
+                               char **mensagens, size_t *tamanho) {
+    *mensagens = NULL;
+    *tamanho = 0;
+    FILE *capturados = open_memstream(mensagens, tamanho);
+    if (!capturados) return traduzir_fonte(ctx, opcoes, emissao);
+    FILE *diagnosticos = ctx->diagnosticos;
+    const char *prefixo = ctx->prefixo_diagnostico;
+    int json = ctx->diagnosticos_json;
+    ctx->diagnosticos = capturados;
+    ctx->prefixo_diagnostico = "";
+    ctx->diagnosticos_json = 0;
+    // Sem memoria: devolve os diagnosticos originais antes de seguir para a recuperacao
+    jmp_buf recuperacao;
+    jmp_buf *anterior = definir_recuperacao_memoria(&recuperacao);
+    if (setjmp(recuperacao) != 0) {
+        ctx->diagnosticos = diagnosticos;
+        ctx->prefixo_diagnostico = prefixo;
+        ctx->diagnosticos_json = json;
+        fclose(capturados);
+        free(*mensagens);
+        *mensagens = NULL;
+        definir_recuperacao_memoria(anterior);
+        memoria_insuficiente();
     }
-    
-    printf("PARA\n");
-    imprimir_tabela_simbolos();
-    
-    fclose(arquivo_fonte);
+    int resultado = traduzir_fonte(ctx, opcoes, emissao);
+    definir_recuperacao_memoria(anterior);
+    ctx->diagnosticos = diagnosticos;
+    ctx->prefixo_diagnostico = prefixo;
+    ctx->diagnosticos_json = json;
+    fclose(capturados);
+    return resultado;
+}
+
+//--diagnostics=json: os avisos das otimizacoes sao escritos direto no FILE, entao tudo e
+//capturado em texto e convertido no fim
+static int traduzir_com_diagnosticos_json(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes,
+                                          MarcaFase *emissao) {
+    char *mensagens;
+    size_t tamanho;
+    int resultado = traduzir_capturando(ctx, opcoes, emissao, &mensagens, &tamanho);
+    repetir_diagnosticos(ctx, mensagens, tamanho);
+    free(mensagens);
+    return resultado;
+}
+
+//Chave do cache: o compilador, as opcoes que mudam o codigo ou os diagnosticos e o fonte.
+//O formato de saida fica de fora: a mesma entrada serve para texto, binario, assembly,
+//executavel e --run
+static void calcular_chave_cache(const OpcoesCompilacao *opcoes, const ArquivoFonte *fonte,
+                                 unsigned char chave[TAMANHO_CHAVE_CACHE]) {
+    char texto[64];
+    int tamanho = snprintf(texto, sizeof(texto), "O%d unroll=%d labels=%d report=%d\n", opcoes->nivel_otimizacao,
+                           opcoes->nivel_otimizacao >= 2 ? opcoes->fator_desenrolar : 0,
+                           opcoes->desvios_absolutos, opcoes->relatorio_otimizacao);
+    Sha256 sha;
+    iniciar_chave_cache(&sha);
+    atualizar_sha256(&sha, texto, (size_t)tamanho);
+    atualizar_sha256(&sha, fonte->dados, fonte->tamanho);
+    concluir_sha256(&sha, chave);
+}
+
+//Dados de uma entrada: tamanho:u64 (little-endian) dos diagnosticos, os diagnosticos sem
+//prefixo e o objeto binario, com a tabela de simbolos
+static int gravar_entrada_cache(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes,
+                                const unsigned char chave[TAMANHO_CHAVE_CACHE],
+                                const char *mensagens, size_t tamanho_mensagens) {
+    char *dados = NULL;
+    size_t tamanho = 0;
+    FILE *entrada = open_memstream(&dados, &tamanho);
+    if (!entrada) return -1;
+    unsigned char cabecalho[8];
+    for (int i = 0; i < 8; i++) cabecalho[i] = (unsigned char)((uint64_t)tamanho_mensagens >> (8 * i));
+    int erro = fwrite(cabecalho, 1, sizeof(cabecalho), entrada) != sizeof(cabecalho) ||
+               fwrite(mensagens, 1, tamanho_mensagens, entrada) != tamanho_mensagens ||
+               escrever_objeto_binario(&ctx->codigo, &ctx->tabela_simbolos, &ctx->pool_identificadores, entrada) != 0;
+    erro |= fclose(entrada) != 0;
+    int resultado = erro ? -1 : gravar_cache(&opcoes->cache, chave, dados, tamanho);
+    free(dados);
+    return resultado;
+}
+
+//Carrega o codigo e a tabela de simbolos de uma entrada e repete os diagnosticos. Retorna 0 ou -1
+static int restaurar_entrada_cache(ContextoCompilador *ctx, const char *dados, size_t tamanho) {
+    if (tamanho < 8) return -1;
+    uint64_t tamanho_mensagens = 0;
+    for (int i = 0; i < 8; i++) tamanho_mensagens |= (uint64_t)(unsigned char)dados[i] << (8 * i);
+    if (tamanho_mensagens > tamanho - 8) return -1;
+    const char *objeto = dados + 8 + tamanho_mensagens;
+    ctx->codigo.linha_atual = 0;
+    if (carregar_objeto_mepa(objeto, (size_t)(dados + tamanho - objeto), &ctx->codigo,
+                             &ctx->tabela_simbolos, &ctx->pool_identificadores, ctx->diagnosticos) != 0) {
+        return -1;
+    }
+    repetir_diagnosticos(ctx, dados + 8, (size_t)tamanho_mensagens);
     return 0;
-}
\ No newline at end of file
+}
+
+//--cache: no acerto o codigo vem da entrada, sem lexico nem analise; na falta o fonte e
+//compilado e, sem erros, vira uma entrada. Retorna como traduzir_fonte
+static int traduzir_com_cache(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes, MarcaFase *emissao) {
+    unsigned char chave[TAMANHO_CHAVE_CACHE];
+    calcular_chave_cache(opcoes, &ctx->fonte, chave);
+    EntradaCache entrada;
+    if (ler_cache(&opcoes->cache, chave, &entrada)) {
+        *emissao = iniciar_fase(ctx->estatisticas);
+        int resultado = restaurar_entrada_cache(ctx, entrada.dados, entrada.tamanho);
+        fechar_entrada_cache(&entrada);
+        if (resultado == 0) {
+            fechar_fonte(&ctx->fonte);
+            if (ctx->estatisticas) ctx->estatisticas->acertos_cache++;
+            return 0;
+        }
+        // Entrada intacta que nao carrega (de outro compilador com o mesmo resumo?): compila de novo
+        reiniciar_contexto(ctx);
+    }
+    if (ctx->estatisticas) ctx->estatisticas->faltas_cache++;
+
+    // Os diagnosticos vao para a entrada sem o prefixo do lote: outro arquivo com o mesmo
+    // conteudo usa a mesma entrada
+    char *mensagens;
+    size_t tamanho_mensagens;
+    int resultado = traduzir_capturando(ctx, opcoes, emissao, &mensagens, &tamanho_mensagens);
+    if (!mensagens) return resultado;
+    repetir_diagnosticos(ctx, mensagens, tamanho_mensagens);
+
+    if (resultado == 0 && gravar_entrada_cache(ctx, opcoes, chave, mensagens, tamanho_mensagens) != 0) {
+        reportar_erro(ctx, "aviso: nao foi possivel gravar no cache %s: %s\n", opcoes->cache.diretorio, strerror(errno));
+    }
+    free(mensagens);
+    return resultado;
+}
+
+//Thread do lexico em fluxo: enche lotes de tokens ate o TOKEN_EOF ou o cancelamento
+static void *executar_lexico_fluxo(void *argumento) {
+    FluxoCompilacao *fluxo = argumento;
+    for (;;) {
+        LoteTokens *lote = lote_para_escrever(&fluxo->tokens);
+        if (!lote) return NULL;
+        uint64_t inicio = fluxo->estatisticas ? ler_ciclos() : 0;
+        Token token;
+        int n = 0;
+        do {
+            token = proximo_token(&fluxo->lexico);
+            lote->tokens[n++] = token;
+        } while (token.tipo != TOKEN_EOF && n < TOKENS_POR_LOTE);
+        lote->num_tokens = n;
+        if (fluxo->estatisticas) fluxo->ciclos_lexico += ciclos_desde(fluxo->estatisticas, inicio);
+        publicar_lote(&fluxo->tokens);
+        if (token.tipo == TOKEN_EOF) return NULL;
+    }
+}
+
+//Thread da escrita em fluxo: formata cada lote no FILE proprio, que descarrega com write(2)
+//de TAMANHO_ESCRITA_FLUXO, ate o lote final ou o cancelamento. Depois de um erro de escrita
+//segue consumindo, sem escrever
+static void *executar_escrita_fluxo(void *argumento) {
+    FluxoCompilacao *fluxo = argumento;
+    for (;;) {
+        LoteInstrucoes *lote = lote_para_ler(&fluxo->instrucoes);
+        if (!lote) return NULL;
+        int ultimo = lote->ultimo;
+        if (!fluxo->erro_escrita) {
+            uint64_t inicio = fluxo->estatisticas ? ler_ciclos() : 0;
+            CodigoMepa trecho = { lote->instrucoes, lote->num_instrucoes, INSTRUCOES_POR_LOTE, 0, 0 };
+            fluxo->erro_escrita = escrever_codigo_texto(&trecho, fluxo->escrita) != 0;
+            if (fluxo->estatisticas) fluxo->ciclos_escrita += ciclos_desde(fluxo->estatisticas, inicio);
+        }
+        devolver_lote(&fluxo->instrucoes);
+        if (ultimo) return NULL;
+    }
+}
+
+//FILE da escrita sobre uma copia do descritor da saida, com buffer grande. Sem descritor
+//(um FILE em memoria), escreve na propria saida
+static FILE *abrir_escrita_fluxo(FILE *saida) {
+    fflush(saida);
+    int fd = fileno(saida) >= 0 ? dup(fileno(saida)) : -1;
+    FILE *escrita = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!escrita) {
+        if (fd >= 0) close(fd);
+        return saida;
+    }
+    setvbuf(escrita, NULL, _IOFBF, TAMANHO_ESCRITA_FLUXO);
+    return escrita;
+}
+
+//Retorna -1 se a analise foi abandonada no limite de erros
+static int analisar_programa_protegido(ContextoCompilador *ctx) {
+    if (setjmp(ctx->recuperacao_erro) != 0) return -1;
+    analisar_programa(ctx);
+    return 0;
+}
+
+//--stream: o codigo sai enquanto o fonte ainda e lido. Com erro, a saida ja escrita fica
+//incompleta: o arquivo de -o e removido, a saida padrao fica como esta. Retorna 0 ou 1
+static int compilar_em_fluxo(ContextoCompilador *ctx, const OpcoesCompilacao *opcoes, const char *caminho_saida) {
+    FluxoCompilacao fluxo;
+    memset(&fluxo, 0, sizeof(fluxo));
+    if (iniciar_anel_lotes(&fluxo.tokens, LOTES_POR_FILA, sizeof(LoteTokens)) != 0) {
+        reportar_erro(ctx, "Erro: memoria insuficiente\n");
+        fechar_fonte(&ctx->fonte);
+        return 1;
+    }
+    if (iniciar_anel_lotes(&fluxo.instrucoes, LOTES_POR_FILA, sizeof(LoteInstrucoes)) != 0) {
+        reportar_erro(ctx, "Erro: memoria insuficiente\n");
+        liberar_anel_lotes(&fluxo.tokens);
+        fechar_fonte(&ctx->fonte);
+        return 1;
+    }
+    FILE *saida = opcoes->saida;
+    if (caminho_saida) {
+        saida = fopen(caminho_saida, "w");
+        if (!saida) {
+            reportar_erro(ctx, "Erro ao criar o arquivo de saida: %s\n", strerror(errno));
+            liberar_anel_lotes(&fluxo.tokens);
+            liberar_anel_lotes(&fluxo.instrucoes);
+            fechar_fonte(&ctx->fonte);
+            return 1;
+        }
+    }
+    fluxo.fonte = &ctx->fonte;
+    fluxo.estatisticas = ctx->estatisticas;
+    fluxo.escrita = abrir_escrita_fluxo(saida);
+    iniciar_analisador_lexico(&fluxo.lexico, ctx->fonte.dados, ctx->fonte.tamanho);
+
+    pthread_t lexico, escrita;
+    int erro_thread = pthread_create(&lexico, NULL, executar_lexico_fluxo, &fluxo);
+    if (erro_thread == 0) {
+        erro_thread = pthread_create(&escrita, NULL, executar_escrita_fluxo, &fluxo);
+        if (erro_thread != 0) {
+            cancelar_anel_lotes(&fluxo.tokens);
+            pthread_join(lexico, NULL);
+        }
+    }
+    int resultado = 1;
+    // Sem memoria na analise ou na geracao, as duas filas sao canceladas e as threads saem
+    // por elas; volatile: o lexico pode ja ter sido esperado antes do longjmp
+    volatile int lexico_ativo = erro_thread == 0;
+    jmp_buf recuperacao;
+    jmp_buf *anterior = definir_recuperacao_memoria(&recuperacao);
+    if (erro_thread != 0) {
+        reportar_erro(ctx, "Erro ao criar as threads: %s\n", strerror(erro_thread));
+    } else if (setjmp(recuperacao) != 0) {
+        cancelar_anel_lotes(&fluxo.tokens);
+        cancelar_anel_lotes(&fluxo.instrucoes);
+        if (lexico_ativo) pthread_join(lexico, NULL);
+        pthread_join(escrita, NULL);
+        ctx->fluxo = NULL;
+        devolver_memoria_contexto(ctx);
+        reportar_erro(ctx, "Erro: memoria insuficiente\n");
+    } else {
+        ctx->fluxo = &fluxo;
+        analisar_programa_protegido(ctx);
+        // O lexico pode estar parado com a fila cheia: a analise para no end ou no limite de erros
+        cancelar_anel_lotes(&fluxo.tokens);
+        pthread_join(lexico, NULL);
+        lexico_ativo = 0;
+        if (ctx->num_erros == 0) gerar_ir_fim(&ctx->ir);
+        enviar_codigo_fluxo(ctx, 1);
+        ctx->fluxo = NULL;
+        pthread_join(escrita, NULL);
+        if (ctx->estatisticas) {
+            ctx->estatisticas->ciclos[FASE_LEXICO] += fluxo.ciclos_lexico;
+            ctx->estatisticas->ciclos[FASE_EMISSAO] += fluxo.ciclos_escrita;
+        }
+
+        if (ctx->num_erros == 0 && !fluxo.falhou) {
+            imprimir_tabela_simbolos(ctx, fluxo.escrita);
+            resultado = 0;
+        }
+    }
+    definir_recuperacao_memoria(anterior);
+    fechar_fonte(&ctx->fonte);
+    liberar_anel_lotes(&fluxo.tokens);
+    liberar_anel_lotes(&fluxo.instrucoes);
+
+    int erro_escrita = fluxo.erro_escrita;
+    if (fluxo.escrita != saida) erro_escrita |= fclose(fluxo.escrita) != 0;
+    erro_escrita |= saida != opcoes->saida ? fclose(saida) != 0 : fflush(saida) != 0;
+    if (resultado == 0 && erro_escrita) {
+        reportar_erro(ctx, "Erro ao escrever a saida: %s\n", strerror(errno));
+        resultado = 1;
+    }
+    if (resultado != 0 && caminho_saida) remove(caminho_saida);
+    return resultado;
+}
+
+static int compilar_fonte(ContextoCompilador *ctx, const char *caminho_fonte,
+                          const OpcoesCompilacao *opcoes, const char *caminho_saida) {
+    ctx->arquivo_diagnostico = caminho_fonte;
+    ctx->diagnosticos_json = opcoes->diagnosticos_json;
+    ctx->limite_erros = opcoes->limite_erros;
+    if (abrir_fonte_entrada(&ctx->fonte, caminho_fonte, opcoes->entrada) != 0) {
+        reportar_erro(ctx, "Erro ao abrir o arquivo: %s\n", strerror(errno));
+        return 1;
+    }
+    // Posicoes dos tokens sao de 32 bits
+    if (ctx->fonte.tamanho > UINT32_MAX) {
+        reportar_erro(ctx, "Erro: arquivo fonte maior que 4 GiB\n");
+        fechar_fonte(&ctx->fonte);
+        return 1;
+    }
+    if (ctx->estatisticas) ctx->estatisticas->bytes_lidos += (long long)ctx->fonte.tamanho;
+    reiniciar_contexto(ctx);
+
+    if (opcoes->formato == SAIDA_TOKENS) {
+        preparar_lexico_paralelo(ctx, opcoes);
+        int resultado = listar_tokens(ctx, opcoes, caminho_saida);
+        encerrar_lexico_paralelo(ctx);
+        fechar_fonte(&ctx->fonte);
+        return resultado;
+    }
+    if (opcoes->fluxo) {
+        return compilar_em_fluxo(ctx, opcoes, caminho_saida);
+    }
+
+    // O IR nao vai para o cache e o perfil precisa das linhas do fonte, que o objeto nao guarda
+    MarcaFase emissao;
+    int resultado = opcoes->cache.diretorio && opcoes->formato != SAIDA_IR && !opcoes->perfil
+                        ? traduzir_com_cache(ctx, opcoes, &emissao)
+                    : opcoes->diagnosticos_json ? traduzir_com_diagnosticos_json(ctx, opcoes, &emissao)
+                                                : traduzir_fonte(ctx, opcoes, &emissao);
+    if (resultado < 0) return 1;
+    // --run executa o codigo gerado na maquina MEPA embutida em vez de escreve-lo
+    int executar = opcoes->executar && opcoes->formato != SAIDA_IR;
+    if (resultado == 0 && !executar) {
+        resultado = escrever_saida(ctx, opcoes, caminho_saida);
+    }
+    encerrar_fase(ctx->estatisticas, FASE_EMISSAO, emissao);
+
+    if (resultado == 0 && executar) {
+        ProgramaVM programa;
+        resultado = preparar_programa_vm(&programa, &ctx->codigo, opcoes->erros);
+        if (resultado == 0) {
+            if (opcoes->perfil) ativar_perfil_vm(&programa);
+            resultado = executar_programa_vm(&programa, opcoes->entrada, opcoes->saida, NULL);
+            if (opcoes->perfil) resultado |= escrever_perfil(ctx, opcoes, programa.contagens, caminho_fonte);
+            liberar_programa_vm(&programa);
+        }
+        return resultado == 0 ? 0 : 1;
+    }
+    return resultado;
+}
+
+//Sem memoria no meio do arquivo, a compilacao volta aqui (ver memoria.h): so o arquivo
+//falha. O contexto continua utilizavel, o proximo arquivo o reinicia
+static int compilar_fonte_protegido(ContextoCompilador *ctx, const char *caminho_fonte,
+                                    const OpcoesCompilacao *opcoes, const char *caminho_saida) {
+    jmp_buf recuperacao;
+    jmp_buf *anterior = definir_recuperacao_memoria(&recuperacao);
+    int resultado;
+    if (setjmp(recuperacao) != 0) {
+        encerrar_lexico_paralelo(ctx);
+        fechar_fonte(&ctx->fonte);
+        devolver_memoria_contexto(ctx);
+        reportar_erro(ctx, "Erro: memoria insuficiente\n");
+        resultado = 1;
+    } else {
+        resultado = compilar_fonte(ctx, caminho_fonte, opcoes, caminho_saida);
+    }
+    definir_recuperacao_memoria(anterior);
+    return resultado;
+}
+
+//Compila um arquivo com o contexto dado. Retorna 0 ou 1; erros vao para ctx->diagnosticos
+int compilar_arquivo(ContextoCompilador *ctx, const char *caminho_fonte,
+                     const OpcoesCompilacao *opcoes, const char *caminho_saida) {
+    EstatisticasCompilacao *estatisticas = ctx->estatisticas;
+    if (!estatisticas) {
+        return compilar_fonte_protegido(ctx, caminho_fonte, opcoes, caminho_saida);
+    }
+
+    struct timespec inicio, fim;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    uint64_t ciclos = ler_ciclos();
+    int resultado = compilar_fonte_protegido(ctx, caminho_fonte, opcoes, caminho_saida);
+    estatisticas->ciclos_total += ler_ciclos() - ciclos;
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    estatisticas->segundos_total += (double)(fim.tv_sec - inicio.tv_sec) + (fim.tv_nsec - inicio.tv_nsec) * 1e-9;
+
+    estatisticas->arquivos++;
+    estatisticas->falhas += resultado != 0;
+    acumular_contadores_hash(&estatisticas->tabela_simbolos, &ctx->tabela_simbolos.contadores);
+    acumular_contadores_hash(&estatisticas->identificadores, &ctx->pool_identificadores.contadores);
+    estatisticas->rotulos += ctx->ir.proximo_rotulo - 1;
+    for (int i = 0; i < ctx->codigo.num_instrucoes; i++) {
+        estatisticas->instrucoes[ctx->codigo.instrucoes[i].opcode]++;
+    }
+    // Um arquivo que nem abre nao reinicia o contexto: nao pode contar o anterior de novo
+    memset(&ctx->tabela_simbolos.contadores, 0, sizeof(ctx->tabela_simbolos.contadores));
+    memset(&ctx->pool_identificadores.contadores, 0, sizeof(ctx->pool_identificadores.contadores));
+    limpar_codigo_ir(&ctx->ir);
+    ctx->codigo.num_instrucoes = 0;
+    ctx->codigo.desvios_absolutos = 0;
+    return resultado;
+}
+
+static int escrever_estatisticas(const EstatisticasCompilacao *estatisticas, const OpcoesCompilacao *opcoes) {
+    int erro = opcoes->estatisticas == ESTATISTICAS_JSON ? escrever_estatisticas_json(estatisticas, opcoes->erros)
+                                                         : escrever_estatisticas_texto(estatisticas, opcoes->erros);
+    return erro == 0 ? 0 : 1;
+}
+
+//Lista de arquivos do modo em lote, distribuida entre os trabalhadores por um indice atomico
+typedef struct {
+    char **arquivos;
+    int num_arquivos;
+    const OpcoesCompilacao *opcoes;
+    atomic_int proximo_arquivo;
+    atomic_int falhas;
+    pthread_mutex_t trava_diagnosticos;  // tambem protege estatisticas
+    EstatisticasCompilacao *estatisticas;
+} LoteCompilacao;
+
+static void *alocar_lote(void *ptr, size_t tamanho) {
+    void *novo = realloc(ptr, tamanho);
+    if (!novo) memoria_insuficiente();
+    return novo;
+}
+
+static char *copiar_texto(const char *texto, size_t tamanho) {
+    char *copia = alocar_lote(NULL, tamanho + 1);
+    memcpy(copia, texto, tamanho);
+    copia[tamanho] = '\0';
+    return copia;
+}
+
+//Saida ao lado do fonte: a extensao e trocada pela do formato (.mepa, .mepb, .s ou nenhuma).
+//Em malloc; NULL sem memoria
+static char *caminho_saida_lote(const char *caminho_fonte, FormatoSaida formato) {
+    static const char *const extensoes[] = {
+        [SAIDA_TEXTO] = ".mepa", [SAIDA_BINARIA] = ".mepb",
+        [SAIDA_ASSEMBLY] = ".s", [SAIDA_EXECUTAVEL] = "", [SAIDA_IR] = ".ir",
+        [SAIDA_TOKENS] = ".tokens",
+    };
+    size_t tamanho = strlen(caminho_fonte);
+    const char *ponto = strrchr(caminho_fonte, '.');
+    const char *barra = strrchr(caminho_fonte, '/');
+    if (ponto && ponto > caminho_fonte && (!barra || ponto > barra + 1)) {
+        tamanho = (size_t)(ponto - caminho_fonte);
+    }
+    // Sem extensao o executavel sobrescreveria o proprio fonte
+    const char *extensao = extensoes[formato];
+    if (formato == SAIDA_EXECUTAVEL && tamanho == strlen(caminho_fonte)) extensao = ".out";
+
+    char *caminho = malloc(tamanho + strlen(extensao) + 1);
+    if (!caminho) return NULL;
+    memcpy(caminho, caminho_fonte, tamanho);
+    strcpy(caminho + tamanho, extensao);
+    return caminho;
+}
+
+static void *trabalhador_lote(void *argumento) {
+    LoteCompilacao *lote = argumento;
+    ContextoCompilador ctx;
+    iniciar_contexto(&ctx);
+    // Cada thread conta no seu e soma no total do lote so no fim
+    EstatisticasCompilacao estatisticas;
+    iniciar_estatisticas(&estatisticas);
+    if (lote->estatisticas) ctx.estatisticas = &estatisticas;
+
+    for (;;) {
+        int indice = atomic_fetch_add(&lote->proximo_arquivo, 1);
+        if (indice >= lote->num_arquivos) break;
+        const char *caminho_fonte = lote->arquivos[indice];
+
+        // Diagnosticos de cada arquivo sao acumulados e escritos juntos, sem se misturar
+        char *mensagens = NULL;
+        size_t tamanho_mensagens = 0;
+        FILE *diagnosticos = open_memstream(&mensagens, &tamanho_mensagens);
+        size_t tamanho_prefixo = strlen(caminho_fonte) + 2;
+        char *prefixo = malloc(tamanho_prefixo);
+        if (prefixo) snprintf(prefixo, tamanho_prefixo, "%s:", caminho_fonte);
+        ctx.diagnosticos = diagnosticos ? diagnosticos : lote->opcoes->erros;
+        ctx.prefixo_diagnostico = prefixo ? prefixo : "";
+
+        // As threads do lote nao tem ponto de recuperacao fora de compilar_arquivo: aqui a
+        // falta de memoria so falha o arquivo
+        char *caminho_saida = caminho_saida_lote(caminho_fonte, lote->opcoes->formato);
+        int resultado = 1;
+        if (!prefixo || !caminho_saida) {
+            fprintf(ctx.diagnosticos, "%s: Erro: memoria insuficiente\n", caminho_fonte);
+        } else {
+            resultado = compilar_arquivo(&ctx, caminho_fonte, lote->opcoes, caminho_saida);
+        }
+        if (resultado != 0) {
+            atomic_fetch_add(&lote->falhas, 1);
+        }
+
+        if (diagnosticos) {
+            fclose(diagnosticos);
+            if (tamanho_mensagens > 0) {
+                pthread_mutex_lock(&lote->trava_diagnosticos);
+                fwrite(mensagens, 1, tamanho_mensagens, lote->opcoes->erros);
+                pthread_mutex_unlock(&lote->trava_diagnosticos);
+            }
+            free(mensagens);
+        }
+        free(caminho_saida);
+        free(prefixo);
+    }
+
+    if (lote->estatisticas) {
+        pthread_mutex_lock(&lote->trava_diagnosticos);
+        acumular_estatisticas(lote->estatisticas, &estatisticas);
+        pthread_mutex_unlock(&lote->trava_diagnosticos);
+    }
+    liberar_contexto(&ctx);
+    return NULL;
+}
+
+//Compila todos os arquivos com num_trabalhadores threads. Retorna o numero de falhas;
+//estatisticas (NULL sem --stats) recebe a soma de todos os arquivos
+static int compilar_lote(char **arquivos, int num_arquivos, const OpcoesCompilacao *opcoes,
+                         int num_trabalhadores, EstatisticasCompilacao *estatisticas) {
+    LoteCompilacao lote;
+    lote.arquivos = arquivos;
+    lote.num_arquivos = num_arquivos;
+    lote.opcoes = opcoes;
+    lote.estatisticas = estatisticas;
+    atomic_init(&lote.proximo_arquivo, 0);
+    atomic_init(&lote.falhas, 0);
+    pthread_mutex_init(&lote.trava_diagnosticos, NULL);
+
+    if (num_trabalhadores > num_arquivos) num_trabalhadores = num_arquivos;
+    pthread_t *threads = alocar_lote(NULL, (size_t)num_trabalhadores * sizeof(pthread_t));
+    int iniciadas = 0;
+    for (int i = 1; i < num_trabalhadores; i++) {
+        if (pthread_create(&threads[iniciadas], NULL, trabalhador_lote, &lote) != 0) break;
+        iniciadas++;
+    }
+    // A thread principal tambem trabalha; se nenhuma outra subir, o lote ainda termina
+    trabalhador_lote(&lote);
+    for (int i = 0; i < iniciadas; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    pthread_mutex_destroy(&lote.trava_diagnosticos);
+    return atomic_load(&lote.falhas);
+}
+
+//Acrescenta os caminhos de um arquivo de lista (um por linha, linhas vazias ignoradas)
+static int ler_lista_arquivos(const char *caminho_lista, char ***arquivos, int *num_arquivos, int *capacidade,
+                              FILE *erros) {
+    ArquivoFonte lista;
+    if (abrir_fonte(&lista, caminho_lista) != 0) {
+        fprintf(erros, "Erro ao abrir a lista de arquivos: %s\n", strerror(errno));
+        return -1;
+    }
+    const char *cursor = lista.dados;
+    const char *fim = lista.dados + lista.tamanho;
+    while (cursor < fim) {
+        const char *fim_linha = memchr(cursor, '\n', (size_t)(fim - cursor));
+        if (!fim_linha) fim_linha = fim;
+        const char *fim_caminho = fim_linha;
+        while (fim_caminho > cursor && isspace((unsigned char)fim_caminho[-1])) fim_caminho--;
+        if (fim_caminho > cursor) {
+            if (*num_arquivos == *capacidade) {
+                *capacidade = *capacidade ? *capacidade * 2 : 64;
+                *arquivos = alocar_lote(*arquivos, (size_t)*capacidade * sizeof(char *));
+            }
+            (*arquivos)[(*num_arquivos)++] = copiar_texto(cursor, (size_t)(fim_caminho - cursor));
+        }
+        cursor = fim_linha + 1;
+    }
+    fechar_fonte(&lista);
+    return 0;
+}
+
+//Numero de bytes com sufixo K, M ou G opcional (potencias de 1024); -1 se invalido
+static long long ler_limite_cache(const char *texto) {
+    char *fim;
+    long long valor = strtoll(texto, &fim, 10);
+    if (fim == texto || valor < 0) return -1;
+    int deslocamento = 0;
+    if (*fim == 'K' || *fim == 'k') deslocamento = 10;
+    else if (*fim == 'M' || *fim == 'm') deslocamento = 20;
+    else if (*fim == 'G' || *fim == 'g') deslocamento = 30;
+    if (deslocamento) fim++;
+    if (*fim != '\0' || valor > (LLONG_MAX >> deslocamento)) return -1;
+    return valor << deslocamento;
+}
+
+void imprimir_uso(const char *programa, FILE *erros) {
+    fprintf(erros, "Uso: %s [-O0|-O1|-O2] [--unroll=N] [--opt-report] [--emit=text|bin|asm|exe|ir|tokens] [--labels=symbolic|absolute] [--lex-threads=N] [--stream] [--stats[=json]] [--max-errors=N] [--diagnostics=text|json] [--cache=dir [--cache-size=N]] [--run [--profile[=pilhas.folded]]] [-o saida] <arquivo-fonte>\n"
+                    "     %s [-j N] [-O0|-O1|-O2] [--emit=text|bin|asm|exe|ir|tokens] [--labels=symbolic|absolute] [--lex-threads=N] [--stream] [--stats[=json]] [--max-errors=N] [--diagnostics=text|json] [--cache=dir [--cache-size=N]] <arquivo-fonte|@lista>...\n"
+                   "     %s --daemon[=socket] [-j N]\n",
+            programa, programa, programa);
+}
+//Uma execucao da linha de comando, com entrada, saida e erros no lugar de stdin, stdout e
+//stderr. ctx_servidor (NULL fora do modo servidor) e o contexto do trabalhador, ja com
+//tabelas e arena alocadas, usado quando ha um unico arquivo. Retorna o codigo de saida
+static int executar_linha_comando(int argc, char *argv[], ContextoCompilador *ctx_servidor,
+                                  FILE *entrada, FILE *saida, FILE *erros) {
+    const char *caminho_saida = NULL;
+    OpcoesCompilacao opcoes = { SAIDA_TEXTO, 0, 0, FATOR_DESENROLAR_PADRAO, 0, ESTATISTICAS_DESLIGADAS, 0, NULL, 0,
+                                { NULL, LIMITE_CACHE_PADRAO }, LIMITE_ERROS_PADRAO, 0, 1, 0, entrada, saida, erros };
+    EstatisticasCompilacao estatisticas;
+    iniciar_estatisticas(&estatisticas);
+    int num_trabalhadores = -1;
+    char **arquivos = NULL;
+    int num_arquivos = 0;
+    int capacidade_arquivos = 0;
+    int resultado = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--emit=text") == 0) {
+            opcoes.formato = SAIDA_TEXTO;
+        } else if (strcmp(argv[i], "--emit=bin") == 0) {
+            opcoes.formato = SAIDA_BINARIA;
+        } else if (strcmp(argv[i], "--emit=asm") == 0) {
+            opcoes.formato = SAIDA_ASSEMBLY;
+        } else if (strcmp(argv[i], "--emit=exe") == 0) {
+            opcoes.formato = SAIDA_EXECUTAVEL;
+        } else if (strcmp(argv[i], "--emit=ir") == 0) {
+            opcoes.formato = SAIDA_IR;
+        } else if (strcmp(argv[i], "--emit=tokens") == 0) {
+            opcoes.formato = SAIDA_TOKENS;
+        } else if (strcmp(argv[i], "-O0") == 0) {
+            opcoes.nivel_otimizacao = 0;
+        } else if (strcmp(argv[i], "-O1") == 0) {
+            opcoes.nivel_otimizacao = 1;
+        } else if (strcmp(argv[i], "-O2") == 0) {
+            opcoes.nivel_otimizacao = 2;
+        } else if (strncmp(argv[i], "--unroll=", 9) == 0) {
+            // 1 desliga o desenrolamento
+            char *fim_valor;
+            long fator = strtol(argv[i] + 9, &fim_valor, 10);
+            if (argv[i][9] == '\0' || *fim_valor != '\0' || fator < 1 || fator > MAX_FATOR_DESENROLAR) {
+                imprimir_uso(argv[0], erros);
+                goto fim;
+            }
+            opcoes.fator_desenrolar = (int)fator;
+        } else if (strcmp(argv[i], "--labels=symbolic") == 0) {
+            opcoes.desvios_absolutos = 0;
+        } else if (strcmp(argv[i], "--labels=absolute") == 0) {
+            opcoes.desvios_absolutos = 1;
+        } else if (strncmp(argv[i], "--cache=", 8) == 0 && argv[i][8] != '\0') {
+            opcoes.cache.diretorio = argv[i] + 8;
+        } else if (strncmp(argv[i], "--cache-size=", 13) == 0) {
+            opcoes.cache.limite = ler_limite_cache(argv[i] + 13);
+            if (opcoes.cache.limite < 0) {
+                imprimir_uso(argv[0], erros);
+                goto fim;
+            }
+        } else if (strncmp(argv[i], "--max-errors=", 13) == 0) {
+            // 0 analisa o arquivo inteiro
+            char *fim_valor;
+            long limite = strtol(argv[i] + 13, &fim_valor, 10);
+            if (argv[i][13] == '\0' || *fim_valor != '\0' || limite < 0 || limite > INT_MAX) {
+                imprimir_uso(argv[0], erros);
+                goto fim;
+            }
+            opcoes.limite_erros = (int)limite;
+        } else if (strncmp(argv[i], "--lex-threads=", 14) == 0) {
+            // 0 usa uma thread por processador
+            char *fim_valor;
+            long n = strtol(argv[i] + 14, &fim_valor, 10);
+            if (argv[i][14] == '\0' || *fim_valor != '\0' || n < 0 || n > 1024) {
+                imprimir_uso(argv[0], erros);
+                goto fim;
+            }
+            opcoes.threads_lexico = (int)n;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            opcoes.fluxo = 1;
+        } else if (strcmp(argv[i], "--diagnostics=text") == 0) {
+            opcoes.diagnosticos_json = 0;
+        } else if (strcmp(argv[i], "--diagnostics=json") == 0) {
+            opcoes.diagnosticos_json = 1;
+        } else if (strcmp(argv[i], "--opt-report") == 0) {
+            opcoes.relatorio_otimizacao = 1;
+        } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=text") == 0) {
+            opcoes.estatisticas = ESTATISTICAS_TEXTO;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            opcoes.estatisticas = ESTATISTICAS_JSON;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            opcoes.executar = 1;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            opcoes.perfil = 1;
+        } else if (strncmp(argv[i], "--profile=", 10) == 0 && argv[i][10] != '\0') {
+            opcoes.perfil = 1;
+            opcoes.caminho_pilhas = argv[i] + 10;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            caminho_saida = argv[++i];
+        } else if (strncmp(argv[i], "-j", 2) == 0) {
+            // -j N ou -jN; -j0 usa um trabalhador por processador
+            const char *valor = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+            char *fim_valor;
+            long n = strtol(valor, &fim_valor, 10);
+            if (*valor == '\0' || *fim_valor != '\0' || n < 0 || n > 1024) {
+                imprimir_uso(argv[0], erros);
+                goto fim;
+            }
+            num_trabalhadores = (int)n;
+        } else if (argv[i][0] == '@' && argv[i][1] != '\0') {
+            if (ler_lista_arquivos(argv[i] + 1, &arquivos, &num_arquivos, &capacidade_arquivos, erros) != 0) goto fim;
+            if (num_trabalhadores < 0) num_trabalhadores = 0;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            imprimir_uso(argv[0], erros);
+            goto fim;
+        } else {
+            if (num_arquivos == capacidade_arquivos) {
+                capacidade_arquivos = capacidade_arquivos ? capacidade_arquivos * 2 : 16;
+                arquivos = alocar_lote(arquivos, (size_t)capacidade_arquivos * sizeof(char *));
+            }
+            arquivos[num_arquivos++] = copiar_texto(argv[i], strlen(argv[i]));
+        }
+    }
+    if (num_arquivos == 0 && num_trabalhadores < 0) {
+        imprimir_uso(argv[0], erros);
+        goto fim;
+    }
+    if (opcoes.perfil && !opcoes.executar) {
+        fprintf(erros, "Erro: --profile so pode ser usado com --run\n");
+        goto fim;
+    }
+    // As otimizacoes, o binario (que comeca pelo numero de instrucoes), os desvios absolutos e
+    // --run precisam do codigo inteiro antes de escrever
+    if (opcoes.fluxo && (opcoes.nivel_otimizacao > 0 || opcoes.formato != SAIDA_TEXTO ||
+                         opcoes.desvios_absolutos || opcoes.executar)) {
+        fprintf(erros, "Erro: --stream so gera texto em -O0, sem --labels=absolute nem --run\n");
+        goto fim;
+    }
+    EstatisticasCompilacao *coletadas = opcoes.estatisticas != ESTATISTICAS_DESLIGADAS ? &estatisticas : NULL;
+
+    // Um unico arquivo sem -j nem lista: saida em stdout (ou -o) como sempre
+    if (num_arquivos == 1 && num_trabalhadores < 0) {
+        ContextoCompilador local;
+        ContextoCompilador *ctx = ctx_servidor ? ctx_servidor : &local;
+        if (!ctx_servidor) iniciar_contexto(&local);
+        ctx->estatisticas = coletadas;
+        ctx->diagnosticos = erros;
+        ctx->prefixo_diagnostico = "";
+        resultado = compilar_arquivo(ctx, arquivos[0], &opcoes, caminho_saida);
+        if (!ctx_servidor) liberar_contexto(&local);
+        if (coletadas) resultado |= escrever_estatisticas(coletadas, &opcoes);
+        goto fim;
+    }
+
+    if (caminho_saida || opcoes.executar) {
+        fprintf(erros, "Erro: -o e --run nao podem ser usados com varios arquivos\n");
+        goto fim;
+    }
+    for (int i = 0; i < num_arquivos; i++) {
+        if (strcmp(arquivos[i], "-") == 0) {
+            fprintf(erros, "Erro: a entrada padrao nao pode ser usada com varios arquivos\n");
+            goto fim;
+        }
+    }
+    if (num_arquivos == 0) {
+        resultado = 0;
+        goto fim;
+    }
+    if (num_trabalhadores <= 0) {
+        long processadores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_trabalhadores = processadores > 0 ? (int)processadores : 1;
+    }
+    resultado = compilar_lote(arquivos, num_arquivos, &opcoes, num_trabalhadores, coletadas) == 0 ? 0 : 1;
+    if (coletadas) resultado |= escrever_estatisticas(coletadas, &opcoes);
+
+fim:
+    for (int i = 0; i < num_arquivos; i++) free(arquivos[i]);
+    free(arquivos);
+    return resultado;
+}
+
+//Modo servidor (--daemon): cada trabalhador espera conexoes no mesmo socket com accept e
+//guarda o seu contexto entre os pedidos. Com os descritores e o diretorio do cliente, o
+//pedido roda como o main() rodaria no cliente (ver servidor_compilacao.h)
+static char caminho_socket_servidor[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+static void encerrar_servidor(int sinal) {
+    unlink(caminho_socket_servidor);
+    signal(sinal, SIG_DFL);
+    raise(sinal);
+}
+
+static int ler_tudo(int fd, void *destino, size_t tamanho) {
+    char *p = destino;
+    while (tamanho > 0) {
+        ssize_t lidos = read(fd, p, tamanho);
+        if (lidos < 0 && errno == EINTR) continue;
+        if (lidos <= 0) return -1;
+        p += lidos;
+        tamanho -= (size_t)lidos;
+    }
+    return 0;
+}
+
+//Recebe cabecalho, descritores e linha de comando; argv (em malloc, terminado em NULL)
+//aponta para dentro de *texto. Retorna 0 ou -1 (conexao fechada, pedido malformado ou sem
+//memoria para ele)
+static int receber_pedido(int conexao, CabecalhoPedido *cabecalho, int descritores[DESCRITORES_PEDIDO],
+                          char **texto, char ***argv) {
+    *texto = NULL;
+    *argv = NULL;
+    // Antes de receber qualquer descritor: pedidos so do usuario do servidor
+    if (!mesmo_usuario(conexao)) return -1;
+    union {
+        struct cmsghdr alinhamento;
+        char dados[CMSG_SPACE(sizeof(int) * DESCRITORES_PEDIDO)];
+    } controle;
+    struct iovec vetor = { cabecalho, sizeof(*cabecalho) };
+    struct msghdr mensagem;
+    memset(&mensagem, 0, sizeof(mensagem));
+    mensagem.msg_iov = &vetor;
+    mensagem.msg_iovlen = 1;
+    mensagem.msg_control = controle.dados;
+    mensagem.msg_controllen = sizeof(controle.dados);
+
+    ssize_t lidos;
+    do {
+        lidos = recvmsg(conexao, &mensagem, MSG_CMSG_CLOEXEC);
+    } while (lidos < 0 && errno == EINTR);
+    int recebidos = 0;
+    struct cmsghdr *anexo = lidos > 0 ? CMSG_FIRSTHDR(&mensagem) : NULL;
+    if (anexo && anexo->cmsg_level == SOL_SOCKET && anexo->cmsg_type == SCM_RIGHTS) {
+        recebidos = (int)((anexo->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        memcpy(descritores, CMSG_DATA(anexo), (size_t)recebidos * sizeof(int));
+    }
+    int valido = lidos > 0 && recebidos == DESCRITORES_PEDIDO && !(mensagem.msg_flags & MSG_CTRUNC) &&
+                 ler_tudo(conexao, (char *)cabecalho + lidos, sizeof(*cabecalho) - (size_t)lidos) == 0 &&
+                 cabecalho->tamanho > 0 && cabecalho->tamanho <= MAX_TAMANHO_PEDIDO &&
+                 cabecalho->argc > 0 && cabecalho->argc <= cabecalho->tamanho;
+    // Sem memoria para o pedido, ele e recusado como um malformado
+    if (valido) {
+        *texto = malloc(cabecalho->tamanho);
+        valido = *texto && ler_tudo(conexao, *texto, cabecalho->tamanho) == 0 &&
+                 (*texto)[cabecalho->tamanho - 1] == '\0';
+    }
+    if (valido) {
+        *argv = malloc(((size_t)cabecalho->argc + 1) * sizeof(char *));
+        valido = *argv != NULL;
+    }
+    if (valido) {
+        uint32_t argc = 0;
+        for (uint32_t i = 0; i < cabecalho->tamanho && argc <= cabecalho->argc; i += (uint32_t)strlen(*texto + i) + 1) {
+            if (argc < cabecalho->argc) (*argv)[argc] = *texto + i;
+            argc++;
+        }
+        (*argv)[cabecalho->argc] = NULL;
+        valido = argc == cabecalho->argc;
+    }
+    if (!valido) {
+        for (int i = 0; i < recebidos; i++) close(descritores[i]);
+        free(*texto);
+        free(*argv);
+        return -1;
+    }
+    return 0;
+}
+
+static FILE *abrir_descritor(int fd, const char *modo) {
+    FILE *arquivo = fdopen(fd, modo);
+    if (!arquivo) close(fd);
+    return arquivo;
+}
+
+//Cada arquivo ja se recupera em compilar_arquivo; este ponto pega o resto do pedido (listas
+//de arquivos, argumentos) sem memoria: o pedido falha e o servidor continua
+static int executar_pedido_protegido(ContextoCompilador *ctx, int argc, char *argv[],
+                                     FILE *entrada, FILE *saida, FILE *erros) {
+    jmp_buf recuperacao;
+    jmp_buf *anterior = definir_recuperacao_memoria(&recuperacao);
+    int resultado;
+    if (setjmp(recuperacao) != 0) {
+        fprintf(erros, "Erro: memoria insuficiente\n");
+        resultado = 1;
+    } else {
+        resultado = executar_linha_comando(argc, argv, ctx, entrada, saida, erros);
+    }
+    definir_recuperacao_memoria(anterior);
+    return resultado;
+}
+
+static void atender_pedido(ContextoCompilador *ctx, int conexao) {
+    // Um cliente parado no meio do pedido nao prende o trabalhador
+    struct timeval limite = { 10, 0 };
+    setsockopt(conexao, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+
+    CabecalhoPedido cabecalho;
+    int descritores[DESCRITORES_PEDIDO];
+    char *texto;
+    char **argv;
+    if (receber_pedido(conexao, &cabecalho, descritores, &texto, &argv) != 0) return;
+
+    FILE *entrada = abrir_descritor(descritores[0], "r");
+    FILE *saida = abrir_descritor(descritores[1], "w");
+    FILE *erros = abrir_descritor(descritores[2], "w");
+    int32_t status = 1;
+    if (entrada && saida && erros && fchdir(descritores[3]) == 0) {
+        // Como o stderr de um processo, os erros nao tem buffer
+        setvbuf(erros, NULL, _IONBF, 0);
+        umask((mode_t)cabecalho.mascara);
+        status = executar_pedido_protegido(ctx, (int)cabecalho.argc, argv, entrada, saida, erros);
+        fflush(saida);
+    }
+    ctx->estatisticas = NULL;
+    if (entrada) fclose(entrada);
+    if (saida) fclose(saida);
+    if (erros) fclose(erros);
+    close(descritores[3]);
+    free(texto);
+    free(argv);
+
+    ssize_t escritos;
+    do {
+        escritos = write(conexao, &status, sizeof(status));
+    } while (escritos < 0 && errno == EINTR);
+}
+
+static void *trabalhador_servidor(void *argumento) {
+    int escuta = *(const int *)argumento;
+    // O diretorio atual e o umask passam a ser so desta thread: cada pedido usa os do cliente
+    if (unshare(CLONE_FS) != 0) {
+        perror("Erro ao separar o diretorio atual do trabalhador");
+        return NULL;
+    }
+    ContextoCompilador ctx;
+    iniciar_contexto(&ctx);
+    for (;;) {
+        int conexao = accept4(escuta, NULL, NULL, SOCK_CLOEXEC);
+        if (conexao < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("Erro ao aceitar conexao");
+            break;
+        }
+        atender_pedido(&ctx, conexao);
+        close(conexao);
+    }
+    liberar_contexto(&ctx);
+    return NULL;
+}
+
+//--daemon[=socket] [-j N]: nao retorna enquanto houver trabalhadores
+static int iniciar_servidor(int argc, char *argv[]) {
+    char caminho[sizeof(caminho_socket_servidor)];
+    const char *escolhido = argv[1][8] == '=' ? argv[1] + 9 : getenv(VARIAVEL_SOCKET);
+    int tamanho;
+    if (escolhido && *escolhido) {
+        tamanho = snprintf(caminho, sizeof(caminho), "%s", escolhido);
+        if (tamanho < 0 || (size_t)tamanho >= sizeof(caminho)) {
+            fprintf(stderr, "Erro: caminho do socket muito longo\n");
+            return 1;
+        }
+    } else {
+        if (caminho_socket_padrao(caminho, sizeof(caminho), 1) != 0) {
+            fprintf(stderr, "Erro no diretorio do socket: %s\n", strerror(errno));
+            return 1;
+        }
+        tamanho = (int)strlen(caminho);
+    }
+
+    int num_trabalhadores = 0;
+    for (int i = 2; i < argc; i++) {
+        const char *valor = strncmp(argv[i], "-j", 2) == 0 ? (argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "")) : NULL;
+        char *fim_valor;
+        long n = valor ? strtol(valor, &fim_valor, 10) : -1;
+        if (!valor || *valor == '\0' || *fim_valor != '\0' || n < 0 || n > 1024) {
+            imprimir_uso(argv[0], stderr);
+            return 1;
+        }
+        num_trabalhadores = (int)n;
+    }
+    if (num_trabalhadores == 0) {
+        long processadores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_trabalhadores = processadores > 0 ? (int)processadores : 1;
+    }
+
+    struct sockaddr_un endereco;
+    memset(&endereco, 0, sizeof(endereco));
+    endereco.sun_family = AF_UNIX;
+    memcpy(endereco.sun_path, caminho, (size_t)tamanho + 1);
+    int escuta = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (escuta < 0) {
+        perror("Erro ao criar o socket");
+        return 1;
+    }
+    int ligado = bind(escuta, (struct sockaddr *)&endereco, sizeof(endereco)) == 0;
+    if (!ligado && errno == EADDRINUSE) {
+        // Um socket que ninguem atende sobrou de um servidor que terminou
+        int teste = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int ativo = teste >= 0 && connect(teste, (struct sockaddr *)&endereco, sizeof(endereco)) == 0;
+        if (teste >= 0) close(teste);
+        if (ativo) {
+            fprintf(stderr, "Erro: ja ha um servidor em %s\n", caminho);
+            close(escuta);
+            return 1;
+        }
+        unlink(caminho);
+        ligado = bind(escuta, (struct sockaddr *)&endereco, sizeof(endereco)) == 0;
+    }
+    if (!ligado || listen(escuta, SOMAXCONN) != 0) {
+        fprintf(stderr, "Erro ao abrir o socket %s: %s\n", caminho, strerror(errno));
+        close(escuta);
+        return 1;
+    }
+
+    memcpy(caminho_socket_servidor, caminho, (size_t)tamanho + 1);
+    signal(SIGINT, encerrar_servidor);
+    signal(SIGTERM, encerrar_servidor);
+    // Cliente que fecha a saida no meio da escrita vira erro de escrita, nao derruba o servidor
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "servidor em %s com %d trabalhadores\n", caminho, num_trabalhadores);
+
+    pthread_t *threads = alocar_lote(NULL, (size_t)num_trabalhadores * sizeof(pthread_t));
+    int iniciadas = 0;
+    for (int i = 1; i < num_trabalhadores; i++) {
+        if (pthread_create(&threads[iniciadas], NULL, trabalhador_servidor, &escuta) != 0) break;
+        iniciadas++;
+    }
+    trabalhador_servidor(&escuta);
+    for (int i = 0; i < iniciadas; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    close(escuta);
+    unlink(caminho);
+    return 1;
+}
+
+//Main
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && (strcmp(argv[1], "--daemon") == 0 || strncmp(argv[1], "--daemon=", 9) == 0)) {
+        return iniciar_servidor(argc, argv);
+    }
+    return executar_linha_comando(argc, argv, NULL, stdin, stdout, stderr);
+}
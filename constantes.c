@@ -0,0 +1,175 @@
+#include "constantes.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Valor conhecido de cada endereco de variavel no ponto atual do percurso
+typedef struct {
+    int *valores;
+    unsigned char *conhecidas;
+    EstatisticasConstantes *estatisticas;
+    FILE *avisos;
+    const char *prefixo;
+} EstadoConstantes;
+
+// Reescreve o no como o numero dado
+static void trocar_por_numero(NoAst *no, int valor) {
+    no->tipo = NO_NUMERO;
+    no->valor = valor;
+}
+
+// Simbolo do operador nos avisos
+static const char *simbolo_operador(TipoNo tipo) {
+    switch (tipo) {
+        case NO_SOMA:      return "+";
+        case NO_SUBTRACAO: return "-";
+        default:           return "*";
+    }
+}
+
+// Resultado de a op b como a MEPA calcula; 0 se nao puder ser dobrado (divisao por zero
+// fica para a execucao, que a informa)
+static int calcular(EstadoConstantes *estado, const NoAst *no, int a, int b, int *resultado) {
+    int64_t exato;
+    switch (no->tipo) {
+        case NO_SOMA:          exato = (int64_t)a + b; break;
+        case NO_SUBTRACAO:     exato = (int64_t)a - b; break;
+        case NO_MULTIPLICACAO: exato = (int64_t)a * b; break;
+        case NO_DIVISAO:
+        case NO_RESTO:
+            if (b == 0) return 0;
+            if (b == -1) {
+                *resultado = no->tipo == NO_DIVISAO ? (int)(0u - (unsigned)a) : 0;
+            } else {
+                *resultado = no->tipo == NO_DIVISAO ? a / b : a % b;
+            }
+            return 1;
+        case NO_IGUAL:         *resultado = a == b; return 1;
+        case NO_DIFERENTE:     *resultado = a != b; return 1;
+        case NO_MENOR:         *resultado = a < b; return 1;
+        case NO_MENOR_IGUAL:   *resultado = a <= b; return 1;
+        case NO_MAIOR:         *resultado = a > b; return 1;
+        case NO_MAIOR_IGUAL:   *resultado = a >= b; return 1;
+        case NO_E:             *resultado = a != 0 && b != 0; return 1;
+        case NO_OU:            *resultado = a != 0 || b != 0; return 1;
+        default:               return 0;
+    }
+
+    if (exato < INT32_MIN || exato > INT32_MAX) {
+        estado->estatisticas->transbordamentos++;
+        if (estado->avisos) {
+            fprintf(estado->avisos, "%s%d:aviso, expressao constante %d %s %d passa de 32 bits\n",
+                    estado->prefixo, no->linha, a, simbolo_operador(no->tipo), b);
+        }
+    }
+    *resultado = (int)(uint32_t)(uint64_t)exato;
+    return 1;
+}
+
+static void avaliar_expressao(EstadoConstantes *estado, NoAst *no) {
+    if (!no) return;
+    if (no->tipo == NO_VARIAVEL) {
+        if (estado->conhecidas[no->endereco]) {
+            trocar_por_numero(no, estado->valores[no->endereco]);
+            estado->estatisticas->propagadas++;
+        }
+        return;
+    }
+    if (no->tipo == NO_NAO) {
+        NoAst *operando = no->unario.operando;
+        avaliar_expressao(estado, operando);
+        if (operando && operando->tipo == NO_NUMERO) {
+            trocar_por_numero(no, operando->valor == 0);
+            estado->estatisticas->dobradas++;
+        }
+        return;
+    }
+    if (!no_binario(no->tipo)) return;
+
+    NoAst *esquerda = no->binario.esquerda;
+    NoAst *direita = no->binario.direita;
+    avaliar_expressao(estado, esquerda);
+    avaliar_expressao(estado, direita);
+    if (!esquerda || !direita) return;
+
+    // false and x e true or x: o lado direito nem seria avaliado
+    if ((no->tipo == NO_E || no->tipo == NO_OU) && esquerda->tipo == NO_NUMERO &&
+        (esquerda->valor != 0) == (no->tipo == NO_OU)) {
+        trocar_por_numero(no, no->tipo == NO_OU);
+        estado->estatisticas->dobradas++;
+        return;
+    }
+    int resultado;
+    if (esquerda->tipo == NO_NUMERO && direita->tipo == NO_NUMERO &&
+        calcular(estado, no, esquerda->valor, direita->valor, &resultado)) {
+        trocar_por_numero(no, resultado);
+        estado->estatisticas->dobradas++;
+    }
+}
+
+static void esquecer_bloco(unsigned char *conhecidas, const NoAst *comandos) {
+    for (const NoAst *no = comandos; no; no = no->proximo) {
+        switch (no->tipo) {
+            case NO_LEIA:       conhecidas[no->endereco] = 0; break;
+            case NO_ATRIBUICAO: conhecidas[no->atribuicao.endereco] = 0; break;
+            case NO_PARA:
+                conhecidas[no->para.contador] = 0;
+                esquecer_bloco(conhecidas, no->para.corpo);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Esquece o contador e tudo que o corpo do for altera: valem o antes e o depois do laco.
+// Percorre so o laco, nao todas as variaveis
+static void esquecer_alteradas(EstadoConstantes *estado, const NoAst *para) {
+    estado->conhecidas[para->para.contador] = 0;
+    esquecer_bloco(estado->conhecidas, para->para.corpo);
+}
+
+static void avaliar_bloco(EstadoConstantes *estado, NoAst *comandos) {
+    for (NoAst *no = comandos; no; no = no->proximo) {
+        switch (no->tipo) {
+            case NO_LEIA:
+                estado->conhecidas[no->endereco] = 0;
+                break;
+            case NO_ESCREVA:
+                avaliar_expressao(estado, no->escrita.valor);
+                break;
+            case NO_ATRIBUICAO: {
+                NoAst *valor = no->atribuicao.valor;
+                avaliar_expressao(estado, valor);
+                int endereco = no->atribuicao.endereco;
+                estado->conhecidas[endereco] = valor && valor->tipo == NO_NUMERO;
+                if (estado->conhecidas[endereco]) estado->valores[endereco] = valor->valor;
+                break;
+            }
+            case NO_PARA:
+                // O inicio roda uma vez antes do laco; o limite e o corpo, a cada volta
+                avaliar_expressao(estado, no->para.inicio);
+                esquecer_alteradas(estado, no);
+                avaliar_expressao(estado, no->para.limite);
+                avaliar_bloco(estado, no->para.corpo);
+                esquecer_alteradas(estado, no);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void propagar_constantes(ProgramaAst *programa, Arena *arena, EstatisticasConstantes *estatisticas,
+                         FILE *avisos, const char *prefixo) {
+    memset(estatisticas, 0, sizeof(*estatisticas));
+    // A MEPA comeca com a memoria zerada (AMEM), entao toda variavel comeca valendo 0
+    EstadoConstantes estado;
+    estado.valores = alocar_arena(arena, (size_t)programa->num_variaveis * sizeof(int) + 1);
+    estado.conhecidas = alocar_arena(arena, (size_t)programa->num_variaveis + 1);
+    memset(estado.conhecidas, 1, (size_t)programa->num_variaveis);
+    estado.estatisticas = estatisticas;
+    estado.avisos = avisos;
+    estado.prefixo = prefixo;
+    avaliar_bloco(&estado, programa->comandos);
+}
@@ -0,0 +1,25 @@
+#ifndef CONSTANTES_H
+#define CONSTANTES_H
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "ast.h"
+
+// Contadores da avaliacao de constantes
+typedef struct {
+    int dobradas;         // operacoes trocadas pelo resultado
+    int propagadas;       // leituras de variavel trocadas pelo valor conhecido
+    int transbordamentos; // somas, subtracoes e multiplicacoes constantes que passaram de 32 bits
+} EstatisticasConstantes;
+
+// -O1: avalia na compilacao as expressoes constantes e propaga o valor conhecido de cada
+// variavel pelo codigo sem desvios, reescrevendo a AST no lugar; um set de valor conhecido
+// vira CRCT/ARMZ. Um for esquece as variaveis que o corpo ou o contador alteram.
+// A aritmetica da a mesma volta modulo 2^32 da MEPA e a divisao por zero fica para a
+// execucao; cada transbordamento e avisado em avisos (se nao for NULL), com o prefixo de
+// diagnostico do arquivo
+void propagar_constantes(ProgramaAst *programa, Arena *arena, EstatisticasConstantes *estatisticas,
+                         FILE *avisos, const char *prefixo);
+
+#endif
@@ -0,0 +1,149 @@
+#include "estatisticas.h"
+
+#include <string.h>
+
+static const char *const nomes_fases[NUM_FASES] = {
+    [FASE_LEXICO] = "lexico", [FASE_DECLARACOES] = "declaracoes",
+    [FASE_COMANDOS] = "comandos", [FASE_EMISSAO] = "emissao",
+};
+
+// nome_token repete "simbolo" para os operadores e a pontuacao; aqui cada tipo precisa de um nome proprio
+static const char *nome_contador_token(TipoToken tipo) {
+    switch (tipo) {
+        case TOKEN_MULTIPLICACAO: return "multiplicacao";
+        case TOKEN_DOIS_PONTOS: return "dois_pontos";
+        case TOKEN_VIRGULA: return "virgula";
+        case TOKEN_SOMA: return "soma";
+        case TOKEN_SUBTRACAO: return "subtracao";
+        case TOKEN_IGUAL: return "igual";
+        case TOKEN_DIFERENTE: return "diferente";
+        case TOKEN_MENOR: return "menor";
+        case TOKEN_MENOR_IGUAL: return "menor_igual";
+        case TOKEN_MAIOR: return "maior";
+        case TOKEN_MAIOR_IGUAL: return "maior_igual";
+        default: return nome_token(tipo);
+    }
+}
+
+void iniciar_estatisticas(EstatisticasCompilacao *estatisticas) {
+    memset(estatisticas, 0, sizeof(*estatisticas));
+    // O menor de varios pares evita contar uma interrupcao no meio
+    uint64_t menor = UINT64_MAX;
+    for (int i = 0; i < 64; i++) {
+        uint64_t inicio = ler_ciclos();
+        uint64_t custo = ler_ciclos() - inicio;
+        if (custo < menor) menor = custo;
+    }
+    estatisticas->custo_leitura = menor;
+}
+
+void acumular_contadores_hash(ContadoresHash *destino, const ContadoresHash *origem) {
+    destino->consultas += origem->consultas;
+    destino->sondagens += origem->sondagens;
+    destino->colisoes += origem->colisoes;
+}
+
+void acumular_estatisticas(EstatisticasCompilacao *destino, const EstatisticasCompilacao *origem) {
+    destino->arquivos += origem->arquivos;
+    destino->falhas += origem->falhas;
+    destino->bytes_lidos += origem->bytes_lidos;
+    destino->acertos_cache += origem->acertos_cache;
+    destino->faltas_cache += origem->faltas_cache;
+    destino->segundos_total += origem->segundos_total;
+    destino->ciclos_total += origem->ciclos_total;
+    for (int f = 0; f < NUM_FASES; f++) destino->ciclos[f] += origem->ciclos[f];
+    for (int t = 0; t < NUM_TIPOS_TOKEN; t++) destino->tokens[t] += origem->tokens[t];
+    acumular_contadores_hash(&destino->tabela_simbolos, &origem->tabela_simbolos);
+    acumular_contadores_hash(&destino->identificadores, &origem->identificadores);
+    destino->rotulos += origem->rotulos;
+    for (int o = 0; o < NUM_OPCODES_MEPA; o++) destino->instrucoes[o] += origem->instrucoes[o];
+}
+
+static double segundos_fase(const EstatisticasCompilacao *estatisticas, int fase) {
+    if (estatisticas->ciclos_total == 0) return 0.0;
+    return estatisticas->segundos_total * (double)estatisticas->ciclos[fase] / (double)estatisticas->ciclos_total;
+}
+
+static long total_tokens(const EstatisticasCompilacao *estatisticas) {
+    long total = 0;
+    for (int t = 0; t < NUM_TIPOS_TOKEN; t++) total += estatisticas->tokens[t];
+    return total;
+}
+
+static long total_instrucoes(const EstatisticasCompilacao *estatisticas) {
+    long total = 0;
+    for (int o = 0; o < NUM_OPCODES_MEPA; o++) total += estatisticas->instrucoes[o];
+    return total;
+}
+
+int escrever_estatisticas_texto(const EstatisticasCompilacao *estatisticas, FILE *saida) {
+    fprintf(saida, "estatisticas: %d arquivo(s), %d com erro, %lld bytes lidos\n",
+            estatisticas->arquivos, estatisticas->falhas, estatisticas->bytes_lidos);
+    fprintf(saida, "  cache: %ld acertos, %ld faltas\n", estatisticas->acertos_cache, estatisticas->faltas_cache);
+    fprintf(saida, "  %-12s %12s %16s\n", "fase", "tempo (ms)", "ciclos");
+    for (int f = 0; f < NUM_FASES; f++) {
+        fprintf(saida, "  %-12s %12.3f %16llu\n", nomes_fases[f], segundos_fase(estatisticas, f) * 1e3,
+                (unsigned long long)estatisticas->ciclos[f]);
+    }
+    fprintf(saida, "  %-12s %12.3f %16llu\n", "total", estatisticas->segundos_total * 1e3,
+            (unsigned long long)estatisticas->ciclos_total);
+
+    fprintf(saida, "  tokens: %ld\n", total_tokens(estatisticas));
+    for (int t = 0; t < NUM_TIPOS_TOKEN; t++) {
+        if (estatisticas->tokens[t]) {
+            fprintf(saida, "    %-16s %12ld\n", nome_contador_token(t), estatisticas->tokens[t]);
+        }
+    }
+
+    const ContadoresHash *tabela = &estatisticas->tabela_simbolos;
+    const ContadoresHash *pool = &estatisticas->identificadores;
+    fprintf(saida, "  tabela de simbolos: %ld consultas, %ld sondagens, %ld colisoes\n",
+            tabela->consultas, tabela->sondagens, tabela->colisoes);
+    fprintf(saida, "  identificadores:    %ld consultas, %ld sondagens, %ld colisoes\n",
+            pool->consultas, pool->sondagens, pool->colisoes);
+    fprintf(saida, "  rotulos: %ld\n", estatisticas->rotulos);
+
+    fprintf(saida, "  instrucoes: %ld\n", total_instrucoes(estatisticas));
+    for (int o = 0; o < NUM_OPCODES_MEPA; o++) {
+        if (estatisticas->instrucoes[o]) {
+            fprintf(saida, "    %-16s %12ld\n", nome_opcode(o), estatisticas->instrucoes[o]);
+        }
+    }
+    return ferror(saida) ? -1 : 0;
+}
+
+static void escrever_contadores_json(FILE *saida, const char *nome, const ContadoresHash *contadores) {
+    fprintf(saida, "  \"%s\": {\"consultas\": %ld, \"sondagens\": %ld, \"colisoes\": %ld},\n",
+            nome, contadores->consultas, contadores->sondagens, contadores->colisoes);
+}
+
+int escrever_estatisticas_json(const EstatisticasCompilacao *estatisticas, FILE *saida) {
+    fprintf(saida, "{\n  \"arquivos\": %d,\n  \"falhas\": %d,\n  \"bytes_lidos\": %lld,\n",
+            estatisticas->arquivos, estatisticas->falhas, estatisticas->bytes_lidos);
+    fprintf(saida, "  \"cache\": {\"acertos\": %ld, \"faltas\": %ld},\n",
+            estatisticas->acertos_cache, estatisticas->faltas_cache);
+    fprintf(saida, "  \"fases\": {\n");
+    for (int f = 0; f < NUM_FASES; f++) {
+        fprintf(saida, "    \"%s\": {\"segundos\": %.9f, \"ciclos\": %llu},\n", nomes_fases[f],
+                segundos_fase(estatisticas, f), (unsigned long long)estatisticas->ciclos[f]);
+    }
+    fprintf(saida, "    \"total\": {\"segundos\": %.9f, \"ciclos\": %llu}\n  },\n",
+            estatisticas->segundos_total, (unsigned long long)estatisticas->ciclos_total);
+
+    fprintf(saida, "  \"tokens\": {");
+    for (int t = 0; t < NUM_TIPOS_TOKEN; t++) {
+        fprintf(saida, "%s\"%s\": %ld", t ? ", " : "", nome_contador_token(t), estatisticas->tokens[t]);
+    }
+    fprintf(saida, "},\n");
+
+    escrever_contadores_json(saida, "tabela_simbolos", &estatisticas->tabela_simbolos);
+    escrever_contadores_json(saida, "identificadores", &estatisticas->identificadores);
+    fprintf(saida, "  \"rotulos\": %ld,\n", estatisticas->rotulos);
+
+    fprintf(saida, "  \"instrucoes\": {");
+    for (int o = 0; o < NUM_OPCODES_MEPA; o++) {
+        fprintf(saida, "%s\"%s\": %ld", o ? ", " : "", nome_opcode(o), estatisticas->instrucoes[o]);
+    }
+    fprintf(saida, "}\n}\n");
+    return ferror(saida) ? -1 : 0;
+}
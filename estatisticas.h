@@ -0,0 +1,100 @@
+#ifndef ESTATISTICAS_H
+#define ESTATISTICAS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lexico.h"
+#include "mepa.h"
+#include "tabela_simbolos.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+// Fases medidas por --stats; cada uma exclui o tempo das fases aninhadas nela
+typedef enum {
+    FASE_LEXICO,        // obter_proximo_token, incluindo internar os identificadores (amostrado)
+    FASE_DECLARACOES,   // declaracao_variaveis
+    FASE_COMANDOS,      // funcao_composto e os comandos abaixo dela
+    FASE_EMISSAO,       // AST -> IR -> MEPA, peephole e escrita da saida
+    NUM_FASES
+} FaseCompilacao;
+
+// O lexico e cronometrado em um a cada AMOSTRA_LEXICO tokens e o tempo medido e multiplicado
+#define AMOSTRA_LEXICO 32
+
+typedef struct {
+    int arquivos;
+    int falhas;
+    long long bytes_lidos;
+    long acertos_cache;       // --cache: arquivos cujo codigo veio do cache
+    long faltas_cache;
+    double segundos_total;
+    uint64_t ciclos_total;
+    uint64_t ciclos[NUM_FASES];
+    long tokens[NUM_TIPOS_TOKEN];
+    ContadoresHash tabela_simbolos;
+    ContadoresHash identificadores;
+    long rotulos;
+    long instrucoes[NUM_OPCODES_MEPA];
+    unsigned amostra_lexico;
+    uint64_t custo_leitura;   // ciclos de duas leituras seguidas do contador, descontados das amostras
+} EstatisticasCompilacao;
+
+// Inicio de uma fase: o contador e os ciclos de lexico ja gastos, para descontar os aninhados
+typedef struct {
+    uint64_t ciclos;
+    uint64_t ciclos_lexico;
+} MarcaFase;
+
+// rdtsc no x86 (dezenas de ciclos por leitura); nanossegundos nas outras arquiteturas
+static inline uint64_t ler_ciclos(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+#endif
+}
+
+// Ciclos desde inicio, sem o custo da propria leitura do contador
+static inline uint64_t ciclos_desde(const EstatisticasCompilacao *estatisticas, uint64_t inicio) {
+    uint64_t decorridos = ler_ciclos() - inicio;
+    return decorridos > estatisticas->custo_leitura ? decorridos - estatisticas->custo_leitura : 0;
+}
+
+// As duas aceitam estatisticas NULL (--stats desligado) sem ler o contador
+static inline MarcaFase iniciar_fase(const EstatisticasCompilacao *estatisticas) {
+    MarcaFase marca = { 0, 0 };
+    if (estatisticas) {
+        marca.ciclos = ler_ciclos();
+        marca.ciclos_lexico = estatisticas->ciclos[FASE_LEXICO];
+    }
+    return marca;
+}
+
+static inline void encerrar_fase(EstatisticasCompilacao *estatisticas, FaseCompilacao fase, MarcaFase marca) {
+    if (estatisticas) {
+        // O lexico amostrado e uma estimativa e pode passar do tempo da fase em trechos curtos
+        uint64_t lexico = estatisticas->ciclos[FASE_LEXICO] - marca.ciclos_lexico;
+        uint64_t decorridos = ciclos_desde(estatisticas, marca.ciclos);
+        estatisticas->ciclos[fase] += decorridos > lexico ? decorridos - lexico : 0;
+    }
+}
+
+// Zera os contadores e mede o custo de ler o contador de ciclos
+void iniciar_estatisticas(EstatisticasCompilacao *estatisticas);
+
+// Somam em destino os contadores de uma tabela hash ou de um arquivo (ou de uma thread do lote)
+void acumular_contadores_hash(ContadoresHash *destino, const ContadoresHash *origem);
+void acumular_estatisticas(EstatisticasCompilacao *destino, const EstatisticasCompilacao *origem);
+
+// Relatorio legivel ou um objeto JSON; o tempo das fases sai da proporcao ciclos/tempo total
+int escrever_estatisticas_texto(const EstatisticasCompilacao *estatisticas, FILE *saida);
+int escrever_estatisticas_json(const EstatisticasCompilacao *estatisticas, FILE *saida);
+
+#endif
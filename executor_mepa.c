@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fonte.h"
+#include "mepa.h"
+#include "maquina_mepa.h"
+#include "perfil_mepa.h"
+
+static double agora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+//Executa codigo MEPA gerado pelo compilador (texto ou --emit=bin)
+int main(int argc, char *argv[]) {
+    const char *caminho = NULL;
+    int mostrar_tempo = 0;
+    int perfil = 0;
+    const char *caminho_pilhas = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tempo") == 0) {
+            mostrar_tempo = 1;
+        } else if (strcmp(argv[i], "--perfil") == 0) {
+            perfil = 1;
+        } else if (strncmp(argv[i], "--perfil=", 9) == 0 && argv[i][9] != '\0') {
+            perfil = 1;
+            caminho_pilhas = argv[i] + 9;
+        } else if (!caminho) {
+            caminho = argv[i];
+        } else {
+            caminho = NULL;
+            break;
+        }
+    }
+    if (!caminho) {
+        fprintf(stderr, "Uso: %s [--tempo] [--perfil[=pilhas.folded]] <arquivo-mepa>\n", argv[0]);
+        return 1;
+    }
+
+    ArquivoFonte arquivo;
+    if (abrir_fonte(&arquivo, caminho) != 0) {
+        perror("Erro ao abrir o arquivo");
+        return 1;
+    }
+
+    CodigoMepa codigo;
+    iniciar_codigo_mepa(&codigo);
+    int resultado = carregar_codigo_mepa(arquivo.dados, arquivo.tamanho, &codigo, stderr);
+    fechar_fonte(&arquivo);
+
+    ProgramaVM programa;
+    if (resultado == 0) resultado = preparar_programa_vm(&programa, &codigo, stderr);
+    if (resultado != 0) {
+        liberar_codigo_mepa(&codigo);
+        return 1;
+    }
+    if (perfil) ativar_perfil_vm(&programa);
+
+    long long executadas = 0;
+    double inicio = agora();
+    resultado = executar_programa_vm(&programa, stdin, stdout, &executadas);
+    double tempo = agora() - inicio;
+
+    // O arquivo MEPA nao guarda a tabela de linhas: o perfil sai por opcode e por laco
+    if (perfil) {
+        fflush(stdout);
+        resultado |= escrever_relatorio_perfil(&codigo, programa.contagens, stderr);
+        if (caminho_pilhas) {
+            FILE *pilhas = fopen(caminho_pilhas, "w");
+            if (!pilhas) {
+                perror("Erro ao criar o arquivo de perfil");
+                resultado = -1;
+            } else {
+                resultado |= escrever_pilhas_perfil(&codigo, programa.contagens, caminho, pilhas);
+                if (fclose(pilhas) != 0) resultado = -1;
+            }
+        }
+    }
+    liberar_programa_vm(&programa);
+    liberar_codigo_mepa(&codigo);
+
+    if (mostrar_tempo) {
+        fprintf(stderr, "%lld instrucoes executadas em %.3f s (%.1f Minstr/s)\n",
+                executadas, tempo, tempo > 0 ? executadas / tempo / 1e6 : 0.0);
+    }
+    return resultado == 0 ? 0 : 1;
+}
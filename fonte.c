@@ -0,0 +1,104 @@
+#include "fonte.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define BLOCO_LEITURA (1 << 20)
+
+// Le o arquivo em blocos grandes (entrada padrao, pipes ou quando o mmap falha)
+static int ler_em_blocos(ArquivoFonte *fonte, FILE *arquivo) {
+    size_t capacidade = BLOCO_LEITURA;
+    size_t tamanho = 0;
+    char *dados = malloc(capacidade + 1);
+    if (!dados) return -1;
+
+    for (;;) {
+        if (capacidade - tamanho < BLOCO_LEITURA) {
+            char *novo = realloc(dados, capacidade * 2 + 1);
+            if (!novo) {
+                free(dados);
+                errno = ENOMEM;
+                return -1;
+            }
+            dados = novo;
+            capacidade *= 2;
+        }
+        size_t lidos = fread(dados + tamanho, 1, capacidade - tamanho, arquivo);
+        tamanho += lidos;
+        if (lidos == 0) break;
+    }
+
+    if (ferror(arquivo)) {
+        free(dados);
+        errno = EIO;
+        return -1;
+    }
+
+    dados[tamanho] = '\0';
+    fonte->dados = dados;
+    fonte->tamanho = tamanho;
+    fonte->mapeado = 0;
+    return 0;
+}
+
+int abrir_fonte(ArquivoFonte *fonte, const char *caminho) {
+    return abrir_fonte_entrada(fonte, caminho, stdin);
+}
+
+int abrir_fonte_entrada(ArquivoFonte *fonte, const char *caminho, FILE *entrada) {
+    memset(fonte, 0, sizeof(*fonte));
+
+    FILE *arquivo = strcmp(caminho, "-") == 0 ? entrada : fopen(caminho, "rb");
+    if (!arquivo) return -1;
+
+#ifndef _WIN32
+    struct stat info;
+    if (fstat(fileno(arquivo), &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *mapa = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fileno(arquivo), 0);
+        if (mapa != MAP_FAILED) {
+            madvise(mapa, (size_t)info.st_size, MADV_SEQUENTIAL);
+            fonte->dados = mapa;
+            fonte->tamanho = (size_t)info.st_size;
+            fonte->mapeado = 1;
+            if (arquivo != entrada) fclose(arquivo);
+            return 0;
+        }
+    }
+#endif
+
+    int resultado = ler_em_blocos(fonte, arquivo);
+    if (arquivo != entrada) fclose(arquivo);
+    return resultado;
+}
+
+void fechar_fonte(ArquivoFonte *fonte) {
+#ifndef _WIN32
+    if (fonte->mapeado) {
+        munmap((void *)fonte->dados, fonte->tamanho);
+        fonte->dados = NULL;
+        return;
+    }
+#endif
+    free((void *)fonte->dados);
+    fonte->dados = NULL;
+}
+
+void descartar_inicio_fonte(const ArquivoFonte *fonte, size_t ate) {
+#ifndef _WIN32
+    if (!fonte->mapeado) return;
+    size_t pagina = (size_t)sysconf(_SC_PAGESIZE);
+    ate &= ~(pagina - 1);
+    if (ate > 0) madvise((void *)fonte->dados, ate, MADV_DONTNEED);
+#else
+    (void)fonte;
+    (void)ate;
+#endif
+}
@@ -0,0 +1,23 @@
+#ifndef FONTE_H
+#define FONTE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Arquivo fonte carregado inteiro na memoria (mmap ou leitura em blocos)
+typedef struct {
+    const char *dados;
+    size_t tamanho;
+    int mapeado;
+} ArquivoFonte;
+
+// Abre o arquivo fonte; "-" le da entrada padrao. Retorna 0 ou -1 (errno definido)
+int abrir_fonte(ArquivoFonte *fonte, const char *caminho);
+// O mesmo, com "-" lendo de entrada (a do cliente no modo servidor)
+int abrir_fonte_entrada(ArquivoFonte *fonte, const char *caminho, FILE *entrada);
+void fechar_fonte(ArquivoFonte *fonte);
+// Devolve ao sistema as paginas inteiras de dados[0, ate), que nao serao mais lidas em
+// sequencia; lidas de novo, voltam do arquivo. Sem efeito se o fonte nao for mapeado
+void descartar_inicio_fonte(const ArquivoFonte *fonte, size_t ate);
+
+#endif
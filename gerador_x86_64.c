@@ -0,0 +1,457 @@
+#include "gerador_x86_64.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// Registradores dos primeiros temporarios; o runtime so usa rax, rcx, rdx, rsi, rdi e r11
+static const char *const registradores_pilha[] = {
+    "%ebx", "%r12d", "%r13d", "%r14d", "%r15d", "%r8d", "%r9d", "%r10d"
+};
+#define NUM_REGISTRADORES_PILHA ((int)(sizeof(registradores_pilha) / sizeof(registradores_pilha[0])))
+
+// Runtime minimo: saida e entrada com buffer proprio de 64 KiB, sem libc
+static const char runtime_x86_64[] =
+    "    .section .bss\n"
+    "    .lcomm mepa_buffer_saida, 65536\n"
+    "    .lcomm mepa_buffer_entrada, 65536\n"
+    "    .lcomm mepa_posicao_saida, 8\n"
+    "    .lcomm mepa_posicao_entrada, 8\n"
+    "    .lcomm mepa_fim_entrada, 8\n"
+    "    .section .rodata\n"
+    "mepa_mensagem_leitura:\n"
+    "    .ascii \"Erro de execucao: LEIT sem um inteiro na entrada\\n\"\n"
+    "    .set mepa_tamanho_mensagem_leitura, . - mepa_mensagem_leitura\n"
+    "mepa_mensagem_divisao:\n"
+    "    .ascii \"Erro de execucao: divisao por zero\\n\"\n"
+    "    .set mepa_tamanho_mensagem_divisao, . - mepa_mensagem_divisao\n"
+    "    .text\n"
+    "mepa_descarregar:\n"
+    "    mov mepa_posicao_saida(%rip), %rdx\n"
+    "    lea mepa_buffer_saida(%rip), %rsi\n"
+    "1:  test %rdx, %rdx\n"
+    "    jz 2f\n"
+    "    mov $1, %eax\n"
+    "    mov $1, %edi\n"
+    "    syscall\n"
+    "    test %rax, %rax\n"
+    "    jle 2f\n"
+    "    add %rax, %rsi\n"
+    "    sub %rax, %rdx\n"
+    "    jmp 1b\n"
+    "2:  movq $0, mepa_posicao_saida(%rip)\n"
+    "    ret\n"
+    "mepa_imprimir:\n"
+    "    mov mepa_posicao_saida(%rip), %rcx\n"
+    "    cmp $65500, %rcx\n"
+    "    jb 1f\n"
+    "    push %rdi\n"
+    "    call mepa_descarregar\n"
+    "    pop %rdi\n"
+    "    xor %ecx, %ecx\n"
+    "1:  lea mepa_buffer_saida(%rip), %rsi\n"
+    "    add %rcx, %rsi\n"
+    "    mov %edi, %eax\n"
+    "    test %eax, %eax\n"
+    "    jns 2f\n"
+    "    movb $'-', (%rsi)\n"
+    "    inc %rsi\n"
+    "    neg %eax\n"
+    "2:  mov %rsp, %rdi\n"
+    "    mov $10, %ecx\n"
+    "3:  xor %edx, %edx\n"
+    "    div %ecx\n"
+    "    add $'0', %dl\n"
+    "    dec %rdi\n"
+    "    mov %dl, (%rdi)\n"
+    "    test %eax, %eax\n"
+    "    jnz 3b\n"
+    "4:  mov (%rdi), %al\n"
+    "    mov %al, (%rsi)\n"
+    "    inc %rdi\n"
+    "    inc %rsi\n"
+    "    cmp %rsp, %rdi\n"
+    "    jb 4b\n"
+    "    movb $10, (%rsi)\n"
+    "    inc %rsi\n"
+    "    lea mepa_buffer_saida(%rip), %rax\n"
+    "    sub %rax, %rsi\n"
+    "    mov %rsi, mepa_posicao_saida(%rip)\n"
+    "    ret\n"
+    "mepa_proximo_byte:\n"
+    "    mov mepa_posicao_entrada(%rip), %rcx\n"
+    "    cmp mepa_fim_entrada(%rip), %rcx\n"
+    "    jb 2f\n"
+    "    call mepa_descarregar\n"
+    "    xor %eax, %eax\n"
+    "    xor %edi, %edi\n"
+    "    lea mepa_buffer_entrada(%rip), %rsi\n"
+    "    mov $65536, %edx\n"
+    "    syscall\n"
+    "    test %rax, %rax\n"
+    "    jle 1f\n"
+    "    mov %rax, mepa_fim_entrada(%rip)\n"
+    "    xor %ecx, %ecx\n"
+    "    jmp 2f\n"
+    "1:  movq $0, mepa_posicao_entrada(%rip)\n"
+    "    movq $0, mepa_fim_entrada(%rip)\n"
+    "    mov $-1, %eax\n"
+    "    ret\n"
+    "2:  lea mepa_buffer_entrada(%rip), %rsi\n"
+    "    movzbl (%rsi,%rcx), %eax\n"
+    "    inc %rcx\n"
+    "    mov %rcx, mepa_posicao_entrada(%rip)\n"
+    "    ret\n"
+    "mepa_ler:\n"
+    "    sub $24, %rsp\n"
+    "    movq $0, 8(%rsp)\n"
+    "1:  call mepa_proximo_byte\n"
+    "    cmp $-1, %eax\n"
+    "    je mepa_erro_leitura\n"
+    "    cmp $' ', %eax\n"
+    "    je 1b\n"
+    "    lea -9(%rax), %ecx\n"
+    "    cmp $4, %ecx\n"
+    "    jbe 1b\n"
+    "    cmp $'-', %eax\n"
+    "    jne 2f\n"
+    "    movq $1, 8(%rsp)\n"
+    "    call mepa_proximo_byte\n"
+    "    jmp 3f\n"
+    "2:  cmp $'+', %eax\n"
+    "    jne 3f\n"
+    "    call mepa_proximo_byte\n"
+    "3:  lea -'0'(%rax), %ecx\n"
+    "    cmp $9, %ecx\n"
+    "    ja mepa_erro_leitura\n"
+    "    movl $0, (%rsp)\n"
+    "4:  imul $10, (%rsp), %edx\n"
+    "    add %ecx, %edx\n"
+    "    mov %edx, (%rsp)\n"
+    "    call mepa_proximo_byte\n"
+    "    lea -'0'(%rax), %ecx\n"
+    "    cmp $9, %ecx\n"
+    "    jbe 4b\n"
+    "    mov (%rsp), %eax\n"
+    "    cmpq $0, 8(%rsp)\n"
+    "    je 5f\n"
+    "    neg %eax\n"
+    "5:  add $24, %rsp\n"
+    "    ret\n"
+    "mepa_erro_divisao:\n"
+    "    lea mepa_mensagem_divisao(%rip), %rsi\n"
+    "    mov $mepa_tamanho_mensagem_divisao, %edx\n"
+    "    jmp mepa_erro\n"
+    "mepa_erro_leitura:\n"
+    "    lea mepa_mensagem_leitura(%rip), %rsi\n"
+    "    mov $mepa_tamanho_mensagem_leitura, %edx\n"
+    "mepa_erro:\n"
+    "    push %rsi\n"
+    "    push %rdx\n"
+    "    call mepa_descarregar\n"
+    "    pop %rdx\n"
+    "    pop %rsi\n"
+    "    mov $1, %eax\n"
+    "    mov $2, %edi\n"
+    "    syscall\n"
+    "    mov $60, %eax\n"
+    "    mov $1, %edi\n"
+    "    syscall\n"
+    "mepa_parar:\n"
+    "    call mepa_descarregar\n"
+    "    mov $60, %eax\n"
+    "    xor %edi, %edi\n"
+    "    syscall\n";
+
+typedef struct {
+    FILE *saida;
+    int tamanho_quadro;
+    int num_variaveis;
+} EstadoGerador;
+
+static int eh_registrador(int temporario) {
+    return temporario < NUM_REGISTRADORES_PILHA;
+}
+
+// Operando do temporario na altura indicada: registrador ou slot de derramamento no quadro
+static const char *local_temporario(const EstadoGerador *estado, int temporario, char *buffer) {
+    if (eh_registrador(temporario)) return registradores_pilha[temporario];
+    int slot = estado->num_variaveis + temporario - NUM_REGISTRADORES_PILHA;
+    sprintf(buffer, "%d(%%rbp)", -estado->tamanho_quadro + 4 * slot);
+    return buffer;
+}
+
+static const char *local_variavel(const EstadoGerador *estado, int endereco, char *buffer) {
+    sprintf(buffer, "%d(%%rbp)", -estado->tamanho_quadro + 4 * endereco);
+    return buffer;
+}
+
+static void mover(const EstadoGerador *estado, const char *origem, int origem_memoria,
+                  const char *destino, int destino_memoria) {
+    if (origem_memoria && destino_memoria) {
+        fprintf(estado->saida, "    mov %s, %%eax\n    mov %%eax, %s\n", origem, destino);
+    } else {
+        fprintf(estado->saida, "    mov %s, %s\n", origem, destino);
+    }
+}
+
+// Compara a (abaixo) com b (topo): deixa as flags de a - b
+static void comparar(const EstadoGerador *estado, int a, int b) {
+    char buffer_a[32], buffer_b[32];
+    const char *local_a = local_temporario(estado, a, buffer_a);
+    const char *local_b = local_temporario(estado, b, buffer_b);
+    if (!eh_registrador(a) && !eh_registrador(b)) {
+        fprintf(estado->saida, "    mov %s, %%eax\n    cmp %s, %%eax\n", local_a, local_b);
+    } else {
+        fprintf(estado->saida, "    cmp %s, %s\n", local_b, local_a);
+    }
+}
+
+// Sufixo de condicao do x86 para cada comparacao da MEPA, ou o da comparacao oposta
+static const char *condicao_x86(OpcodeMepa opcode, int oposta) {
+    switch (opcode) {
+        case MEPA_CMIG: return oposta ? "ne" : "e";
+        case MEPA_CMDG: return oposta ? "e" : "ne";
+        case MEPA_CMME: return oposta ? "ge" : "l";
+        case MEPA_CMMA: return oposta ? "le" : "g";
+        case MEPA_CMAG: return oposta ? "l" : "ge";
+        default:        return oposta ? "g" : "le";    // CMEG e CRVL_CRVL_CMEG
+    }
+}
+
+// Comparacao seguida de DSVF vira um unico compara-e-desvia nativo; sem o DSVF o
+// resultado 0 ou 1 vai para destino. Retorna o indice da ultima instrucao traduzida
+static int concluir_comparacao(const EstadoGerador *estado, const CodigoMepa *codigo, int i, const char *destino) {
+    OpcodeMepa opcode = codigo->instrucoes[i].opcode;
+    if (i + 1 < codigo->num_instrucoes && codigo->instrucoes[i + 1].opcode == MEPA_DSVF) {
+        fprintf(estado->saida, "    j%s .LM%d\n", condicao_x86(opcode, 1), codigo->instrucoes[i + 1].operando);
+        return i + 1;
+    }
+    fprintf(estado->saida, "    set%s %%al\n    movzbl %%al, %%eax\n    mov %%eax, %s\n",
+            condicao_x86(opcode, 0), destino);
+    return i;
+}
+
+int gerar_assembly_x86_64(const CodigoMepa *codigo, FILE *saida, FILE *erros) {
+    int n = codigo->num_instrucoes;
+    int *profundidades = malloc((size_t)(n + 1) * sizeof(int));
+    if (!profundidades) {
+        fprintf(erros, "Erro: memoria insuficiente\n");
+        return -1;
+    }
+    int profundidade_maxima;
+    if (analisar_pilha_mepa(codigo, profundidades, &profundidade_maxima, erros) != 0) {
+        free(profundidades);
+        return -1;
+    }
+
+    EstadoGerador estado;
+    estado.saida = saida;
+    estado.num_variaveis = 0;
+    for (int i = 0; i < n; i++) {
+        if (codigo->instrucoes[i].opcode == MEPA_AMEM) estado.num_variaveis += codigo->instrucoes[i].operando;
+    }
+    int derramados = profundidade_maxima > NUM_REGISTRADORES_PILHA ? profundidade_maxima - NUM_REGISTRADORES_PILHA : 0;
+    estado.tamanho_quadro = ((estado.num_variaveis + derramados) * 4 + 15) & ~15;
+
+    fprintf(saida, "# Gerado a partir de codigo MEPA\n");
+    fputs(runtime_x86_64, saida);
+    fprintf(saida, "    .globl _start\n_start:\n    mov %%rsp, %%rbp\n");
+    if (estado.tamanho_quadro > 0) {
+        fprintf(saida, "    sub $%d, %%rsp\n", estado.tamanho_quadro);
+        fprintf(saida, "    mov %%rsp, %%rdi\n    mov $%d, %%ecx\n    xor %%eax, %%eax\n    rep stosl\n",
+                estado.tamanho_quadro / 4);
+    }
+
+    // Com desvios absolutos o rotulo .LMk marca a instrucao k (ou o fim, k == n)
+    unsigned char *destinos = NULL;
+    if (codigo->desvios_absolutos) {
+        destinos = calloc((size_t)n + 1, 1);
+        if (!destinos) {
+            fprintf(erros, "Erro: memoria insuficiente\n");
+            free(profundidades);
+            return -1;
+        }
+        for (int i = 0; i < n; i++) {
+            OpcodeMepa opcode = codigo->instrucoes[i].opcode;
+            int alvo = codigo->instrucoes[i].operando;
+            if ((opcode == MEPA_DSVF || opcode == MEPA_DSVS) && alvo >= 0 && alvo <= n) destinos[alvo] = 1;
+        }
+    }
+
+    int resultado = 0;
+    char buffer_a[32], buffer_b[32];
+    for (int i = 0; i < n && resultado == 0; i++) {
+        const InstrucaoMepa *instrucao = &codigo->instrucoes[i];
+        int d = profundidades[i];
+
+        if (destinos && destinos[i]) fprintf(saida, ".LM%d:\n", i);
+        if (instrucao->opcode == MEPA_NADA) {
+            fprintf(saida, ".LM%d:\n", instrucao->operando);
+            continue;
+        }
+        if (d < 0) continue;
+
+        switch (instrucao->opcode) {
+            case MEPA_INPP:
+            case MEPA_AMEM:
+                break;
+            case MEPA_CRCT:
+                fprintf(saida, "    movl $%d, %s\n", instrucao->operando, local_temporario(&estado, d, buffer_a));
+                break;
+            case MEPA_CRVL:
+                mover(&estado, local_variavel(&estado, instrucao->operando, buffer_a), 1,
+                      local_temporario(&estado, d, buffer_b), !eh_registrador(d));
+                break;
+            case MEPA_ARMZ:
+                mover(&estado, local_temporario(&estado, d - 1, buffer_a), !eh_registrador(d - 1),
+                      local_variavel(&estado, instrucao->operando, buffer_b), 1);
+                break;
+            case MEPA_LEIT:
+                fprintf(saida, "    call mepa_ler\n    mov %%eax, %s\n", local_temporario(&estado, d, buffer_a));
+                break;
+            case MEPA_IMPR:
+                fprintf(saida, "    mov %s, %%edi\n    call mepa_imprimir\n", local_temporario(&estado, d - 1, buffer_a));
+                break;
+            case MEPA_SOMA:
+            case MEPA_SUBT:
+            case MEPA_MULT: {
+                const char *operacao = instrucao->opcode == MEPA_SOMA ? "add" :
+                                       instrucao->opcode == MEPA_SUBT ? "sub" : "imul";
+                const char *a = local_temporario(&estado, d - 2, buffer_a);
+                const char *b = local_temporario(&estado, d - 1, buffer_b);
+                if (eh_registrador(d - 2)) {
+                    fprintf(saida, "    %s %s, %s\n", operacao, b, a);
+                } else {
+                    fprintf(saida, "    mov %s, %%eax\n    %s %s, %%eax\n    mov %%eax, %s\n", a, operacao, b, a);
+                }
+                break;
+            }
+            case MEPA_DIVI:
+            case MEPA_MODI:
+                fprintf(saida, "    mov %s, %%eax\n    mov %s, %%ecx\n", local_temporario(&estado, d - 2, buffer_a),
+                        local_temporario(&estado, d - 1, buffer_b));
+                fprintf(saida, "    test %%ecx, %%ecx\n    jz mepa_erro_divisao\n");
+                // idiv de INT_MIN por -1 estoura no processador: por -1 o quociente e a negacao e o resto, 0
+                fprintf(saida, "    cmp $-1, %%ecx\n    jne 1f\n    %s\n    jmp 2f\n1:  cltd\n    idiv %%ecx\n",
+                        instrucao->opcode == MEPA_DIVI ? "neg %eax" : "xor %eax, %eax");
+                if (instrucao->opcode == MEPA_MODI) fprintf(saida, "    mov %%edx, %%eax\n");
+                fprintf(saida, "2:  mov %%eax, %s\n", local_temporario(&estado, d - 2, buffer_a));
+                break;
+            case MEPA_CMEG:
+            case MEPA_CMIG:
+            case MEPA_CMDG:
+            case MEPA_CMME:
+            case MEPA_CMMA:
+            case MEPA_CMAG:
+                comparar(&estado, d - 2, d - 1);
+                i = concluir_comparacao(&estado, codigo, i, local_temporario(&estado, d - 2, buffer_a));
+                break;
+            case MEPA_DSVF:
+                if (eh_registrador(d - 1)) {
+                    fprintf(saida, "    test %s, %s\n", registradores_pilha[d - 1], registradores_pilha[d - 1]);
+                } else {
+                    fprintf(saida, "    cmpl $0, %s\n", local_temporario(&estado, d - 1, buffer_a));
+                }
+                fprintf(saida, "    je .LM%d\n", instrucao->operando);
+                break;
+            case MEPA_DSVS:
+                fprintf(saida, "    jmp .LM%d\n", instrucao->operando);
+                break;
+            case MEPA_PARA:
+                fprintf(saida, "    jmp mepa_parar\n");
+                break;
+            case MEPA_INCR:
+                fprintf(saida, "    incl %s\n", local_variavel(&estado, instrucao->operando, buffer_a));
+                break;
+            case MEPA_CRVL_CRVL_CMEG: {
+                const char *registrador = eh_registrador(d) ? registradores_pilha[d] : "%eax";
+                fprintf(saida, "    mov %s, %s\n", local_variavel(&estado, instrucao->operando, buffer_a), registrador);
+                fprintf(saida, "    cmp %s, %s\n", local_variavel(&estado, instrucao->operando2, buffer_a), registrador);
+                i = concluir_comparacao(&estado, codigo, i, local_temporario(&estado, d, buffer_a));
+                break;
+            }
+            case MEPA_ARMZ_CRVL:
+                mover(&estado, local_temporario(&estado, d - 1, buffer_a), !eh_registrador(d - 1),
+                      local_variavel(&estado, instrucao->operando, buffer_b), 1);
+                break;
+            case MEPA_CRCT_ARMZ:
+                fprintf(saida, "    movl $%d, %s\n", instrucao->operando,
+                        local_variavel(&estado, instrucao->operando2, buffer_a));
+                break;
+            case MEPA_CRVL_ARMZ:
+                mover(&estado, local_variavel(&estado, instrucao->operando, buffer_a), 1,
+                      local_variavel(&estado, instrucao->operando2, buffer_b), 1);
+                break;
+            default:
+                fprintf(erros, "Erro: instrucao %s sem traducao para x86-64\n", nome_opcode(instrucao->opcode));
+                resultado = -1;
+                break;
+        }
+    }
+    if (destinos && destinos[n]) fprintf(saida, ".LM%d:\n", n);
+    fprintf(saida, "    jmp mepa_parar\n");
+
+    free(destinos);
+    free(profundidades);
+    return resultado;
+}
+
+static int executar_comando(char *const argumentos[], FILE *erros) {
+    fflush(erros);
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(erros, "Erro ao criar processo: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        if (fileno(erros) != STDERR_FILENO) dup2(fileno(erros), STDERR_FILENO);
+        execvp(argumentos[0], argumentos);
+        perror(argumentos[0]);
+        _exit(127);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(erros, "Erro: %s falhou\n", argumentos[0]);
+        return -1;
+    }
+    return 0;
+}
+
+int gerar_executavel_x86_64(const CodigoMepa *codigo, const char *caminho_executavel, FILE *erros) {
+    char caminho_assembly[] = "/tmp/mepa_asmXXXXXX";
+    char caminho_objeto[] = "/tmp/mepa_objXXXXXX";
+    int fd_assembly = mkstemp(caminho_assembly);
+    if (fd_assembly < 0) {
+        fprintf(erros, "Erro ao criar arquivo temporario: %s\n", strerror(errno));
+        return -1;
+    }
+    int fd_objeto = mkstemp(caminho_objeto);
+    if (fd_objeto < 0) {
+        fprintf(erros, "Erro ao criar arquivo temporario: %s\n", strerror(errno));
+        close(fd_assembly);
+        unlink(caminho_assembly);
+        return -1;
+    }
+    close(fd_objeto);
+
+    FILE *assembly = fdopen(fd_assembly, "w");
+    int resultado = assembly ? gerar_assembly_x86_64(codigo, assembly, erros) : -1;
+    if (assembly && fclose(assembly) != 0) resultado = -1;
+
+    if (resultado == 0) {
+        char *montar[] = {"as", "--64", "-o", caminho_objeto, caminho_assembly, NULL};
+        resultado = executar_comando(montar, erros);
+    }
+    if (resultado == 0) {
+        char *ligar[] = {"ld", "-static", "-o", (char *)caminho_executavel, caminho_objeto, NULL};
+        resultado = executar_comando(ligar, erros);
+    }
+
+    unlink(caminho_assembly);
+    unlink(caminho_objeto);
+    return resultado;
+}
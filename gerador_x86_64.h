@@ -0,0 +1,18 @@
+#ifndef GERADOR_X86_64_H
+#define GERADOR_X86_64_H
+
+#include <stdio.h>
+
+#include "mepa.h"
+
+// Traduz o codigo MEPA para assembly x86-64 do GNU as (sintaxe AT&T), Linux.
+// Temporarios da pilha de avaliacao ficam em registradores, variaveis do AMEM
+// no quadro da pilha nativa; LEIT/IMPR usam um runtime minimo por syscalls.
+// Mensagens vao para erros
+int gerar_assembly_x86_64(const CodigoMepa *codigo, FILE *saida, FILE *erros);
+
+// Gera o assembly, monta com `as` e liga com `ld` em um executavel ELF estatico.
+// Mensagens, inclusive as do as/ld, vao para erros
+int gerar_executavel_x86_64(const CodigoMepa *codigo, const char *caminho_executavel, FILE *erros);
+
+#endif
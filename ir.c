@@ -0,0 +1,381 @@
+#include "ir.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "memoria.h"
+
+static void *realocar(void *ptr, size_t tamanho) {
+    void *novo = realloc(ptr, tamanho);
+    if (!novo) memoria_insuficiente();
+    return novo;
+}
+
+void iniciar_codigo_ir(CodigoIR *codigo) {
+    memset(codigo, 0, sizeof(*codigo));
+    codigo->proximo_rotulo = 1;
+}
+
+void liberar_codigo_ir(CodigoIR *codigo) {
+    free(codigo->instrucoes);
+    memset(codigo, 0, sizeof(*codigo));
+}
+
+void limpar_codigo_ir(CodigoIR *codigo) {
+    codigo->num_instrucoes = 0;
+    codigo->num_temporarios = 0;
+    codigo->proximo_rotulo = 1;
+}
+
+void esvaziar_codigo_ir(CodigoIR *codigo) {
+    codigo->num_instrucoes = 0;
+    codigo->num_temporarios = 0;
+}
+
+static InstrucaoIR *emitir_ir(CodigoIR *codigo, OpcodeIR opcode, int imediato,
+                              int origem1, int origem2, int linha) {
+    if (codigo->num_instrucoes == codigo->capacidade) {
+        int capacidade = codigo->capacidade ? codigo->capacidade * 2 : 256;
+        codigo->instrucoes = realocar(codigo->instrucoes, (size_t)capacidade * sizeof(InstrucaoIR));
+        codigo->capacidade = capacidade;
+    }
+    InstrucaoIR *instrucao = &codigo->instrucoes[codigo->num_instrucoes++];
+    instrucao->opcode = opcode;
+    instrucao->destino = SEM_TEMPORARIO;
+    instrucao->imediato = imediato;
+    instrucao->origem1 = origem1;
+    instrucao->origem2 = origem2;
+    instrucao->linha = linha;
+    return instrucao;
+}
+
+// Emite uma instrucao que define um temporario novo e retorna o numero dele
+static int definir_ir(CodigoIR *codigo, OpcodeIR opcode, int imediato,
+                      int origem1, int origem2, int linha) {
+    InstrucaoIR *instrucao = emitir_ir(codigo, opcode, imediato, origem1, origem2, linha);
+    instrucao->destino = codigo->num_temporarios++;
+    return instrucao->destino;
+}
+
+static const OpcodeIR operacoes[] = {
+    [NO_MULTIPLICACAO] = IR_MULTIPLICA, [NO_SOMA] = IR_SOMA, [NO_SUBTRACAO] = IR_SUBTRAI,
+    [NO_DIVISAO] = IR_DIVIDE, [NO_RESTO] = IR_RESTO,
+    [NO_IGUAL] = IR_IGUAL, [NO_DIFERENTE] = IR_DIFERENTE, [NO_MENOR] = IR_MENOR,
+    [NO_MENOR_IGUAL] = IR_MENOR_IGUAL, [NO_MAIOR] = IR_MAIOR, [NO_MAIOR_IGUAL] = IR_MAIOR_IGUAL,
+};
+
+// Mesma comparacao com os operandos trocados: a < b e b > a
+static TipoNo espelhar(TipoNo tipo) {
+    switch (tipo) {
+        case NO_MENOR:       return NO_MAIOR;
+        case NO_MENOR_IGUAL: return NO_MAIOR_IGUAL;
+        case NO_MAIOR:       return NO_MENOR;
+        case NO_MAIOR_IGUAL: return NO_MENOR_IGUAL;
+        default:             return tipo;
+    }
+}
+
+// Comparacao de resultado oposto: not (a < b) e a >= b
+static TipoNo negar_comparacao(TipoNo tipo) {
+    switch (tipo) {
+        case NO_IGUAL:       return NO_DIFERENTE;
+        case NO_DIFERENTE:   return NO_IGUAL;
+        case NO_MENOR:       return NO_MAIOR_IGUAL;
+        case NO_MENOR_IGUAL: return NO_MAIOR;
+        case NO_MAIOR:       return NO_MENOR_IGUAL;
+        default:             return NO_MENOR;
+    }
+}
+
+static int gerar_expressao(CodigoIR *codigo, const NoAst *no);
+
+// Operador aritmetico ou comparacao. O operando mais fundo vai primeiro (Sethi-Ullman):
+// o outro e avaliado com um temporario a mais na pilha, entao deve ser o mais raso
+static int gerar_operacao(CodigoIR *codigo, TipoNo tipo, const NoAst *esquerda, const NoAst *direita, int linha) {
+    if (no_ordem_trocavel(tipo) && profundidade_ast(direita) > profundidade_ast(esquerda)) {
+        const NoAst *primeiro = direita;
+        direita = esquerda;
+        esquerda = primeiro;
+        tipo = espelhar(tipo);
+    }
+    int valor_esquerda = gerar_expressao(codigo, esquerda);
+    int valor_direita = gerar_expressao(codigo, direita);
+    return definir_ir(codigo, operacoes[tipo], 0, valor_esquerda, valor_direita, linha);
+}
+
+// Desvia para rotulo quando a condicao vale quando (1 verdadeiro, 0 falso) e segue em
+// frente no outro caso; o operando da direita de and/or so e avaliado se o da esquerda
+// nao decide. O resultado nunca fica na pilha
+static void gerar_desvio(CodigoIR *codigo, const NoAst *no, int quando, int rotulo) {
+    if (!no) return;
+    switch (no->tipo) {
+        case NO_NAO:
+            gerar_desvio(codigo, no->unario.operando, !quando, rotulo);
+            return;
+        case NO_E:
+        case NO_OU: {
+            // O valor que decide sozinho: falso no and, verdadeiro no or
+            int decisivo = no->tipo == NO_OU;
+            if (quando == decisivo) {
+                gerar_desvio(codigo, no->binario.esquerda, decisivo, rotulo);
+                gerar_desvio(codigo, no->binario.direita, decisivo, rotulo);
+            } else {
+                int rotulo_decidido = codigo->proximo_rotulo++;
+                gerar_desvio(codigo, no->binario.esquerda, decisivo, rotulo_decidido);
+                gerar_desvio(codigo, no->binario.direita, quando, rotulo);
+                emitir_ir(codigo, IR_ROTULO, rotulo_decidido, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            }
+            return;
+        }
+        case NO_NUMERO:
+            if ((no->valor != 0) == quando) {
+                emitir_ir(codigo, IR_DESVIA, rotulo, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            }
+            return;
+        default:
+            break;
+    }
+
+    // So existe desvio no falso: para desviar no verdadeiro testa o oposto
+    int condicao;
+    if (no_comparacao(no->tipo)) {
+        TipoNo tipo = quando ? negar_comparacao(no->tipo) : no->tipo;
+        condicao = gerar_operacao(codigo, tipo, no->binario.esquerda, no->binario.direita, no->linha);
+    } else {
+        condicao = gerar_expressao(codigo, no);
+        if (quando) {
+            int zero = definir_ir(codigo, IR_CONSTANTE, 0, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            condicao = definir_ir(codigo, IR_IGUAL, 0, condicao, zero, no->linha);
+        }
+    }
+    emitir_ir(codigo, IR_DESVIA_SE_FALSO, rotulo, condicao, SEM_TEMPORARIO, no->linha);
+}
+
+// and/or/not usado como valor: 1 no caminho verdadeiro e 0 no falso, no mesmo temporario
+static int gerar_valor_logico(CodigoIR *codigo, const NoAst *no) {
+    int rotulo_falso = codigo->proximo_rotulo++;
+    int rotulo_fim = codigo->proximo_rotulo++;
+    gerar_desvio(codigo, no, 0, rotulo_falso);
+    int valor = definir_ir(codigo, IR_CONSTANTE, 1, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+    emitir_ir(codigo, IR_DESVIA, rotulo_fim, valor, SEM_TEMPORARIO, no->linha);
+    emitir_ir(codigo, IR_ROTULO, rotulo_falso, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+    emitir_ir(codigo, IR_CONSTANTE, 0, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha)->destino = valor;
+    emitir_ir(codigo, IR_ROTULO, rotulo_fim, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+    return valor;
+}
+
+// Expressao ausente (entrada invalida aceita pelo analisador) nao gera nada
+static int gerar_expressao(CodigoIR *codigo, const NoAst *no) {
+    if (!no) return SEM_TEMPORARIO;
+    switch (no->tipo) {
+        case NO_NUMERO:
+            return definir_ir(codigo, IR_CONSTANTE, no->valor, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+        case NO_VARIAVEL:
+            return definir_ir(codigo, IR_CARREGA, no->endereco, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+        default:
+            if (no_logico(no->tipo)) return gerar_valor_logico(codigo, no);
+            if (no_binario(no->tipo)) {
+                return gerar_operacao(codigo, no->tipo, no->binario.esquerda, no->binario.direita, no->linha);
+            }
+            return SEM_TEMPORARIO;
+    }
+}
+
+static void gerar_bloco(CodigoIR *codigo, const NoAst *comandos);
+
+static void gerar_comando(CodigoIR *codigo, const NoAst *no) {
+    int valor;
+    switch (no->tipo) {
+        case NO_LEIA:
+            valor = definir_ir(codigo, IR_LEIA, 0, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            emitir_ir(codigo, IR_ARMAZENA, no->endereco, valor, SEM_TEMPORARIO, no->linha);
+            break;
+        case NO_ESCREVA:
+            valor = gerar_expressao(codigo, no->escrita.valor);
+            emitir_ir(codigo, IR_ESCREVA, 0, valor, SEM_TEMPORARIO, no->linha);
+            break;
+        case NO_ATRIBUICAO:
+            valor = gerar_expressao(codigo, no->atribuicao.valor);
+            emitir_ir(codigo, IR_ARMAZENA, no->atribuicao.endereco, valor, SEM_TEMPORARIO, no->linha);
+            break;
+        case NO_PARA: {
+            int rotulo_inicio = codigo->proximo_rotulo++;
+            int rotulo_fim = codigo->proximo_rotulo++;
+            int contador = no->para.contador;
+
+            valor = gerar_expressao(codigo, no->para.inicio);
+            emitir_ir(codigo, IR_ARMAZENA, contador, valor, SEM_TEMPORARIO, no->linha);
+
+            emitir_ir(codigo, IR_ROTULO, rotulo_inicio, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            int atual = definir_ir(codigo, IR_CARREGA, contador, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            int limite = gerar_expressao(codigo, no->para.limite);
+            int condicao = definir_ir(codigo, IR_MENOR_IGUAL, 0, atual, limite, no->linha);
+            emitir_ir(codigo, IR_DESVIA_SE_FALSO, rotulo_fim, condicao, SEM_TEMPORARIO, no->linha);
+
+            gerar_bloco(codigo, no->para.corpo);
+
+            atual = definir_ir(codigo, IR_CARREGA, contador, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            int um = definir_ir(codigo, IR_CONSTANTE, 1, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            valor = definir_ir(codigo, IR_SOMA, 0, atual, um, no->linha);
+            emitir_ir(codigo, IR_ARMAZENA, contador, valor, SEM_TEMPORARIO, no->linha);
+            emitir_ir(codigo, IR_DESVIA, rotulo_inicio, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            emitir_ir(codigo, IR_ROTULO, rotulo_fim, SEM_TEMPORARIO, SEM_TEMPORARIO, no->linha);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void gerar_bloco(CodigoIR *codigo, const NoAst *comandos) {
+    for (const NoAst *no = comandos; no; no = no->proximo) {
+        gerar_comando(codigo, no);
+    }
+}
+
+void gerar_ir_inicio(CodigoIR *codigo, int num_variaveis) {
+    emitir_ir(codigo, IR_INICIO, num_variaveis, SEM_TEMPORARIO, SEM_TEMPORARIO, 0);
+}
+
+void gerar_ir_comando(CodigoIR *codigo, const NoAst *comando) {
+    gerar_comando(codigo, comando);
+}
+
+void gerar_ir_fim(CodigoIR *codigo) {
+    emitir_ir(codigo, IR_PARA, 0, SEM_TEMPORARIO, SEM_TEMPORARIO, 0);
+}
+
+void gerar_ir(const ProgramaAst *programa, CodigoIR *codigo) {
+    gerar_ir_inicio(codigo, programa->num_variaveis);
+    gerar_bloco(codigo, programa->comandos);
+    gerar_ir_fim(codigo);
+}
+
+// Desempilha o temporario esperado; falha se ele nao estiver no topo
+static int consumir_temporario(const int *pilha, int *altura, int temporario) {
+    if (temporario == SEM_TEMPORARIO) return 0;
+    if (*altura == 0 || pilha[*altura - 1] != temporario) return -1;
+    (*altura)--;
+    return 0;
+}
+
+int gerar_mepa_de_ir(const CodigoIR *codigo, CodigoMepa *mepa, FILE *erros) {
+    int *pilha = malloc((size_t)(codigo->num_instrucoes + 1) * sizeof(int));
+    if (!pilha) {
+        fprintf(erros, "Erro: memoria insuficiente\n");
+        return -1;
+    }
+    int altura = 0;
+
+    for (int i = 0; i < codigo->num_instrucoes; i++) {
+        const InstrucaoIR *instrucao = &codigo->instrucoes[i];
+        if (consumir_temporario(pilha, &altura, instrucao->origem2) != 0 ||
+            consumir_temporario(pilha, &altura, instrucao->origem1) != 0) {
+            fprintf(erros, "Erro IR: temporario usado fora da ordem da pilha na instrucao %d\n", i);
+            free(pilha);
+            return -1;
+        }
+
+        mepa->linha_atual = instrucao->linha;
+        switch (instrucao->opcode) {
+            case IR_INICIO:
+                emitir_instrucao(mepa, MEPA_INPP, 0);
+                emitir_instrucao(mepa, MEPA_AMEM, instrucao->imediato);
+                break;
+            case IR_CONSTANTE:       emitir_instrucao(mepa, MEPA_CRCT, instrucao->imediato); break;
+            case IR_CARREGA:         emitir_instrucao(mepa, MEPA_CRVL, instrucao->imediato); break;
+            case IR_ARMAZENA:        emitir_instrucao(mepa, MEPA_ARMZ, instrucao->imediato); break;
+            case IR_LEIA:            emitir_instrucao(mepa, MEPA_LEIT, 0); break;
+            case IR_ESCREVA:         emitir_instrucao(mepa, MEPA_IMPR, 0); break;
+            case IR_SOMA:            emitir_instrucao(mepa, MEPA_SOMA, 0); break;
+            case IR_SUBTRAI:         emitir_instrucao(mepa, MEPA_SUBT, 0); break;
+            case IR_MULTIPLICA:      emitir_instrucao(mepa, MEPA_MULT, 0); break;
+            case IR_DIVIDE:          emitir_instrucao(mepa, MEPA_DIVI, 0); break;
+            case IR_RESTO:           emitir_instrucao(mepa, MEPA_MODI, 0); break;
+            case IR_IGUAL:           emitir_instrucao(mepa, MEPA_CMIG, 0); break;
+            case IR_DIFERENTE:       emitir_instrucao(mepa, MEPA_CMDG, 0); break;
+            case IR_MENOR:           emitir_instrucao(mepa, MEPA_CMME, 0); break;
+            case IR_MENOR_IGUAL:     emitir_instrucao(mepa, MEPA_CMEG, 0); break;
+            case IR_MAIOR:           emitir_instrucao(mepa, MEPA_CMMA, 0); break;
+            case IR_MAIOR_IGUAL:     emitir_instrucao(mepa, MEPA_CMAG, 0); break;
+            case IR_ROTULO:          emitir_instrucao(mepa, MEPA_NADA, instrucao->imediato); break;
+            case IR_DESVIA:          emitir_instrucao(mepa, MEPA_DSVS, instrucao->imediato); break;
+            case IR_DESVIA_SE_FALSO: emitir_instrucao(mepa, MEPA_DSVF, instrucao->imediato); break;
+            case IR_PARA:            emitir_instrucao(mepa, MEPA_PARA, 0); break;
+            default:
+                fprintf(erros, "Erro IR: opcode %d invalido\n", instrucao->opcode);
+                free(pilha);
+                return -1;
+        }
+
+        if (instrucao->destino != SEM_TEMPORARIO) pilha[altura++] = instrucao->destino;
+    }
+
+    free(pilha);
+    return 0;
+}
+
+int escrever_ir_texto(const CodigoIR *codigo, FILE *saida) {
+    static const char *const operadores[NUM_OPCODES_IR] = {
+        [IR_SOMA] = "+", [IR_SUBTRAI] = "-", [IR_MULTIPLICA] = "*", [IR_DIVIDE] = "div",
+        [IR_RESTO] = "mod", [IR_IGUAL] = "=", [IR_DIFERENTE] = "<>", [IR_MENOR] = "<",
+        [IR_MENOR_IGUAL] = "<=", [IR_MAIOR] = ">", [IR_MAIOR_IGUAL] = ">=",
+    };
+
+    for (int i = 0; i < codigo->num_instrucoes; i++) {
+        const InstrucaoIR *instrucao = &codigo->instrucoes[i];
+        switch (instrucao->opcode) {
+            case IR_INICIO:
+                fprintf(saida, "    inicio %d\n", instrucao->imediato);
+                break;
+            case IR_CONSTANTE:
+                fprintf(saida, "    t%d = %d\n", instrucao->destino, instrucao->imediato);
+                break;
+            case IR_CARREGA:
+                fprintf(saida, "    t%d = mem[%d]\n", instrucao->destino, instrucao->imediato);
+                break;
+            case IR_ARMAZENA:
+                fprintf(saida, "    mem[%d] = t%d\n", instrucao->imediato, instrucao->origem1);
+                break;
+            case IR_LEIA:
+                fprintf(saida, "    t%d = leia\n", instrucao->destino);
+                break;
+            case IR_ESCREVA:
+                fprintf(saida, "    escreva t%d\n", instrucao->origem1);
+                break;
+            case IR_SOMA:
+            case IR_SUBTRAI:
+            case IR_MULTIPLICA:
+            case IR_DIVIDE:
+            case IR_RESTO:
+            case IR_IGUAL:
+            case IR_DIFERENTE:
+            case IR_MENOR:
+            case IR_MENOR_IGUAL:
+            case IR_MAIOR:
+            case IR_MAIOR_IGUAL:
+                fprintf(saida, "    t%d = t%d %s t%d\n", instrucao->destino, instrucao->origem1,
+                        operadores[instrucao->opcode], instrucao->origem2);
+                break;
+            case IR_ROTULO:
+                fprintf(saida, "L%d:\n", instrucao->imediato);
+                break;
+            case IR_DESVIA:
+                if (instrucao->origem1 != SEM_TEMPORARIO) {
+                    fprintf(saida, "    vai L%d levando t%d\n", instrucao->imediato, instrucao->origem1);
+                } else {
+                    fprintf(saida, "    vai L%d\n", instrucao->imediato);
+                }
+                break;
+            case IR_DESVIA_SE_FALSO:
+                fprintf(saida, "    se nao t%d vai L%d\n", instrucao->origem1, instrucao->imediato);
+                break;
+            case IR_PARA:
+                fprintf(saida, "    para\n");
+                break;
+            default:
+                break;
+        }
+    }
+    return ferror(saida) ? -1 : 0;
+}
@@ -0,0 +1,84 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdio.h>
+
+#include "ast.h"
+#include "mepa.h"
+
+// Codigo intermediario de tres enderecos. Cada temporario e definido uma unica vez
+// (SSA para temporarios), exceto o valor de um and/or/not, definido como 1 ou 0 em cada
+// caminho: o IR_DESVIA do primeiro caminho o leva em origem1. Variaveis continuam em
+// memoria, acessadas por CARREGA/ARMAZENA
+typedef enum {
+    IR_INICIO,              // reserva imediato variaveis
+    IR_CONSTANTE,           // destino = imediato
+    IR_CARREGA,             // destino = mem[imediato]
+    IR_ARMAZENA,            // mem[imediato] = origem1
+    IR_LEIA,                // destino = leitura da entrada
+    IR_ESCREVA,             // imprime origem1
+    IR_SOMA,                // destino = origem1 + origem2
+    IR_SUBTRAI,             // destino = origem1 - origem2
+    IR_MULTIPLICA,          // destino = origem1 * origem2
+    IR_DIVIDE,              // destino = origem1 div origem2 (truncada)
+    IR_RESTO,               // destino = origem1 mod origem2 (sinal do dividendo)
+    IR_IGUAL,               // destino = origem1 = origem2 (0 ou 1), e assim por diante
+    IR_DIFERENTE,
+    IR_MENOR,
+    IR_MENOR_IGUAL,
+    IR_MAIOR,
+    IR_MAIOR_IGUAL,
+    IR_ROTULO,              // L<imediato>:
+    IR_DESVIA,              // vai para L<imediato>, levando origem1 na pilha se houver
+    IR_DESVIA_SE_FALSO,     // se origem1 == 0 vai para L<imediato>
+    IR_PARA,
+    NUM_OPCODES_IR
+} OpcodeIR;
+
+#define SEM_TEMPORARIO (-1)
+
+typedef struct {
+    OpcodeIR opcode;
+    int destino;
+    int imediato;
+    int origem1;
+    int origem2;
+    int linha;
+} InstrucaoIR;
+
+typedef struct {
+    InstrucaoIR *instrucoes;
+    int num_instrucoes;
+    int capacidade;
+    int num_temporarios;
+    int proximo_rotulo;
+} CodigoIR;
+
+void iniciar_codigo_ir(CodigoIR *codigo);
+void liberar_codigo_ir(CodigoIR *codigo);
+// Esvazia o vetor mantendo a memoria para o proximo arquivo
+void limpar_codigo_ir(CodigoIR *codigo);
+// Esvazia o vetor no meio de um arquivo, entre as partes de uma geracao em fluxo: os
+// rotulos seguem numerados de onde pararam
+void esvaziar_codigo_ir(CodigoIR *codigo);
+
+// Percorre a AST gerando o codigo intermediario; rotulos sao numerados a partir de 1.
+// Operandos sao avaliados na ordem de Sethi-Ullman (o mais fundo primeiro, ver
+// profundidade_ast) e and/or/not viram desvios de curto-circuito
+void gerar_ir(const ProgramaAst *programa, CodigoIR *codigo);
+
+// gerar_ir em partes, para a compilacao em fluxo (--stream): o inicio, um comando por vez
+// e o fim; a sequencia e a mesma de gerar_ir
+void gerar_ir_inicio(CodigoIR *codigo, int num_variaveis);
+void gerar_ir_comando(CodigoIR *codigo, const NoAst *comando);
+void gerar_ir_fim(CodigoIR *codigo);
+
+// Traduz para MEPA. Os temporarios precisam ser usados na ordem de pilha (o ultimo
+// definido e o primeiro consumido), como a geracao a partir da arvore garante. Retorna 0 ou -1
+// com mensagem em erros
+int gerar_mepa_de_ir(const CodigoIR *codigo, CodigoMepa *mepa, FILE *erros);
+
+// Listagem legivel do codigo intermediario (--emit=ir)
+int escrever_ir_texto(const CodigoIR *codigo, FILE *saida);
+
+#endif
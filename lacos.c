@@ -0,0 +1,233 @@
+#include "lacos.h"
+
+#include <string.h>
+
+typedef struct {
+    ProgramaAst *programa;
+    Arena *arena;
+    int fator_desenrolar;
+    EstatisticasLacos *estatisticas;
+} EstadoLacos;
+
+// Comandos que vao antes do laco e somas que vao no fim do corpo, montados em lista
+typedef struct {
+    NoAst *primeiro;
+    NoAst **ultimo;
+} ListaComandos;
+
+static void iniciar_lista(ListaComandos *lista) {
+    lista->primeiro = NULL;
+    lista->ultimo = &lista->primeiro;
+}
+
+static void anexar(ListaComandos *lista, NoAst *comando) {
+    comando->proximo = NULL;
+    *lista->ultimo = comando;
+    lista->ultimo = &comando->proximo;
+}
+
+static NoAst *criar_atribuicao(EstadoLacos *estado, int endereco, NoAst *valor, int linha) {
+    NoAst *no = criar_no_ast(estado->arena, NO_ATRIBUICAO, linha);
+    no->atribuicao.endereco = endereco;
+    no->atribuicao.valor = valor;
+    return no;
+}
+
+static int nova_variavel(EstadoLacos *estado) {
+    return estado->programa->num_variaveis++;
+}
+
+static int alterada_no_bloco(const NoAst *comandos, int endereco) {
+    for (const NoAst *no = comandos; no; no = no->proximo) {
+        switch (no->tipo) {
+            case NO_LEIA:
+                if (no->endereco == endereco) return 1;
+                break;
+            case NO_ATRIBUICAO:
+                if (no->atribuicao.endereco == endereco) return 1;
+                break;
+            case NO_PARA:
+                if (no->para.contador == endereco || alterada_no_bloco(no->para.corpo, endereco)) return 1;
+                break;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+// Mesmo valor em todas as voltas: numeros e variaveis que nem o corpo nem o contador alteram
+static int invariante(const NoAst *laco, const NoAst *no) {
+    switch (no->tipo) {
+        case NO_NUMERO:
+            return 1;
+        case NO_VARIAVEL:
+            return no->endereco != laco->para.contador && !alterada_no_bloco(laco->para.corpo, no->endereco);
+        case NO_NAO:
+            return no->unario.operando && invariante(laco, no->unario.operando);
+        default:
+            return no_binario(no->tipo) && no->binario.esquerda && no->binario.direita &&
+                   invariante(laco, no->binario.esquerda) && invariante(laco, no->binario.direita);
+    }
+}
+
+static int eh_contador(const NoAst *laco, const NoAst *no) {
+    return no && no->tipo == NO_VARIAVEL && no->endereco == laco->para.contador;
+}
+
+// Copia o no e transforma o original em uma leitura da variavel dada
+static NoAst *trocar_por_variavel(EstadoLacos *estado, NoAst *no, int endereco) {
+    NoAst *copia = criar_no_ast(estado->arena, no->tipo, no->linha);
+    *copia = *no;
+    no->tipo = NO_VARIAVEL;
+    no->endereco = endereco;
+    return copia;
+}
+
+static void otimizar_expressao(EstadoLacos *estado, const NoAst *laco, NoAst *no,
+                               ListaComandos *antes, ListaComandos *somas) {
+    if (!no) return;
+    if (no->tipo == NO_NAO) {
+        otimizar_expressao(estado, laco, no->unario.operando, antes, somas);
+        return;
+    }
+    if (!no_binario(no->tipo)) return;
+    NoAst *esquerda = no->binario.esquerda;
+    NoAst *direita = no->binario.direita;
+    if (!esquerda || !direita) return;
+
+    if (invariante(laco, no) && !expressao_pode_falhar(no)) {
+        int temporaria = nova_variavel(estado);
+        anexar(antes, criar_atribuicao(estado, temporaria, trocar_por_variavel(estado, no, temporaria), no->linha));
+        estado->estatisticas->invariantes++;
+        return;
+    }
+
+    // contador * c: s = inicio * c antes do laco, e s = s + c no fim de cada volta
+    NoAst *fator = eh_contador(laco, esquerda) ? direita : eh_contador(laco, direita) ? esquerda : NULL;
+    if (no->tipo == NO_MULTIPLICACAO && fator && invariante(laco, fator) && !expressao_pode_falhar(fator) &&
+        laco->para.inicio) {
+        int soma = nova_variavel(estado);
+        NoAst *inicial;
+        if (fator->tipo == NO_NUMERO && laco->para.inicio->tipo == NO_NUMERO) {
+            int valor = (int)((unsigned)laco->para.inicio->valor * (unsigned)fator->valor);
+            inicial = criar_numero_ast(estado->arena, valor, no->linha);
+        } else {
+            inicial = criar_binario_ast(estado->arena, NO_MULTIPLICACAO,
+                                        copiar_expressao_ast(estado->arena, laco->para.inicio),
+                                        copiar_expressao_ast(estado->arena, fator), no->linha);
+        }
+        anexar(antes, criar_atribuicao(estado, soma, inicial, no->linha));
+        NoAst *proxima = criar_binario_ast(estado->arena, NO_SOMA, criar_variavel_ast(estado->arena, soma, no->linha),
+                                           copiar_expressao_ast(estado->arena, fator), no->linha);
+        anexar(somas, criar_atribuicao(estado, soma, proxima, no->linha));
+        no->tipo = NO_VARIAVEL;
+        no->endereco = soma;
+        estado->estatisticas->reduzidas++;
+        return;
+    }
+
+    otimizar_expressao(estado, laco, esquerda, antes, somas);
+    otimizar_expressao(estado, laco, direita, antes, somas);
+}
+
+// Copia profunda dos comandos para o fim da lista
+static void copiar_bloco(EstadoLacos *estado, const NoAst *comandos, ListaComandos *destino) {
+    for (const NoAst *no = comandos; no; no = no->proximo) {
+        NoAst *copia = criar_no_ast(estado->arena, no->tipo, no->linha);
+        *copia = *no;
+        if (no->tipo == NO_ESCREVA) {
+            copia->escrita.valor = copiar_expressao_ast(estado->arena, no->escrita.valor);
+        } else if (no->tipo == NO_ATRIBUICAO) {
+            copia->atribuicao.valor = copiar_expressao_ast(estado->arena, no->atribuicao.valor);
+        } else if (no->tipo == NO_PARA) {
+            copia->para.inicio = copiar_expressao_ast(estado->arena, no->para.inicio);
+            copia->para.limite = copiar_expressao_ast(estado->arena, no->para.limite);
+            ListaComandos corpo;
+            iniciar_lista(&corpo);
+            copiar_bloco(estado, no->para.corpo, &corpo);
+            copia->para.corpo = corpo.primeiro;
+        }
+        anexar(destino, copia);
+    }
+}
+
+// n voltas constantes, n >= fator: as n % fator primeiras vao antes do laco com o contador
+// fixo; no laco o corpo se repete fator vezes, incrementando o contador entre as copias
+static void desenrolar(EstadoLacos *estado, NoAst *laco, ListaComandos *antes) {
+    int fator = estado->fator_desenrolar;
+    NoAst *inicio = laco->para.inicio;
+    NoAst *limite = laco->para.limite;
+    if (fator < 2 || !inicio || !limite || inicio->tipo != NO_NUMERO || limite->tipo != NO_NUMERO) return;
+    long long voltas = (long long)limite->valor - inicio->valor + 1;
+    if (voltas < fator) return;
+
+    int contador = laco->para.contador;
+    int restantes = (int)(voltas % fator);
+    for (int k = 0; k < restantes; k++) {
+        NoAst *valor = criar_numero_ast(estado->arena, inicio->valor + k, laco->linha);
+        anexar(antes, criar_atribuicao(estado, contador, valor, laco->linha));
+        copiar_bloco(estado, laco->para.corpo, antes);
+    }
+
+    ListaComandos corpo;
+    iniciar_lista(&corpo);
+    for (int k = 0; k < fator; k++) {
+        if (k > 0) {
+            NoAst *incremento = criar_binario_ast(estado->arena, NO_SOMA,
+                                                  criar_variavel_ast(estado->arena, contador, laco->linha),
+                                                  criar_numero_ast(estado->arena, 1, laco->linha), laco->linha);
+            anexar(&corpo, criar_atribuicao(estado, contador, incremento, laco->linha));
+        }
+        copiar_bloco(estado, laco->para.corpo, &corpo);
+    }
+    laco->para.corpo = corpo.primeiro;
+    laco->para.inicio = criar_numero_ast(estado->arena, inicio->valor + restantes, inicio->linha);
+    estado->estatisticas->desenrolados++;
+}
+
+static void otimizar_laco(EstadoLacos *estado, NoAst *laco, ListaComandos *antes) {
+    if (alterada_no_bloco(laco->para.corpo, laco->para.contador)) return;
+    estado->estatisticas->lacos++;
+
+    ListaComandos somas;
+    iniciar_lista(&somas);
+    otimizar_expressao(estado, laco, laco->para.limite, antes, &somas);
+    for (NoAst *no = laco->para.corpo; no; no = no->proximo) {
+        if (no->tipo == NO_ATRIBUICAO) {
+            otimizar_expressao(estado, laco, no->atribuicao.valor, antes, &somas);
+        } else if (no->tipo == NO_ESCREVA) {
+            otimizar_expressao(estado, laco, no->escrita.valor, antes, &somas);
+        }
+    }
+    if (somas.primeiro) {
+        NoAst **fim = &laco->para.corpo;
+        while (*fim) fim = &(*fim)->proximo;
+        *fim = somas.primeiro;
+    }
+
+    desenrolar(estado, laco, antes);
+}
+
+static void otimizar_bloco(EstadoLacos *estado, NoAst **ligacao) {
+    while (*ligacao) {
+        NoAst *no = *ligacao;
+        if (no->tipo == NO_PARA) {
+            otimizar_bloco(estado, &no->para.corpo);
+            ListaComandos antes;
+            iniciar_lista(&antes);
+            otimizar_laco(estado, no, &antes);
+            if (antes.primeiro) {
+                *ligacao = antes.primeiro;
+                *antes.ultimo = no;
+            }
+        }
+        ligacao = &no->proximo;
+    }
+}
+
+void otimizar_lacos(ProgramaAst *programa, Arena *arena, int fator_desenrolar, EstatisticasLacos *estatisticas) {
+    memset(estatisticas, 0, sizeof(*estatisticas));
+    EstadoLacos estado = { programa, arena, fator_desenrolar, estatisticas };
+    otimizar_bloco(&estado, &programa->comandos);
+}
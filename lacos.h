@@ -0,0 +1,27 @@
+#ifndef LACOS_H
+#define LACOS_H
+
+#include "arena.h"
+#include "ast.h"
+
+#define FATOR_DESENROLAR_PADRAO 4
+#define MAX_FATOR_DESENROLAR 64
+
+// Contadores do otimizador de lacos
+typedef struct {
+    int lacos;          // fors cujo corpo nao altera o contador
+    int invariantes;    // expressoes levadas para antes do laco
+    int reduzidas;      // multiplicacoes pelo contador trocadas por uma soma a cada volta
+    int desenrolados;
+} EstatisticasLacos;
+
+// -O2, depois de propagar_constantes: em cada for cujo corpo nao altera o contador,
+// - expressoes invariantes do corpo sao calculadas uma vez antes do laco;
+// - contador * c (c invariante) vira uma variavel somada de c a cada volta;
+// - com inicio e limite constantes o corpo e repetido fator_desenrolar vezes por volta,
+//   com as voltas que sobram da divisao executadas antes do laco.
+// Os valores intermediarios ficam em variaveis novas, alem das declaradas
+// (programa->num_variaveis cresce); a AST e reescrita no lugar
+void otimizar_lacos(ProgramaAst *programa, Arena *arena, int fator_desenrolar, EstatisticasLacos *estatisticas);
+
+#endif
@@ -0,0 +1,251 @@
+#include "lexico.h"
+
+#include "palavras_reservadas.h"
+#include "varredura.h"
+
+// Classes de caractere: o automato so olha a classe, nunca o caractere
+enum {
+    CLASSE_OUTRO,       // simbolo de um caractere (inclui bytes >= 0x80)
+    CLASSE_LETRA,
+    CLASSE_LETRA_B,     // 'b' e 'B': letra, mas tambem o prefixo de 0b101
+    CLASSE_ZERO,
+    CLASSE_UM,
+    CLASSE_DIGITO,      // 2 a 9
+    CLASSE_SUBLINHADO,
+    CLASSE_ESPACO,      // isspace no locale "C"
+    CLASSE_CERQUILHA,   // '#': comentario ate o fim da linha
+    CLASSE_CHAVE,       // '{': comentario {- -}
+    CLASSE_MENOR,       // '<', '>' e '=' formam os simbolos de dois caracteres <=, <> e >=
+    CLASSE_MAIOR,
+    CLASSE_IGUAL,
+    NUM_CLASSES
+};
+
+static const unsigned char classes[256] = {
+    ['a'] = CLASSE_LETRA, ['b'] = CLASSE_LETRA_B, ['c' ... 'z'] = CLASSE_LETRA,
+    ['A'] = CLASSE_LETRA, ['B'] = CLASSE_LETRA_B, ['C' ... 'Z'] = CLASSE_LETRA,
+    ['0'] = CLASSE_ZERO, ['1'] = CLASSE_UM, ['2' ... '9'] = CLASSE_DIGITO,
+    ['_'] = CLASSE_SUBLINHADO,
+    [' '] = CLASSE_ESPACO, ['\t' ... '\r'] = CLASSE_ESPACO,
+    ['#'] = CLASSE_CERQUILHA, ['{'] = CLASSE_CHAVE,
+    ['<'] = CLASSE_MENOR, ['>'] = CLASSE_MAIOR, ['='] = CLASSE_IGUAL,
+};
+
+enum {
+    ESTADO_INICIO,
+    ESTADO_IDENTIFICADOR,
+    ESTADO_ZERO,        // "0": decimal, ou binario se vier 'b'
+    ESTADO_DECIMAL,
+    ESTADO_BINARIO,     // "0b" seguido de zeros e uns
+    ESTADO_SIMBOLO,
+    ESTADO_MENOR,       // "<": simbolo, ou inicio de "<=" e "<>"
+    ESTADO_MAIOR,       // ">": simbolo, ou inicio de ">="
+    ESTADO_SIMBOLO_DUPLO,
+    NUM_ESTADOS
+};
+
+// ESTADO_INICIO nunca e destino, entao uma transicao ausente (zero) significa parar
+static const unsigned char transicoes[NUM_ESTADOS][NUM_CLASSES] = {
+    [ESTADO_INICIO] = {
+        [CLASSE_OUTRO] = ESTADO_SIMBOLO, [CLASSE_SUBLINHADO] = ESTADO_SIMBOLO,
+        [CLASSE_ESPACO] = ESTADO_SIMBOLO, [CLASSE_CERQUILHA] = ESTADO_SIMBOLO,
+        [CLASSE_CHAVE] = ESTADO_SIMBOLO, [CLASSE_IGUAL] = ESTADO_SIMBOLO,
+        [CLASSE_MENOR] = ESTADO_MENOR, [CLASSE_MAIOR] = ESTADO_MAIOR,
+        [CLASSE_LETRA] = ESTADO_IDENTIFICADOR, [CLASSE_LETRA_B] = ESTADO_IDENTIFICADOR,
+        [CLASSE_ZERO] = ESTADO_ZERO, [CLASSE_UM] = ESTADO_DECIMAL,
+        [CLASSE_DIGITO] = ESTADO_DECIMAL,
+    },
+    [ESTADO_IDENTIFICADOR] = {
+        [CLASSE_LETRA] = ESTADO_IDENTIFICADOR, [CLASSE_LETRA_B] = ESTADO_IDENTIFICADOR,
+        [CLASSE_ZERO] = ESTADO_IDENTIFICADOR, [CLASSE_UM] = ESTADO_IDENTIFICADOR,
+        [CLASSE_DIGITO] = ESTADO_IDENTIFICADOR, [CLASSE_SUBLINHADO] = ESTADO_IDENTIFICADOR,
+    },
+    [ESTADO_ZERO] = {
+        [CLASSE_LETRA_B] = ESTADO_BINARIO,
+        [CLASSE_ZERO] = ESTADO_DECIMAL, [CLASSE_UM] = ESTADO_DECIMAL,
+        [CLASSE_DIGITO] = ESTADO_DECIMAL,
+    },
+    [ESTADO_DECIMAL] = {
+        [CLASSE_ZERO] = ESTADO_DECIMAL, [CLASSE_UM] = ESTADO_DECIMAL,
+        [CLASSE_DIGITO] = ESTADO_DECIMAL,
+    },
+    [ESTADO_BINARIO] = {
+        [CLASSE_ZERO] = ESTADO_BINARIO, [CLASSE_UM] = ESTADO_BINARIO,
+    },
+    [ESTADO_SIMBOLO] = {0},
+    [ESTADO_MENOR] = {
+        [CLASSE_IGUAL] = ESTADO_SIMBOLO_DUPLO, [CLASSE_MAIOR] = ESTADO_SIMBOLO_DUPLO,
+    },
+    [ESTADO_MAIOR] = {
+        [CLASSE_IGUAL] = ESTADO_SIMBOLO_DUPLO,
+    },
+    [ESTADO_SIMBOLO_DUPLO] = {0},
+};
+
+static const TipoToken tokens_simbolos[256] = {
+    [';'] = TOKEN_PONTO_VIRGULA, ['('] = TOKEN_ABRE_PARENTESES, [')'] = TOKEN_FECHA_PARENTESES,
+    ['*'] = TOKEN_MULTIPLICACAO, [':'] = TOKEN_DOIS_PONTOS, [','] = TOKEN_VIRGULA,
+    ['+'] = TOKEN_SOMA, ['-'] = TOKEN_SUBTRACAO, ['='] = TOKEN_IGUAL,
+    ['<'] = TOKEN_MENOR, ['>'] = TOKEN_MAIOR,
+};
+
+static const TipoToken tokens_palavras[NUM_PALAVRAS_RESERVADAS] = {
+    [PALAVRA_NENHUMA] = TOKEN_ID,
+    [PALAVRA_PROGRAM] = TOKEN_PROGRAM, [PALAVRA_INTEGER] = TOKEN_INTEIRO,
+    [PALAVRA_BOOLEAN] = TOKEN_BOOLEANO, [PALAVRA_BEGIN] = TOKEN_INICIO,
+    [PALAVRA_END] = TOKEN_FIM, [PALAVRA_READ] = TOKEN_LEIA,
+    [PALAVRA_WRITE] = TOKEN_ESCREVA, [PALAVRA_IF] = TOKEN_SE,
+    [PALAVRA_ELIF] = TOKEN_SENAOSE, [PALAVRA_FOR] = TOKEN_FOR,
+    [PALAVRA_SET] = TOKEN_SET, [PALAVRA_TO] = TOKEN_ATE,
+    [PALAVRA_OF] = TOKEN_DE, [PALAVRA_TRUE] = TOKEN_VERDADEIRO,
+    [PALAVRA_FALSE] = TOKEN_FALSO, [PALAVRA_AND] = TOKEN_E,
+    [PALAVRA_OR] = TOKEN_OU, [PALAVRA_NOT] = TOKEN_NAO,
+    [PALAVRA_DIV] = TOKEN_DIV, [PALAVRA_MOD] = TOKEN_MOD
+};
+
+void iniciar_analisador_lexico(AnalisadorLexico *lexico, const char *dados, size_t tamanho) {
+    lexico->dados = dados;
+    lexico->cursor = dados;
+    lexico->fim = dados + tamanho;
+    lexico->linha = 1;
+    lexico->comentario_aberto = 0;
+}
+
+void iniciar_analisador_trecho(AnalisadorLexico *lexico, const char *dados, size_t inicio, size_t fim) {
+    lexico->dados = dados;
+    lexico->cursor = dados + inicio;
+    lexico->fim = dados + fim;
+    lexico->linha = 0;
+    lexico->comentario_aberto = 0;
+}
+
+// Pula espacos e comentarios; "{" sem "-" tambem abre comentario, e o '-' de
+// abertura nao pode fecha-lo ("{-}" continua aberto)
+static const char *pular_ignorados(AnalisadorLexico *lexico) {
+    const char *p = lexico->cursor;
+    const char *fim = lexico->fim;
+    while (p < fim) {
+        switch (classes[(unsigned char)*p]) {
+            case CLASSE_ESPACO:
+                // Espaco isolado entre tokens e o caso comum: nao vale a varredura em blocos
+                if (p + 1 < fim && classes[(unsigned char)p[1]] != CLASSE_ESPACO) {
+                    if (*p == '\n') lexico->linha++;
+                    p++;
+                } else {
+                    p = pular_espacos(p, fim, &lexico->linha);
+                }
+                break;
+            case CLASSE_CERQUILHA:
+                p = buscar_nova_linha(p + 1, fim);
+                break;
+            case CLASSE_CHAVE: {
+                p++;
+                if (p < fim && *p == '-') p++;
+                const char *corpo = p;
+                p = buscar_fim_comentario(p, fim, &lexico->linha);
+                // Chegar ao fim so conta como fechado se o "-}" for os dois ultimos bytes
+                lexico->comentario_aberto = p == fim && !(p - corpo >= 2 && p[-2] == '-' && p[-1] == '}');
+                break;
+            }
+            default:
+                return p;
+        }
+    }
+    return p;
+}
+
+// Valor de um literal decimal; 0 se nao couber em um int de 32 bits
+static int converter_decimal(const unsigned char *p, const unsigned char *fim, int32_t *valor) {
+    uint32_t resultado = 0;
+    for (; p < fim; p++) {
+        uint32_t digito = (uint32_t)(*p - '0');
+        if (resultado > (INT32_MAX - digito) / 10) return 0;
+        resultado = resultado * 10 + digito;
+    }
+    *valor = (int32_t)resultado;
+    return 1;
+}
+
+// Digitos depois do 0b; ate 32 bits significativos, lidos como o padrao de bits do int
+static int converter_binario(const unsigned char *p, const unsigned char *fim, int32_t *valor) {
+    while (p < fim && *p == '0') p++;
+    if (fim - p > 32) return 0;
+    uint32_t resultado = 0;
+    for (; p < fim; p++) resultado = (resultado << 1) | (uint32_t)(*p - '0');
+    *valor = (int32_t)resultado;
+    return 1;
+}
+
+Token proximo_token(AnalisadorLexico *lexico) {
+    const unsigned char *p = (const unsigned char *)pular_ignorados(lexico);
+    const unsigned char *fim = (const unsigned char *)lexico->fim;
+    Token token;
+    token.linha = lexico->linha;
+    token.inicio = (uint32_t)((const char *)p - lexico->dados);
+    token.valor.id_identificador = -1;
+
+    if (p == fim) {
+        token.tipo = TOKEN_EOF;
+        token.tamanho = 0;
+        lexico->cursor = lexico->fim;
+        return token;
+    }
+
+    // Maior prefixo aceito pelo automato; todo estado alem do inicial e de aceitacao
+    unsigned estado = transicoes[ESTADO_INICIO][classes[*p]];
+    const unsigned char *q = p + 1;
+    while (q < fim) {
+        unsigned proximo = transicoes[estado][classes[*q]];
+        if (proximo == ESTADO_INICIO) break;
+        estado = proximo;
+        q++;
+    }
+    token.tamanho = (uint32_t)(q - p);
+    lexico->cursor = (const char *)q;
+
+    switch (estado) {
+        case ESTADO_IDENTIFICADOR:
+            token.tipo = tokens_palavras[buscar_palavra_reservada((const char *)p, token.tamanho)];
+            break;
+        case ESTADO_SIMBOLO:
+        case ESTADO_MENOR:
+        case ESTADO_MAIOR:
+            token.tipo = tokens_simbolos[*p] ? tokens_simbolos[*p] : TOKEN_SIMBOLO;
+            break;
+        case ESTADO_SIMBOLO_DUPLO:
+            token.tipo = p[0] == '>' ? TOKEN_MAIOR_IGUAL : p[1] == '=' ? TOKEN_MENOR_IGUAL : TOKEN_DIFERENTE;
+            break;
+        case ESTADO_BINARIO:
+            token.tipo = converter_binario(p + 2, q, &token.valor.valor_inteiro) ? TOKEN_NUMERO : TOKEN_ERRO;
+            break;
+        default:
+            token.tipo = converter_decimal(p, q, &token.valor.valor_inteiro) ? TOKEN_NUMERO : TOKEN_ERRO;
+            break;
+    }
+    return token;
+}
+
+const char *nome_token(TipoToken tipo) {
+    static const char *const nomes_tokens[NUM_TIPOS_TOKEN] = {
+        "program", "identificador", "integer", "boolean", "begin", "end",
+        "read", "write", "if", "elif", "for", "set", "to", "of",
+        "true", "false", "and", "or", "not", "numero", "simbolo",
+        "erro", "EOF", "ponto_virgula", "abre_par", "fecha_par",
+        // A listagem da primeira parte nao distingue estes simbolos
+        "simbolo", "simbolo", "simbolo", "simbolo", "simbolo", "div", "mod",
+        "simbolo", "simbolo", "simbolo", "simbolo", "simbolo", "simbolo"
+    };
+    return nomes_tokens[tipo];
+}
+
+void imprimir_token(FILE *saida, const AnalisadorLexico *lexico, Token token) {
+    if (token.tipo == TOKEN_ID || token.tipo == TOKEN_NUMERO || token.tipo == TOKEN_ERRO) {
+        fprintf(saida, "%d:%s | %.*s\n", token.linha, nome_token(token.tipo),
+                (int)token.tamanho, texto_token(lexico, token));
+    } else if (token.tipo == TOKEN_MENOR_IGUAL || token.tipo == TOKEN_DIFERENTE || token.tipo == TOKEN_MAIOR_IGUAL) {
+        // A listagem da primeira parte sempre mostrou <=, <> e >= como dois simbolos
+        fprintf(saida, "%d:%s\n%d:%s\n", token.linha, nome_token(token.tipo), token.linha, nome_token(token.tipo));
+    } else {
+        fprintf(saida, "%d:%s\n", token.linha, nome_token(token.tipo));
+    }
+}
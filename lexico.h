@@ -0,0 +1,68 @@
+#ifndef LEXICO_H
+#define LEXICO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Tipos de token da linguagem, comuns as duas partes do compilador
+typedef enum {
+    TOKEN_PROGRAM, TOKEN_ID, TOKEN_INTEIRO, TOKEN_BOOLEANO,
+    TOKEN_INICIO, TOKEN_FIM, TOKEN_LEIA, TOKEN_ESCREVA, TOKEN_SE,
+    TOKEN_SENAOSE, TOKEN_FOR, TOKEN_SET, TOKEN_ATE, TOKEN_DE,
+    TOKEN_VERDADEIRO, TOKEN_FALSO, TOKEN_E, TOKEN_OU, TOKEN_NAO,
+    TOKEN_NUMERO, TOKEN_SIMBOLO, TOKEN_ERRO, TOKEN_EOF,
+    TOKEN_PONTO_VIRGULA, TOKEN_ABRE_PARENTESES, TOKEN_FECHA_PARENTESES,
+    TOKEN_MULTIPLICACAO, TOKEN_DOIS_PONTOS, TOKEN_VIRGULA,
+    TOKEN_SOMA, TOKEN_SUBTRACAO, TOKEN_DIV, TOKEN_MOD,
+    TOKEN_IGUAL, TOKEN_DIFERENTE, TOKEN_MENOR, TOKEN_MENOR_IGUAL,
+    TOKEN_MAIOR, TOKEN_MAIOR_IGUAL,
+    NUM_TIPOS_TOKEN
+} TipoToken;
+
+//O token so referencia o fonte: o texto fica em dados[inicio, inicio + tamanho)
+typedef struct {
+    TipoToken tipo;
+    int linha;
+    uint32_t inicio;
+    uint32_t tamanho;
+    union {
+        int id_identificador;   // TOKEN_ID: preenchido por quem interna os identificadores (-1 se nao)
+        int32_t valor_inteiro;  // TOKEN_NUMERO: valor do literal, ja convertido pelo lexico
+    } valor;
+} Token;
+
+// Estado do analisador sobre um buffer ja carregado (ver fonte.h)
+typedef struct {
+    const char *dados;
+    const char *cursor;
+    const char *fim;
+    int linha;
+    int comentario_aberto;  // um {- -} chegou ao fim do buffer sem fechar
+} AnalisadorLexico;
+
+// O buffer deve ter no maximo UINT32_MAX bytes
+void iniciar_analisador_lexico(AnalisadorLexico *lexico, const char *dados, size_t tamanho);
+
+// Analisa so dados[inicio, fim), no codigo, com as linhas contadas a partir de 0; as
+// posicoes dos tokens continuam relativas a dados (ver lexico_paralelo.h)
+void iniciar_analisador_trecho(AnalisadorLexico *lexico, const char *dados, size_t inicio, size_t fim);
+
+// Reconhece o proximo token com as tabelas de classes de caractere e transicoes do automato.
+// Espacos e comentarios (# e {- -}) sao pulados antes, contando as linhas. Um numero decimal
+// acima de 2147483647 ou um binario com mais de 32 bits significativos vira TOKEN_ERRO
+// (o binario de 32 bits e o padrao de bits, 0b1...1 vale -1)
+Token proximo_token(AnalisadorLexico *lexico);
+
+static inline const char *texto_token(const AnalisadorLexico *lexico, Token token) {
+    return lexico->dados + token.inicio;
+}
+
+// Nome do token no formato de listagem da primeira parte ("identificador", "abre_par", ...)
+const char *nome_token(TipoToken tipo);
+
+// Uma linha da listagem de tokens: "linha:nome" ou "linha:nome | lexema" (numero, id ou erro).
+// <=, <> e >= saem em duas linhas "simbolo", como na listagem original da primeira parte
+void imprimir_token(FILE *saida, const AnalisadorLexico *lexico, Token token);
+
+#endif
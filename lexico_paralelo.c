@@ -0,0 +1,252 @@
+#include "lexico_paralelo.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "varredura.h"
+
+// Tokens de uma especulacao, com as linhas relativas ao inicio do trecho
+typedef struct {
+    Token *tokens;
+    size_t num_tokens;
+    size_t capacidade;
+    int comentario_aberto;      // terminou dentro de um {- -}
+} Especulacao;
+
+struct ResultadoTrecho {
+    size_t inicio;
+    size_t fim;
+    int linhas;                 // '\n' do trecho
+    Especulacao codigo;         // a partir do codigo
+    Especulacao comentario;     // a partir de dentro de um comentario, ate alcancar a outra
+    int alcancou;               // dali em diante e codigo.tokens a partir de juncao
+    size_t juncao;
+};
+
+// Divisao do trabalho entre as threads, por um indice atomico
+typedef struct {
+    const char *dados;
+    ResultadoTrecho *trechos;
+    int num_trechos;
+    atomic_int proximo_trecho;
+    atomic_int falhou;
+} TrabalhoLexico;
+
+// Os vetores de tokens sao escritos uma vez, inteiros: com paginas de 2 MiB as faltas de
+// pagina ao toca-los deixam de pesar
+static void pedir_paginas_grandes(void *inicio, size_t tamanho) {
+#ifdef MADV_HUGEPAGE
+    const uintptr_t pagina = (uintptr_t)2 << 20;
+    uintptr_t primeira = ((uintptr_t)inicio + pagina - 1) & ~(pagina - 1);
+    uintptr_t fim = ((uintptr_t)inicio + tamanho) & ~(pagina - 1);
+    if (fim > primeira) madvise((void *)primeira, fim - primeira, MADV_HUGEPAGE);
+#else
+    (void)inicio;
+    (void)tamanho;
+#endif
+}
+
+static int acrescentar_token(Especulacao *especulacao, Token token) {
+    if (especulacao->num_tokens == especulacao->capacidade) {
+        size_t capacidade = especulacao->capacidade ? especulacao->capacidade * 2 : 64;
+        Token *tokens = realloc(especulacao->tokens, capacidade * sizeof(Token));
+        if (!tokens) return -1;
+        especulacao->tokens = tokens;
+        especulacao->capacidade = capacidade;
+    }
+    especulacao->tokens[especulacao->num_tokens++] = token;
+    return 0;
+}
+
+// Analisa o trecho a partir dos dois estados. Retorna 0 ou -1 sem memoria
+static int analisar_trecho(const char *dados, ResultadoTrecho *trecho) {
+    Especulacao *codigo = &trecho->codigo;
+    // Uns 5 bytes por token nos programas tipicos; paginas nao usadas nem chegam a ser tocadas
+    codigo->capacidade = (trecho->fim - trecho->inicio) / 4 + 64;
+    codigo->tokens = malloc(codigo->capacidade * sizeof(Token));
+    if (!codigo->tokens) return -1;
+    pedir_paginas_grandes(codigo->tokens, codigo->capacidade * sizeof(Token));
+
+    AnalisadorLexico lexico;
+    iniciar_analisador_trecho(&lexico, dados, trecho->inicio, trecho->fim);
+    for (;;) {
+        Token token = proximo_token(&lexico);
+        if (token.tipo == TOKEN_EOF) break;
+        if (acrescentar_token(codigo, token) != 0) return -1;
+    }
+    codigo->comentario_aberto = lexico.comentario_aberto;
+    trecho->linhas = lexico.linha;
+
+    // Dentro de um comentario, o primeiro "-}" o fecha
+    const char *inicio = dados + trecho->inicio;
+    const char *fim = dados + trecho->fim;
+    int linhas = 0;
+    const char *p = buscar_fim_comentario(inicio, fim, &linhas);
+    if (p == fim && !(p - inicio >= 2 && p[-2] == '-' && p[-1] == '}')) {
+        trecho->comentario.comentario_aberto = 1;
+        return 0;
+    }
+    iniciar_analisador_trecho(&lexico, dados, (size_t)(p - dados), trecho->fim);
+    lexico.linha = linhas;
+    size_t j = 0;
+    for (;;) {
+        Token token = proximo_token(&lexico);
+        if (token.tipo == TOKEN_EOF) break;
+        // As duas no codigo na mesma posicao: dali em diante produzem os mesmos tokens
+        while (j < codigo->num_tokens && codigo->tokens[j].inicio < token.inicio) j++;
+        if (j < codigo->num_tokens && codigo->tokens[j].inicio == token.inicio) {
+            trecho->alcancou = 1;
+            trecho->juncao = j;
+            return 0;
+        }
+        if (acrescentar_token(&trecho->comentario, token) != 0) return -1;
+    }
+    trecho->comentario.comentario_aberto = lexico.comentario_aberto;
+    return 0;
+}
+
+static void *trabalhador_lexico(void *argumento) {
+    TrabalhoLexico *trabalho = argumento;
+    for (;;) {
+        int i = atomic_fetch_add(&trabalho->proximo_trecho, 1);
+        if (i >= trabalho->num_trechos) break;
+        if (analisar_trecho(trabalho->dados, &trabalho->trechos[i]) != 0) {
+            atomic_store(&trabalho->falhou, 1);
+        }
+    }
+    return NULL;
+}
+
+// Trechos de tamanhos parecidos, cada um terminando logo depois de um '\n'; menos que
+// num_trechos se faltarem quebras de linha. Retorna quantos
+static int dividir_trechos(ResultadoTrecho *trechos, const char *dados, size_t tamanho, int num_trechos) {
+    int n = 0;
+    size_t inicio = 0;
+    for (int i = 1; i < num_trechos; i++) {
+        size_t alvo = (size_t)((unsigned long long)tamanho * (unsigned)i / (unsigned)num_trechos);
+        if (alvo < inicio) alvo = inicio;
+        if (alvo >= tamanho) break;
+        const char *nova_linha = memchr(dados + alvo, '\n', tamanho - alvo);
+        if (!nova_linha || (size_t)(nova_linha - dados) + 1 >= tamanho) break;
+        trechos[n].inicio = inicio;
+        trechos[n].fim = (size_t)(nova_linha - dados) + 1;
+        inicio = trechos[n++].fim;
+    }
+    trechos[n].inicio = inicio;
+    trechos[n].fim = tamanho;
+    return n + 1;
+}
+
+static void acrescentar_segmento(TokensParalelos *tokens, const Token *inicio, size_t num_tokens, int linha_base) {
+    if (num_tokens == 0) return;
+    SegmentoTokens *segmento = &tokens->segmentos[tokens->num_segmentos++];
+    segmento->tokens = inicio;
+    segmento->num_tokens = num_tokens;
+    segmento->linha_base = linha_base;
+}
+
+// Escolhe em ordem a especulacao de cada trecho pelo estado em que o anterior terminou
+static void costurar_trechos(TokensParalelos *tokens, size_t tamanho) {
+    int linha_base = 1;
+    int em_comentario = 0;
+    for (int i = 0; i < tokens->num_trechos; i++) {
+        const ResultadoTrecho *trecho = &tokens->trechos[i];
+        const Especulacao *codigo = &trecho->codigo;
+        if (!em_comentario) {
+            acrescentar_segmento(tokens, codigo->tokens, codigo->num_tokens, linha_base);
+            em_comentario = codigo->comentario_aberto;
+        } else {
+            acrescentar_segmento(tokens, trecho->comentario.tokens, trecho->comentario.num_tokens, linha_base);
+            if (trecho->alcancou) {
+                acrescentar_segmento(tokens, codigo->tokens + trecho->juncao,
+                                     codigo->num_tokens - trecho->juncao, linha_base);
+                em_comentario = codigo->comentario_aberto;
+            } else {
+                em_comentario = trecho->comentario.comentario_aberto;
+            }
+        }
+        linha_base += trecho->linhas;
+    }
+
+    memset(&tokens->fim_arquivo, 0, sizeof(tokens->fim_arquivo));
+    tokens->fim_arquivo.tipo = TOKEN_EOF;
+    tokens->fim_arquivo.linha = linha_base;
+    tokens->fim_arquivo.inicio = (uint32_t)tamanho;
+    tokens->fim_arquivo.valor.id_identificador = -1;
+}
+
+int analisar_lexico_em_trechos(TokensParalelos *tokens, const char *dados, size_t tamanho,
+                               int num_threads, int num_trechos) {
+    memset(tokens, 0, sizeof(*tokens));
+    if (num_trechos < 1) num_trechos = 1;
+    tokens->trechos = calloc((size_t)num_trechos, sizeof(ResultadoTrecho));
+    tokens->segmentos = malloc((size_t)num_trechos * 2 * sizeof(SegmentoTokens));
+    if (!tokens->trechos || !tokens->segmentos) {
+        liberar_tokens_paralelos(tokens);
+        errno = ENOMEM;
+        return -1;
+    }
+    tokens->num_trechos = dividir_trechos(tokens->trechos, dados, tamanho, num_trechos);
+
+    TrabalhoLexico trabalho;
+    trabalho.dados = dados;
+    trabalho.trechos = tokens->trechos;
+    trabalho.num_trechos = tokens->num_trechos;
+    atomic_init(&trabalho.proximo_trecho, 0);
+    atomic_init(&trabalho.falhou, 0);
+
+    // A thread que chama tambem trabalha; sem conseguir criar as outras, faz o resto sozinha
+    if (num_threads > tokens->num_trechos) num_threads = tokens->num_trechos;
+    pthread_t *threads = num_threads > 1 ? malloc((size_t)(num_threads - 1) * sizeof(pthread_t)) : NULL;
+    int criadas = 0;
+    while (threads && criadas < num_threads - 1 &&
+           pthread_create(&threads[criadas], NULL, trabalhador_lexico, &trabalho) == 0) {
+        criadas++;
+    }
+    trabalhador_lexico(&trabalho);
+    for (int i = 0; i < criadas; i++) pthread_join(threads[i], NULL);
+    free(threads);
+
+    if (atomic_load(&trabalho.falhou)) {
+        liberar_tokens_paralelos(tokens);
+        errno = ENOMEM;
+        return -1;
+    }
+    costurar_trechos(tokens, tamanho);
+    return 0;
+}
+
+int analisar_lexico_paralelo(TokensParalelos *tokens, const char *dados, size_t tamanho, int num_threads) {
+    if (num_threads <= 0) {
+        long processadores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = processadores > 0 ? (int)processadores : 1;
+    }
+    size_t num_trechos = tamanho / TAMANHO_MINIMO_TRECHO;
+    if (num_trechos > (size_t)num_threads * TRECHOS_POR_THREAD) num_trechos = (size_t)num_threads * TRECHOS_POR_THREAD;
+    return analisar_lexico_em_trechos(tokens, dados, tamanho, num_threads, num_trechos ? (int)num_trechos : 1);
+}
+
+int avancar_segmento(TokensParalelos *tokens) {
+    if (tokens->proximo_segmento == tokens->num_segmentos) return 0;
+    const SegmentoTokens *segmento = &tokens->segmentos[tokens->proximo_segmento++];
+    tokens->atual = segmento->tokens;
+    tokens->fim_segmento = segmento->tokens + segmento->num_tokens;
+    tokens->linha_base = segmento->linha_base;
+    return 1;
+}
+
+void liberar_tokens_paralelos(TokensParalelos *tokens) {
+    for (int i = 0; tokens->trechos && i < tokens->num_trechos; i++) {
+        free(tokens->trechos[i].codigo.tokens);
+        free(tokens->trechos[i].comentario.tokens);
+    }
+    free(tokens->trechos);
+    free(tokens->segmentos);
+    memset(tokens, 0, sizeof(*tokens));
+}
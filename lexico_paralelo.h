@@ -0,0 +1,63 @@
+#ifndef LEXICO_PARALELO_H
+#define LEXICO_PARALELO_H
+
+#include <stddef.h>
+
+#include "lexico.h"
+
+// Analise lexica de fontes grandes em varias threads. O buffer e dividido em trechos que
+// comecam logo depois de um '\n': ali nenhum token nem comentario de linha esta aberto, entao
+// o analisador so pode estar no codigo ou dentro de um comentario {- -}. Cada trecho e
+// analisado especulativamente a partir dos dois estados; a partir do estado "comentario" so
+// ate alcancar um token da analise a partir do codigo, porque dali em diante as duas
+// coincidem. A costura escolhe, em ordem, a especulacao do estado em que o trecho anterior
+// terminou. As linhas sao contadas de 0 em cada trecho e corrigidas pela soma dos '\n' dos
+// anteriores, entao a sequencia e identica a de proximo_token
+#define TAMANHO_MINIMO_TRECHO (1u << 20)
+#define TRECHOS_POR_THREAD 4
+
+// Tokens consecutivos de um trecho, com as linhas relativas a linha_base
+typedef struct {
+    const Token *tokens;
+    size_t num_tokens;
+    int linha_base;
+} SegmentoTokens;
+
+typedef struct ResultadoTrecho ResultadoTrecho;
+
+typedef struct {
+    ResultadoTrecho *trechos;
+    int num_trechos;
+    SegmentoTokens *segmentos;
+    int num_segmentos;
+    int proximo_segmento;
+    const Token *atual;
+    const Token *fim_segmento;
+    int linha_base;
+    Token fim_arquivo;      // o TOKEN_EOF de proximo_token
+} TokensParalelos;
+
+// Analisa dados[0, tamanho) em ate num_threads threads (0: uma por processador), com trechos
+// de pelo menos TAMANHO_MINIMO_TRECHO. Retorna 0 ou -1 (errno definido)
+int analisar_lexico_paralelo(TokensParalelos *tokens, const char *dados, size_t tamanho, int num_threads);
+
+// O mesmo com o numero de trechos escolhido, de qualquer tamanho: usada nos testes
+int analisar_lexico_em_trechos(TokensParalelos *tokens, const char *dados, size_t tamanho,
+                               int num_threads, int num_trechos);
+
+void liberar_tokens_paralelos(TokensParalelos *tokens);
+
+// Passa ao proximo segmento nao vazio; 0 se acabaram
+int avancar_segmento(TokensParalelos *tokens);
+
+// Proximo token, na sequencia de proximo_token; depois do ultimo repete o TOKEN_EOF
+static inline Token proximo_token_paralelo(TokensParalelos *tokens) {
+    if (tokens->atual == tokens->fim_segmento && !avancar_segmento(tokens)) {
+        return tokens->fim_arquivo;
+    }
+    Token token = *tokens->atual++;
+    token.linha += tokens->linha_base;
+    return token;
+}
+
+#endif
@@ -0,0 +1,371 @@
+#include "maquina_mepa.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "memoria.h"
+
+// Threading direto com computed goto no GCC/Clang; switch nos demais compiladores
+#if defined(__GNUC__) && !defined(MEPA_DESPACHO_SWITCH)
+#define MEPA_DESPACHO_DIRETO 1
+#endif
+
+// Memoria zerada; NULL sem memoria
+static void *alocar(size_t tamanho) {
+    return calloc(1, tamanho ? tamanho : 1);
+}
+
+int preparar_programa_vm(ProgramaVM *programa, const CodigoMepa *codigo, FILE *erros) {
+    memset(programa, 0, sizeof(*programa));
+    programa->erros = erros;
+
+    // NADA so marca posicao: o rotulo passa a apontar para a instrucao seguinte. Com desvios
+    // absolutos (--labels=absolute) nao ha NADA e cada rotulo e o proprio destino
+    int num_rotulos;
+    int *destinos;
+    int num_instrucoes = 0;
+    if (codigo->desvios_absolutos) {
+        num_instrucoes = codigo->num_instrucoes;
+        num_rotulos = num_instrucoes + 1;
+        destinos = alocar((size_t)num_rotulos * sizeof(int));
+        if (!destinos) goto sem_memoria;
+        for (int r = 0; r < num_rotulos; r++) destinos[r] = r;
+    } else {
+        num_rotulos = 1;
+        for (int i = 0; i < codigo->num_instrucoes; i++) {
+            const InstrucaoMepa *instrucao = &codigo->instrucoes[i];
+            if (tipo_operando(instrucao->opcode) == OPERANDO_ROTULO && instrucao->operando >= num_rotulos) {
+                num_rotulos = instrucao->operando + 1;
+            }
+        }
+        destinos = alocar((size_t)num_rotulos * sizeof(int));
+        if (!destinos) goto sem_memoria;
+        for (int r = 0; r < num_rotulos; r++) destinos[r] = -1;
+        for (int i = 0; i < codigo->num_instrucoes; i++) {
+            const InstrucaoMepa *instrucao = &codigo->instrucoes[i];
+            if (instrucao->opcode == MEPA_NADA) {
+                if (instrucao->operando < 0 || destinos[instrucao->operando] != -1) {
+                    fprintf(erros, "Erro MEPA: rotulo L%d definido mais de uma vez\n", instrucao->operando);
+                    free(destinos);
+                    return -1;
+                }
+                destinos[instrucao->operando] = num_instrucoes;
+            } else {
+                num_instrucoes++;
+            }
+        }
+    }
+
+    // Um PARA final garante que a execucao nunca passa do fim do vetor
+    programa->instrucoes = alocar((size_t)(num_instrucoes + 1) * sizeof(InstrucaoVM));
+    if (!programa->instrucoes) {
+        free(destinos);
+        goto sem_memoria;
+    }
+    for (int i = 0; i < codigo->num_instrucoes; i++) {
+        const InstrucaoMepa *origem = &codigo->instrucoes[i];
+        if (origem->opcode == MEPA_NADA) continue;
+
+        InstrucaoVM *destino = &programa->instrucoes[programa->num_instrucoes++];
+        destino->opcode = origem->opcode;
+        destino->operando = origem->operando;
+        destino->operando2 = origem->operando2;
+
+        if (origem->opcode == MEPA_DSVF || origem->opcode == MEPA_DSVS) {
+            if (origem->operando < 0 || origem->operando >= num_rotulos || destinos[origem->operando] == -1) {
+                if (codigo->desvios_absolutos) {
+                    fprintf(erros, "Erro MEPA: desvio para a instrucao %d, fora do codigo\n", origem->operando);
+                } else {
+                    fprintf(erros, "Erro MEPA: rotulo L%d nao definido\n", origem->operando);
+                }
+                free(destinos);
+                liberar_programa_vm(programa);
+                return -1;
+            }
+            destino->operando = destinos[origem->operando];
+        } else if (origem->opcode == MEPA_AMEM) {
+            if (origem->operando < 0) {
+                fprintf(erros, "Erro MEPA: AMEM com tamanho negativo\n");
+                free(destinos);
+                liberar_programa_vm(programa);
+                return -1;
+            }
+            programa->tamanho_memoria += origem->operando;
+        }
+    }
+    programa->instrucoes[programa->num_instrucoes++].opcode = MEPA_PARA;
+    free(destinos);
+
+    // Enderecos validados aqui para que a execucao nao precise de verificacoes
+    for (int i = 0; i < programa->num_instrucoes; i++) {
+        const InstrucaoVM *instrucao = &programa->instrucoes[i];
+        int enderecos = mascara_enderecos(instrucao->opcode);
+        int invalido = -1;
+        if ((enderecos & ENDERECO_OPERANDO) &&
+            (instrucao->operando < 0 || instrucao->operando >= programa->tamanho_memoria)) {
+            invalido = instrucao->operando;
+        } else if ((enderecos & ENDERECO_OPERANDO2) &&
+                   (instrucao->operando2 < 0 || instrucao->operando2 >= programa->tamanho_memoria)) {
+            invalido = instrucao->operando2;
+        }
+        if (invalido != -1) {
+            fprintf(erros, "Erro MEPA: endereco %d fora da memoria alocada\n", invalido);
+            liberar_programa_vm(programa);
+            return -1;
+        }
+    }
+
+    int profundidade_maxima;
+    if (analisar_pilha_mepa(codigo, NULL, &profundidade_maxima, erros) != 0) {
+        liberar_programa_vm(programa);
+        return -1;
+    }
+    programa->tamanho_pilha = programa->tamanho_memoria + profundidade_maxima;
+    return 0;
+
+sem_memoria:
+    fprintf(erros, "Erro: memoria insuficiente\n");
+    return -1;
+}
+
+void liberar_programa_vm(ProgramaVM *programa) {
+    free(programa->instrucoes);
+    free(programa->contagens);
+    free(programa->inicio_bloco);
+    memset(programa, 0, sizeof(*programa));
+}
+
+void ativar_perfil_vm(ProgramaVM *programa) {
+    if (programa->contagens) return;
+    int n = programa->num_instrucoes;
+    programa->contagens = alocar((size_t)n * sizeof(long long));
+    // Blocos comecam na primeira instrucao, nos destinos de desvio e logo depois de um desvio
+    programa->inicio_bloco = alocar((size_t)n);
+    if (!programa->contagens || !programa->inicio_bloco) {
+        free(programa->contagens);
+        free(programa->inicio_bloco);
+        programa->contagens = NULL;
+        programa->inicio_bloco = NULL;
+        memoria_insuficiente();
+    }
+    programa->inicio_bloco[0] = 1;
+    for (int i = 0; i < n; i++) {
+        const InstrucaoVM *instrucao = &programa->instrucoes[i];
+        if (instrucao->opcode == MEPA_DSVS || instrucao->opcode == MEPA_DSVF) {
+            programa->inicio_bloco[instrucao->operando] = 1;
+            if (i + 1 < n) programa->inicio_bloco[i + 1] = 1;
+        }
+    }
+}
+
+// Repete a contagem de cada inicio de bloco nas instrucoes seguintes do bloco
+static void expandir_contagens(ProgramaVM *programa) {
+    for (int i = 1; i < programa->num_instrucoes; i++) {
+        if (!programa->inicio_bloco[i]) programa->contagens[i] = programa->contagens[i - 1];
+    }
+}
+
+// Valores de despacho_preparado: manipuladores diretos ou todos passando pelo contador do perfil
+#define DESPACHO_DIRETO 1
+#define DESPACHO_PERFIL 2
+
+int executar_programa_vm(ProgramaVM *programa, FILE *entrada, FILE *saida,
+                         long long *instrucoes_executadas) {
+    int *memoria = alocar((size_t)(programa->tamanho_pilha + 1) * sizeof(int));
+    if (!memoria) {
+        fprintf(programa->erros, "Erro de execucao: memoria insuficiente\n");
+        return -1;
+    }
+    int *topo = memoria - 1;
+    const InstrucaoVM *base = programa->instrucoes;
+    const InstrucaoVM *ip = base;
+    long long contador = 0;
+    long long *contagens = programa->contagens;
+    const unsigned char *inicio_bloco = programa->inicio_bloco;
+    int resultado = 0;
+
+#ifdef MEPA_DESPACHO_DIRETO
+    static const void *const manipuladores[NUM_OPCODES_MEPA] = {
+        [MEPA_INPP] = &&alvo_MEPA_INPP, [MEPA_AMEM] = &&alvo_MEPA_AMEM,
+        [MEPA_CRCT] = &&alvo_MEPA_CRCT, [MEPA_CRVL] = &&alvo_MEPA_CRVL,
+        [MEPA_ARMZ] = &&alvo_MEPA_ARMZ, [MEPA_LEIT] = &&alvo_MEPA_LEIT,
+        [MEPA_IMPR] = &&alvo_MEPA_IMPR, [MEPA_MULT] = &&alvo_MEPA_MULT,
+        [MEPA_SOMA] = &&alvo_MEPA_SOMA, [MEPA_CMEG] = &&alvo_MEPA_CMEG,
+        [MEPA_DSVF] = &&alvo_MEPA_DSVF, [MEPA_DSVS] = &&alvo_MEPA_DSVS,
+        [MEPA_NADA] = &&alvo_MEPA_NADA, [MEPA_PARA] = &&alvo_MEPA_PARA,
+        [MEPA_INCR] = &&alvo_MEPA_INCR, [MEPA_CRVL_CRVL_CMEG] = &&alvo_MEPA_CRVL_CRVL_CMEG,
+        [MEPA_ARMZ_CRVL] = &&alvo_MEPA_ARMZ_CRVL, [MEPA_CRCT_ARMZ] = &&alvo_MEPA_CRCT_ARMZ,
+        [MEPA_CRVL_ARMZ] = &&alvo_MEPA_CRVL_ARMZ,
+        [MEPA_SUBT] = &&alvo_MEPA_SUBT, [MEPA_DIVI] = &&alvo_MEPA_DIVI,
+        [MEPA_MODI] = &&alvo_MEPA_MODI, [MEPA_CMIG] = &&alvo_MEPA_CMIG,
+        [MEPA_CMDG] = &&alvo_MEPA_CMDG, [MEPA_CMME] = &&alvo_MEPA_CMME,
+        [MEPA_CMMA] = &&alvo_MEPA_CMMA, [MEPA_CMAG] = &&alvo_MEPA_CMAG,
+    };
+    // Com perfil o inicio de cada bloco passa antes por alvo_perfil; sem ele o laco nao muda
+    int despacho = contagens ? DESPACHO_PERFIL : DESPACHO_DIRETO;
+    if (programa->despacho_preparado != despacho) {
+        for (int i = 0; i < programa->num_instrucoes; i++) {
+            programa->instrucoes[i].manipulador = contagens && inicio_bloco[i]
+                                                      ? &&alvo_perfil
+                                                      : manipuladores[programa->instrucoes[i].opcode];
+        }
+        programa->despacho_preparado = despacho;
+    }
+#define CASO(op) alvo_##op:
+#define PROXIMA() do { contador++; goto *ip->manipulador; } while (0)
+    PROXIMA();
+alvo_perfil:
+    contagens[ip - base]++;
+    goto *manipuladores[ip->opcode];
+#else
+#define CASO(op) case op:
+#define PROXIMA() goto despacho
+despacho:
+    contador++;
+    if (contagens && inicio_bloco[ip - base]) contagens[ip - base]++;
+    switch (ip->opcode) {
+#endif
+
+    CASO(MEPA_INPP)
+        topo = memoria - 1;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_AMEM)
+        memset(topo + 1, 0, (size_t)ip->operando * sizeof(int));
+        topo += ip->operando;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CRCT)
+        *++topo = ip->operando;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CRVL)
+        *++topo = memoria[ip->operando];
+        ip++;
+        PROXIMA();
+    CASO(MEPA_ARMZ)
+        memoria[ip->operando] = *topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_LEIT)
+        if (fscanf(entrada, "%d", topo + 1) != 1) {
+            fprintf(programa->erros, "Erro de execucao: LEIT sem um inteiro na entrada\n");
+            resultado = -1;
+            goto fim;
+        }
+        topo++;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_IMPR)
+        fprintf(saida, "%d\n", *topo--);
+        ip++;
+        PROXIMA();
+    CASO(MEPA_MULT)
+        topo[-1] = (int)((unsigned)topo[-1] * (unsigned)topo[0]);
+        topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_SOMA)
+        topo[-1] = (int)((unsigned)topo[-1] + (unsigned)topo[0]);
+        topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CMEG)
+        topo[-1] = topo[-1] <= topo[0];
+        topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_DSVF)
+        ip = *topo-- ? ip + 1 : base + ip->operando;
+        PROXIMA();
+    CASO(MEPA_DSVS)
+        ip = base + ip->operando;
+        PROXIMA();
+    CASO(MEPA_NADA)
+        ip++;
+        PROXIMA();
+    CASO(MEPA_PARA)
+        goto fim;
+    CASO(MEPA_INCR)
+        memoria[ip->operando] = (int)((unsigned)memoria[ip->operando] + 1u);
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CRVL_CRVL_CMEG)
+        *++topo = memoria[ip->operando] <= memoria[ip->operando2];
+        ip++;
+        PROXIMA();
+    CASO(MEPA_ARMZ_CRVL)
+        memoria[ip->operando] = *topo;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CRCT_ARMZ)
+        memoria[ip->operando2] = ip->operando;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CRVL_ARMZ)
+        memoria[ip->operando2] = memoria[ip->operando];
+        ip++;
+        PROXIMA();
+    CASO(MEPA_SUBT)
+        topo[-1] = (int)((unsigned)topo[-1] - (unsigned)topo[0]);
+        topo--;
+        ip++;
+        PROXIMA();
+    // Divisao truncada como em C; INT_MIN div -1 da a mesma volta da multiplicacao
+    CASO(MEPA_DIVI)
+        if (topo[0] == 0) goto divisao_por_zero;
+        topo[-1] = topo[0] == -1 ? (int)(0u - (unsigned)topo[-1]) : topo[-1] / topo[0];
+        topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_MODI)
+        if (topo[0] == 0) goto divisao_por_zero;
+        topo[-1] = topo[0] == -1 ? 0 : topo[-1] % topo[0];
+        topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CMIG)
+        topo[-1] = topo[-1] == topo[0];
+        topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CMDG)
+        topo[-1] = topo[-1] != topo[0];
+        topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CMME)
+        topo[-1] = topo[-1] < topo[0];
+        topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CMMA)
+        topo[-1] = topo[-1] > topo[0];
+        topo--;
+        ip++;
+        PROXIMA();
+    CASO(MEPA_CMAG)
+        topo[-1] = topo[-1] >= topo[0];
+        topo--;
+        ip++;
+        PROXIMA();
+
+#ifndef MEPA_DESPACHO_DIRETO
+        default:
+            fprintf(programa->erros, "Erro de execucao: opcode %d invalido\n", ip->opcode);
+            resultado = -1;
+            goto fim;
+    }
+#endif
+#undef CASO
+#undef PROXIMA
+
+divisao_por_zero:
+    fprintf(programa->erros, "Erro de execucao: divisao por zero\n");
+    resultado = -1;
+fim:
+    if (contagens) expandir_contagens(programa);
+    if (instrucoes_executadas) *instrucoes_executadas = contador;
+    free(memoria);
+    return resultado;
+}
@@ -0,0 +1,43 @@
+#ifndef MAQUINA_MEPA_H
+#define MAQUINA_MEPA_H
+
+#include <stdio.h>
+
+#include "mepa.h"
+
+// Instrucao pre-decodificada: desvios ja apontam para o indice de destino
+typedef struct {
+    const void *manipulador;
+    OpcodeMepa opcode;
+    int operando;
+    int operando2;
+} InstrucaoVM;
+
+// Programa pronto para execucao: sem NADA, rotulos resolvidos e pilha dimensionada
+typedef struct {
+    InstrucaoVM *instrucoes;
+    int num_instrucoes;
+    int tamanho_memoria;
+    int tamanho_pilha;
+    int despacho_preparado;
+    long long *contagens;   // com perfil: execucoes de cada instrucao; NULL sem perfil
+    unsigned char *inicio_bloco;  // com perfil: 1 nas instrucoes que comecam um bloco basico
+    FILE *erros;            // erros de execucao; preparar_programa_vm usa o erros que recebe
+} ProgramaVM;
+
+// Resolve rotulos e verifica enderecos e profundidade da pilha. Retorna 0 ou -1 com
+// mensagem em erros
+int preparar_programa_vm(ProgramaVM *programa, const CodigoMepa *codigo, FILE *erros);
+void liberar_programa_vm(ProgramaVM *programa);
+
+// Liga o perfil: as proximas execucoes contam quantas vezes cada instrucao rodou.
+// A instrucao i do ProgramaVM e a i-esima instrucao do CodigoMepa que nao e NADA.
+// So o inicio de cada bloco basico e contado; o resto do bloco recebe a mesma contagem
+// ao fim da execucao (um erro de LEIT no meio do bloco conta o bloco inteiro)
+void ativar_perfil_vm(ProgramaVM *programa);
+
+// Executa ate PARA; instrucoes_executadas pode ser NULL. Retorna 0 ou -1 (erro de execucao)
+int executar_programa_vm(ProgramaVM *programa, FILE *entrada, FILE *saida,
+                         long long *instrucoes_executadas);
+
+#endif
@@ -0,0 +1,19 @@
+#include "memoria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Cada thread (trabalhador do lote ou do servidor) tem o seu
+static _Thread_local jmp_buf *recuperacao;
+
+_Noreturn void memoria_insuficiente(void) {
+    if (recuperacao) longjmp(*recuperacao, 1);
+    fprintf(stderr, "Erro: memoria insuficiente\n");
+    exit(1);
+}
+
+jmp_buf *definir_recuperacao_memoria(jmp_buf *ponto) {
+    jmp_buf *anterior = recuperacao;
+    recuperacao = ponto;
+    return anterior;
+}
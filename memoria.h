@@ -0,0 +1,16 @@
+#ifndef MEMORIA_H
+#define MEMORIA_H
+
+#include <setjmp.h>
+
+// Falta de memoria onde nao ha como devolver um erro (arena, tabelas, emissao de
+// instrucoes). Com um ponto de recuperacao instalado nesta thread, volta a ele via
+// longjmp: so o arquivo em compilacao falha e o servidor (--daemon) continua. Sem
+// nenhum, mostra a mensagem em stderr e encerra o processo
+_Noreturn void memoria_insuficiente(void);
+
+// Instala o ponto de recuperacao da thread (NULL remove) e retorna o anterior, que quem
+// instalou deve restaurar ao sair
+jmp_buf *definir_recuperacao_memoria(jmp_buf *ponto);
+
+#endif
@@ -0,0 +1,571 @@
+#include "mepa.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "memoria.h"
+
+#define TAMANHO_BUFFER_SAIDA (64 * 1024)
+
+static const struct {
+    const char *nome;
+    TipoOperando operando;
+    int consome;
+    int produz;
+    int enderecos;
+} info_opcodes[NUM_OPCODES_MEPA] = {
+    [MEPA_INPP] = {"INPP", OPERANDO_NENHUM, 0, 0, 0},
+    [MEPA_AMEM] = {"AMEM", OPERANDO_INTEIRO, 0, 0, 0},
+    [MEPA_CRCT] = {"CRCT", OPERANDO_INTEIRO, 0, 1, 0},
+    [MEPA_CRVL] = {"CRVL", OPERANDO_INTEIRO, 0, 1, ENDERECO_OPERANDO},
+    [MEPA_ARMZ] = {"ARMZ", OPERANDO_INTEIRO, 1, 0, ENDERECO_OPERANDO},
+    [MEPA_LEIT] = {"LEIT", OPERANDO_NENHUM, 0, 1, 0},
+    [MEPA_IMPR] = {"IMPR", OPERANDO_NENHUM, 1, 0, 0},
+    [MEPA_MULT] = {"MULT", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_SOMA] = {"SOMA", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_CMEG] = {"CMEG", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_DSVF] = {"DSVF", OPERANDO_ROTULO, 1, 0, 0},
+    [MEPA_DSVS] = {"DSVS", OPERANDO_ROTULO, 0, 0, 0},
+    [MEPA_NADA] = {"NADA", OPERANDO_ROTULO, 0, 0, 0},
+    [MEPA_PARA] = {"PARA", OPERANDO_NENHUM, 0, 0, 0},
+    [MEPA_INCR] = {"INCR", OPERANDO_INTEIRO, 0, 0, ENDERECO_OPERANDO},
+    [MEPA_CRVL_CRVL_CMEG] = {"CRVL_CRVL_CMEG", OPERANDO_DOIS_INTEIROS, 0, 1, ENDERECO_OPERANDO | ENDERECO_OPERANDO2},
+    [MEPA_ARMZ_CRVL] = {"ARMZ_CRVL", OPERANDO_INTEIRO, 1, 1, ENDERECO_OPERANDO},
+    [MEPA_CRCT_ARMZ] = {"CRCT_ARMZ", OPERANDO_DOIS_INTEIROS, 0, 0, ENDERECO_OPERANDO2},
+    [MEPA_CRVL_ARMZ] = {"CRVL_ARMZ", OPERANDO_DOIS_INTEIROS, 0, 0, ENDERECO_OPERANDO | ENDERECO_OPERANDO2},
+    [MEPA_SUBT] = {"SUBT", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_DIVI] = {"DIVI", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_MODI] = {"MODI", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_CMIG] = {"CMIG", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_CMDG] = {"CMDG", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_CMME] = {"CMME", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_CMMA] = {"CMMA", OPERANDO_NENHUM, 2, 1, 0},
+    [MEPA_CMAG] = {"CMAG", OPERANDO_NENHUM, 2, 1, 0},
+};
+
+const char *nome_opcode(OpcodeMepa opcode) {
+    return info_opcodes[opcode].nome;
+}
+
+TipoOperando tipo_operando(OpcodeMepa opcode) {
+    return info_opcodes[opcode].operando;
+}
+
+int consumo_pilha(OpcodeMepa opcode) {
+    return info_opcodes[opcode].consome;
+}
+
+int producao_pilha(OpcodeMepa opcode) {
+    return info_opcodes[opcode].produz;
+}
+
+int mascara_enderecos(OpcodeMepa opcode) {
+    return info_opcodes[opcode].enderecos;
+}
+
+void iniciar_codigo_mepa(CodigoMepa *codigo) {
+    memset(codigo, 0, sizeof(*codigo));
+}
+
+void liberar_codigo_mepa(CodigoMepa *codigo) {
+    free(codigo->instrucoes);
+    memset(codigo, 0, sizeof(*codigo));
+}
+
+void emitir_instrucao(CodigoMepa *codigo, OpcodeMepa opcode, int operando) {
+    if (codigo->num_instrucoes == codigo->capacidade) {
+        int capacidade = codigo->capacidade ? codigo->capacidade * 2 : 256;
+        InstrucaoMepa *novas = realloc(codigo->instrucoes, (size_t)capacidade * sizeof(InstrucaoMepa));
+        if (!novas) memoria_insuficiente();
+        codigo->instrucoes = novas;
+        codigo->capacidade = capacidade;
+    }
+    codigo->instrucoes[codigo->num_instrucoes].opcode = opcode;
+    codigo->instrucoes[codigo->num_instrucoes].operando = operando;
+    codigo->instrucoes[codigo->num_instrucoes].operando2 = 0;
+    codigo->instrucoes[codigo->num_instrucoes].linha = codigo->linha_atual;
+    codigo->num_instrucoes++;
+}
+
+static int maior_rotulo(const CodigoMepa *codigo) {
+    int maior = 0;
+    for (int i = 0; i < codigo->num_instrucoes; i++) {
+        const InstrucaoMepa *instrucao = &codigo->instrucoes[i];
+        if (tipo_operando(instrucao->opcode) == OPERANDO_ROTULO && instrucao->operando > maior) {
+            maior = instrucao->operando;
+        }
+    }
+    return maior;
+}
+
+int resolver_rotulos_mepa(CodigoMepa *codigo, FILE *erros) {
+    if (codigo->desvios_absolutos) return 0;
+    int num_rotulos = maior_rotulo(codigo) + 1;
+    int *definicoes = malloc((size_t)num_rotulos * sizeof(int));
+    int *pendentes = malloc((size_t)num_rotulos * sizeof(int));   // ultimo desvio da lista; -1 vazia
+    if (!definicoes || !pendentes) {
+        fprintf(erros, "Erro: memoria insuficiente\n");
+        free(definicoes);
+        free(pendentes);
+        return -1;
+    }
+    for (int r = 0; r < num_rotulos; r++) definicoes[r] = pendentes[r] = -1;
+
+    // n: instrucoes ja copiadas para o inicio do vetor, sem os NADA
+    int n = 0;
+    int resultado = 0;
+    for (int i = 0; i < codigo->num_instrucoes; i++) {
+        InstrucaoMepa instrucao = codigo->instrucoes[i];
+        int rotulo = instrucao.operando;
+        if (instrucao.opcode == MEPA_NADA) {
+            if (rotulo < 0 || definicoes[rotulo] != -1) {
+                fprintf(erros, "Erro MEPA: rotulo L%d definido mais de uma vez\n", rotulo);
+                resultado = -1;
+                break;
+            }
+            definicoes[rotulo] = n;
+            for (int j = pendentes[rotulo]; j != -1;) {
+                int proximo = codigo->instrucoes[j].operando;
+                codigo->instrucoes[j].operando = n;
+                j = proximo;
+            }
+            pendentes[rotulo] = -1;
+            continue;
+        }
+        if (instrucao.opcode == MEPA_DSVF || instrucao.opcode == MEPA_DSVS) {
+            if (rotulo < 0) {
+                fprintf(erros, "Erro MEPA: rotulo L%d nao definido\n", rotulo);
+                resultado = -1;
+                break;
+            }
+            if (definicoes[rotulo] != -1) {
+                instrucao.operando = definicoes[rotulo];
+            } else {
+                instrucao.operando = pendentes[rotulo];
+                pendentes[rotulo] = n;
+            }
+        }
+        codigo->instrucoes[n++] = instrucao;
+    }
+    for (int r = 0; r < num_rotulos && resultado == 0; r++) {
+        if (pendentes[r] != -1) {
+            fprintf(erros, "Erro MEPA: rotulo L%d nao definido\n", r);
+            resultado = -1;
+        }
+    }
+
+    free(definicoes);
+    free(pendentes);
+    if (resultado != 0) return -1;
+    codigo->num_instrucoes = n;
+    codigo->desvios_absolutos = 1;
+    return 0;
+}
+
+int *posicoes_rotulos_mepa(const CodigoMepa *codigo, int *num_rotulos) {
+    if (codigo->desvios_absolutos) {
+        *num_rotulos = codigo->num_instrucoes + 1;
+        int *posicoes = malloc((size_t)*num_rotulos * sizeof(int));
+        if (!posicoes) return NULL;
+        for (int r = 0; r < *num_rotulos; r++) posicoes[r] = r;
+        return posicoes;
+    }
+    *num_rotulos = maior_rotulo(codigo) + 1;
+    int *posicoes = malloc((size_t)*num_rotulos * sizeof(int));
+    if (!posicoes) return NULL;
+    for (int r = 0; r < *num_rotulos; r++) posicoes[r] = -1;
+    for (int i = 0; i < codigo->num_instrucoes; i++) {
+        if (codigo->instrucoes[i].opcode == MEPA_NADA && codigo->instrucoes[i].operando >= 0) {
+            posicoes[codigo->instrucoes[i].operando] = i;
+        }
+    }
+    return posicoes;
+}
+
+// Buffer de saida proprio: uma chamada de fwrite a cada 64 KiB
+typedef struct {
+    char dados[TAMANHO_BUFFER_SAIDA];
+    size_t usado;
+    FILE *saida;
+    int erro;
+} BufferSaida;
+
+static void descarregar(BufferSaida *buffer) {
+    if (buffer->usado && fwrite(buffer->dados, 1, buffer->usado, buffer->saida) != buffer->usado) {
+        buffer->erro = 1;
+    }
+    buffer->usado = 0;
+}
+
+static void escrever_bytes(BufferSaida *buffer, const void *dados, size_t tamanho) {
+    if (buffer->usado + tamanho > TAMANHO_BUFFER_SAIDA) descarregar(buffer);
+    if (tamanho > TAMANHO_BUFFER_SAIDA) {
+        if (fwrite(dados, 1, tamanho, buffer->saida) != tamanho) buffer->erro = 1;
+        return;
+    }
+    memcpy(buffer->dados + buffer->usado, dados, tamanho);
+    buffer->usado += tamanho;
+}
+
+static void escrever_inteiro(BufferSaida *buffer, int valor) {
+    char digitos[12];
+    int i = sizeof(digitos);
+    unsigned magnitude = valor < 0 ? 0u - (unsigned)valor : (unsigned)valor;
+    do {
+        digitos[--i] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (valor < 0) digitos[--i] = '-';
+    escrever_bytes(buffer, digitos + i, sizeof(digitos) - i);
+}
+
+static void escrever_varint(BufferSaida *buffer, int valor) {
+    unsigned char bytes[5];
+    int n = 0;
+    unsigned zigzag = ((unsigned)valor << 1) ^ (unsigned)(valor >> 31);
+    do {
+        unsigned char byte = zigzag & 0x7F;
+        zigzag >>= 7;
+        bytes[n++] = zigzag ? (byte | 0x80) : byte;
+    } while (zigzag);
+    escrever_bytes(buffer, bytes, n);
+}
+
+int escrever_codigo_texto(const CodigoMepa *codigo, FILE *saida) {
+    BufferSaida buffer;
+    buffer.usado = 0;
+    buffer.saida = saida;
+    buffer.erro = 0;
+
+    for (int i = 0; i < codigo->num_instrucoes; i++) {
+        const InstrucaoMepa *instrucao = &codigo->instrucoes[i];
+        const char *nome = nome_opcode(instrucao->opcode);
+        escrever_bytes(&buffer, nome, strlen(nome));
+        switch (tipo_operando(instrucao->opcode)) {
+            case OPERANDO_INTEIRO:
+                escrever_bytes(&buffer, " ", 1);
+                escrever_inteiro(&buffer, instrucao->operando);
+                break;
+            case OPERANDO_DOIS_INTEIROS:
+                escrever_bytes(&buffer, " ", 1);
+                escrever_inteiro(&buffer, instrucao->operando);
+                escrever_bytes(&buffer, " ", 1);
+                escrever_inteiro(&buffer, instrucao->operando2);
+                break;
+            case OPERANDO_ROTULO:
+                if (instrucao->opcode == MEPA_NADA) {
+                    escrever_bytes(&buffer, " (L", 3);
+                    escrever_inteiro(&buffer, instrucao->operando);
+                    escrever_bytes(&buffer, ")", 1);
+                } else {
+                    escrever_bytes(&buffer, codigo->desvios_absolutos ? " " : " L", codigo->desvios_absolutos ? 1 : 2);
+                    escrever_inteiro(&buffer, instrucao->operando);
+                }
+                break;
+            case OPERANDO_NENHUM:
+                break;
+        }
+        escrever_bytes(&buffer, "\n", 1);
+    }
+
+    descarregar(&buffer);
+    return buffer.erro ? -1 : 0;
+}
+
+int escrever_objeto_binario(const CodigoMepa *codigo, const TabelaSimbolos *tabela,
+                            const PoolIdentificadores *pool, FILE *saida) {
+    BufferSaida buffer;
+    buffer.usado = 0;
+    buffer.saida = saida;
+    buffer.erro = 0;
+
+    const unsigned char cabecalho[6] = {'M', 'E', 'P', 'A', VERSAO_OBJETO_MEPA,
+                                        codigo->desvios_absolutos ? OBJETO_DESVIOS_ABSOLUTOS : 0};
+    escrever_bytes(&buffer, cabecalho, sizeof(cabecalho));
+
+    escrever_varint(&buffer, codigo->num_instrucoes);
+    for (int i = 0; i < codigo->num_instrucoes; i++) {
+        unsigned char opcode = (unsigned char)codigo->instrucoes[i].opcode;
+        escrever_bytes(&buffer, &opcode, 1);
+        if (tipo_operando(codigo->instrucoes[i].opcode) != OPERANDO_NENHUM) {
+            escrever_varint(&buffer, codigo->instrucoes[i].operando);
+        }
+        if (tipo_operando(codigo->instrucoes[i].opcode) == OPERANDO_DOIS_INTEIROS) {
+            escrever_varint(&buffer, codigo->instrucoes[i].operando2);
+        }
+    }
+
+    // Simbolos sem endereco (removidos pela compactacao do quadro) ficam de fora
+    int num_simbolos = 0;
+    for (int i = 0; i < tabela->num_simbolos; i++) {
+        if (tabela->simbolos[i].endereco >= 0) num_simbolos++;
+    }
+    escrever_varint(&buffer, num_simbolos);
+    for (int i = 0; i < tabela->num_simbolos; i++) {
+        if (tabela->simbolos[i].endereco < 0) continue;
+        const char *nome = texto_identificador(pool, tabela->simbolos[i].id);
+        int tamanho = (int)strlen(nome);
+        escrever_varint(&buffer, tamanho);
+        escrever_bytes(&buffer, nome, tamanho);
+        escrever_varint(&buffer, tabela->simbolos[i].endereco);
+    }
+
+    descarregar(&buffer);
+    return buffer.erro ? -1 : 0;
+}
+
+int analisar_pilha_mepa(const CodigoMepa *codigo, int *profundidades, int *profundidade_maxima, FILE *erros) {
+    int n = codigo->num_instrucoes;
+    int num_rotulos;
+    int *posicao_rotulo = posicoes_rotulos_mepa(codigo, &num_rotulos);
+    int *pendentes = malloc((size_t)(n + 1) * sizeof(int));
+    int *alturas = profundidades ? profundidades : malloc((size_t)(n + 1) * sizeof(int));
+    if (!posicao_rotulo || !pendentes || !alturas) {
+        fprintf(erros, "Erro: memoria insuficiente\n");
+        free(posicao_rotulo);
+        free(pendentes);
+        if (!profundidades) free(alturas);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) alturas[i] = -1;
+
+    int num_pendentes = 0;
+    int maximo = 0;
+    int resultado = 0;
+    if (n > 0) {
+        alturas[0] = 0;
+        pendentes[num_pendentes++] = 0;
+    }
+
+    while (num_pendentes > 0 && resultado == 0) {
+        int i = pendentes[--num_pendentes];
+        const InstrucaoMepa *instrucao = &codigo->instrucoes[i];
+        int atual = instrucao->opcode == MEPA_INPP ? 0 : alturas[i];
+
+        if (atual < consumo_pilha(instrucao->opcode)) {
+            fprintf(erros, "Erro MEPA: pilha vazia em %s (instrucao %d)\n", nome_opcode(instrucao->opcode), i);
+            resultado = -1;
+            break;
+        }
+        if (instrucao->opcode == MEPA_AMEM && atual != 0) {
+            fprintf(erros, "Erro MEPA: AMEM com temporarios na pilha (instrucao %d)\n", i);
+            resultado = -1;
+            break;
+        }
+        int depois = atual - consumo_pilha(instrucao->opcode) + producao_pilha(instrucao->opcode);
+        if (depois > maximo) maximo = depois;
+
+        int sucessores[2];
+        int num_sucessores = 0;
+        if (instrucao->opcode == MEPA_DSVS || instrucao->opcode == MEPA_DSVF) {
+            int alvo = instrucao->operando;
+            if (alvo < 0 || alvo >= num_rotulos || posicao_rotulo[alvo] == -1) {
+                if (codigo->desvios_absolutos) {
+                    fprintf(erros, "Erro MEPA: desvio para a instrucao %d, fora do codigo\n", alvo);
+                } else {
+                    fprintf(erros, "Erro MEPA: rotulo L%d nao definido\n", alvo);
+                }
+                resultado = -1;
+                break;
+            }
+            // Desvio absoluto para o fim: a execucao para ali
+            if (posicao_rotulo[alvo] < n) sucessores[num_sucessores++] = posicao_rotulo[alvo];
+        }
+        if (instrucao->opcode != MEPA_DSVS && instrucao->opcode != MEPA_PARA && i + 1 < n) {
+            sucessores[num_sucessores++] = i + 1;
+        }
+
+        for (int k = 0; k < num_sucessores; k++) {
+            int j = sucessores[k];
+            if (alturas[j] == -1) {
+                alturas[j] = depois;
+                pendentes[num_pendentes++] = j;
+            } else if (alturas[j] != depois) {
+                fprintf(erros, "Erro MEPA: altura da pilha inconsistente na instrucao %d\n", j);
+                resultado = -1;
+                break;
+            }
+        }
+    }
+
+    free(posicao_rotulo);
+    free(pendentes);
+    if (!profundidades) free(alturas);
+    if (profundidade_maxima) *profundidade_maxima = maximo;
+    return resultado;
+}
+
+static int ler_varint(const unsigned char **cursor, const unsigned char *fim, int *valor) {
+    unsigned zigzag = 0;
+    for (int deslocamento = 0; deslocamento < 35; deslocamento += 7) {
+        if (*cursor >= fim) return -1;
+        unsigned char byte = *(*cursor)++;
+        zigzag |= (unsigned)(byte & 0x7F) << deslocamento;
+        if (!(byte & 0x80)) {
+            *valor = (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// tabela NULL ignora os simbolos
+static int carregar_objeto_binario(const unsigned char *cursor, const unsigned char *fim, CodigoMepa *codigo,
+                                   TabelaSimbolos *tabela, PoolIdentificadores *pool, FILE *erros) {
+    int num_instrucoes;
+    int versao = cursor[4];
+    cursor += 5;
+    if (versao >= 2) {
+        if (cursor >= fim) {
+            fprintf(erros, "Erro: objeto MEPA truncado\n");
+            return -1;
+        }
+        codigo->desvios_absolutos = (*cursor++ & OBJETO_DESVIOS_ABSOLUTOS) != 0;
+    }
+    if (ler_varint(&cursor, fim, &num_instrucoes) != 0 || num_instrucoes < 0) {
+        fprintf(erros, "Erro: objeto MEPA truncado\n");
+        return -1;
+    }
+    for (int i = 0; i < num_instrucoes; i++) {
+        if (cursor >= fim || *cursor >= NUM_OPCODES_MEPA) {
+            fprintf(erros, "Erro: objeto MEPA invalido na instrucao %d\n", i);
+            return -1;
+        }
+        OpcodeMepa opcode = (OpcodeMepa)*cursor++;
+        if (opcode == MEPA_NADA && codigo->desvios_absolutos) {
+            fprintf(erros, "Erro: objeto MEPA com desvios absolutos contem NADA (instrucao %d)\n", i);
+            return -1;
+        }
+        int operando = 0, operando2 = 0;
+        if ((tipo_operando(opcode) != OPERANDO_NENHUM && ler_varint(&cursor, fim, &operando) != 0) ||
+            (tipo_operando(opcode) == OPERANDO_DOIS_INTEIROS && ler_varint(&cursor, fim, &operando2) != 0)) {
+            fprintf(erros, "Erro: objeto MEPA truncado na instrucao %d\n", i);
+            return -1;
+        }
+        emitir_instrucao(codigo, opcode, operando);
+        codigo->instrucoes[codigo->num_instrucoes - 1].operando2 = operando2;
+    }
+    if (!tabela) return 0;
+
+    int num_simbolos;
+    if (ler_varint(&cursor, fim, &num_simbolos) != 0 || num_simbolos < 0) {
+        fprintf(erros, "Erro: objeto MEPA truncado na tabela de simbolos\n");
+        return -1;
+    }
+    for (int i = 0; i < num_simbolos; i++) {
+        int tamanho, endereco;
+        if (ler_varint(&cursor, fim, &tamanho) != 0 || tamanho < 0 || tamanho > fim - cursor) {
+            fprintf(erros, "Erro: objeto MEPA truncado no simbolo %d\n", i);
+            return -1;
+        }
+        const char *nome = (const char *)cursor;
+        cursor += tamanho;
+        if (ler_varint(&cursor, fim, &endereco) != 0) {
+            fprintf(erros, "Erro: objeto MEPA truncado no simbolo %d\n", i);
+            return -1;
+        }
+        if (!adicionar_simbolo(tabela, internar_identificador(pool, nome, (size_t)tamanho), endereco)) {
+            fprintf(erros, "Erro: simbolo [%.*s] repetido no objeto MEPA\n", tamanho, nome);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Le um operando inteiro; aceita as formas "5", "L5" e "(L5)". rotulo recebe 1 se havia o L
+static int ler_operando_texto(const char **cursor, const char *fim_linha, int *valor, int *rotulo) {
+    const char *p = *cursor;
+    *rotulo = 0;
+    while (p < fim_linha && (*p == ' ' || *p == '\t' || *p == '(' || *p == 'L')) *rotulo |= *p++ == 'L';
+    int negativo = p < fim_linha && *p == '-';
+    if (negativo) p++;
+    if (p == fim_linha || !isdigit((unsigned char)*p)) return -1;
+    unsigned magnitude = 0;
+    while (p < fim_linha && isdigit((unsigned char)*p)) magnitude = magnitude * 10 + (unsigned)(*p++ - '0');
+    *valor = negativo ? (int)(0u - magnitude) : (int)magnitude;
+    *cursor = p;
+    return 0;
+}
+
+// Desvios "DSVF L2" sao simbolicos e "DSVF 7", absolutos; a primeira forma lida vale para
+// o programa todo. NADA so existe na forma simbolica
+static int carregar_codigo_texto(const char *cursor, const char *fim, CodigoMepa *codigo, FILE *erros) {
+    int linha = 1;
+    int forma = -1;     // -1 ainda sem desvios, 0 simbolica, 1 absoluta
+    while (cursor < fim) {
+        const char *fim_linha = memchr(cursor, '\n', (size_t)(fim - cursor));
+        if (!fim_linha) fim_linha = fim;
+
+        const char *p = cursor;
+        while (p < fim_linha && isspace((unsigned char)*p)) p++;
+        // O codigo termina na linha em branco antes da tabela de simbolos
+        if (p == fim_linha) break;
+
+        const char *nome = p;
+        while (p < fim_linha && (isalnum((unsigned char)*p) || *p == '_')) p++;
+        size_t tamanho_nome = (size_t)(p - nome);
+
+        int opcode = 0;
+        while (opcode < NUM_OPCODES_MEPA &&
+               !(strlen(nome_opcode(opcode)) == tamanho_nome && memcmp(nome_opcode(opcode), nome, tamanho_nome) == 0)) {
+            opcode++;
+        }
+        if (opcode == NUM_OPCODES_MEPA) {
+            fprintf(erros, "%d:erro MEPA, instrucao [%.*s] desconhecida\n", linha, (int)tamanho_nome, nome);
+            return -1;
+        }
+
+        int operando = 0, operando2 = 0, rotulo, rotulo2;
+        if ((tipo_operando(opcode) != OPERANDO_NENHUM && ler_operando_texto(&p, fim_linha, &operando, &rotulo) != 0) ||
+            (tipo_operando(opcode) == OPERANDO_DOIS_INTEIROS &&
+             ler_operando_texto(&p, fim_linha, &operando2, &rotulo2) != 0)) {
+            fprintf(erros, "%d:erro MEPA, operando ausente em [%s]\n", linha, nome_opcode(opcode));
+            return -1;
+        }
+        if (tipo_operando(opcode) == OPERANDO_ROTULO) {
+            int absoluto = opcode != MEPA_NADA && !rotulo;
+            if (forma != -1 && forma != absoluto) {
+                fprintf(erros, "%d:erro MEPA, rotulos e desvios absolutos misturados em [%s]\n",
+                        linha, nome_opcode(opcode));
+                return -1;
+            }
+            forma = absoluto;
+        }
+        emitir_instrucao(codigo, (OpcodeMepa)opcode, operando);
+        codigo->instrucoes[codigo->num_instrucoes - 1].operando2 = operando2;
+
+        cursor = fim_linha + 1;
+        linha++;
+    }
+    codigo->desvios_absolutos = forma == 1;
+    return 0;
+}
+
+static int versao_suportada(const char *dados, FILE *erros) {
+    if ((unsigned char)dados[4] < 1 || (unsigned char)dados[4] > VERSAO_OBJETO_MEPA) {
+        fprintf(erros, "Erro: versao %d do objeto MEPA nao suportada\n", (unsigned char)dados[4]);
+        return 0;
+    }
+    return 1;
+}
+
+int carregar_codigo_mepa(const char *dados, size_t tamanho, CodigoMepa *codigo, FILE *erros) {
+    if (tamanho >= 5 && memcmp(dados, "MEPA", 4) == 0) {
+        if (!versao_suportada(dados, erros)) return -1;
+        return carregar_objeto_binario((const unsigned char *)dados,
+                                       (const unsigned char *)dados + tamanho, codigo, NULL, NULL, erros);
+    }
+    return carregar_codigo_texto(dados, dados + tamanho, codigo, erros);
+}
+
+int carregar_objeto_mepa(const char *dados, size_t tamanho, CodigoMepa *codigo,
+                         TabelaSimbolos *tabela, PoolIdentificadores *pool, FILE *erros) {
+    if (tamanho < 5 || memcmp(dados, "MEPA", 4) != 0) {
+        fprintf(erros, "Erro: objeto MEPA sem o cabecalho\n");
+        return -1;
+    }
+    if (!versao_suportada(dados, erros)) return -1;
+    return carregar_objeto_binario((const unsigned char *)dados,
+                                   (const unsigned char *)dados + tamanho, codigo, tabela, pool, erros);
+}
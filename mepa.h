@@ -0,0 +1,98 @@
+#ifndef MEPA_H
+#define MEPA_H
+
+#include <stdio.h>
+
+#include "tabela_simbolos.h"
+
+// Instrucoes da maquina de pilha MEPA geradas pelo compilador
+typedef enum {
+    MEPA_INPP, MEPA_AMEM, MEPA_CRCT, MEPA_CRVL, MEPA_ARMZ, MEPA_LEIT,
+    MEPA_IMPR, MEPA_MULT, MEPA_SOMA, MEPA_CMEG, MEPA_DSVF, MEPA_DSVS,
+    MEPA_NADA, MEPA_PARA,
+    // Superinstrucoes criadas pelo otimizador peephole (-O1)
+    MEPA_INCR, MEPA_CRVL_CRVL_CMEG, MEPA_ARMZ_CRVL, MEPA_CRCT_ARMZ,
+    MEPA_CRVL_ARMZ,
+    // Operadores das expressoes; no fim para nao renumerar os objetos ja gravados
+    MEPA_SUBT, MEPA_DIVI, MEPA_MODI, MEPA_CMIG, MEPA_CMDG, MEPA_CMME,
+    MEPA_CMMA, MEPA_CMAG,
+    NUM_OPCODES_MEPA
+} OpcodeMepa;
+
+typedef struct {
+    OpcodeMepa opcode;
+    int operando;
+    int operando2;
+    int linha;      // linha do fonte que gerou a instrucao (0 se desconhecida)
+} InstrucaoMepa;
+
+// Vetor de instrucoes em memoria, escrito uma unica vez ao final da compilacao
+// linha_atual e gravada em cada instrucao emitida: e a tabela de linhas do perfilador
+typedef struct {
+    InstrucaoMepa *instrucoes;
+    int num_instrucoes;
+    int capacidade;
+    int linha_atual;
+    int desvios_absolutos;  // 1: sem NADA, DSVF/DSVS levam o indice da instrucao de destino
+} CodigoMepa;
+
+typedef enum {
+    OPERANDO_NENHUM,
+    OPERANDO_INTEIRO,
+    OPERANDO_ROTULO,
+    OPERANDO_DOIS_INTEIROS
+} TipoOperando;
+
+// Bits de mascara_enderecos: quais operandos sao enderecos de memoria
+#define ENDERECO_OPERANDO 1
+#define ENDERECO_OPERANDO2 2
+
+const char *nome_opcode(OpcodeMepa opcode);
+TipoOperando tipo_operando(OpcodeMepa opcode);
+// Quantos valores temporarios a instrucao desempilha e empilha (AMEM nao conta)
+int consumo_pilha(OpcodeMepa opcode);
+int producao_pilha(OpcodeMepa opcode);
+int mascara_enderecos(OpcodeMepa opcode);
+
+void iniciar_codigo_mepa(CodigoMepa *codigo);
+void liberar_codigo_mepa(CodigoMepa *codigo);
+void emitir_instrucao(CodigoMepa *codigo, OpcodeMepa opcode, int operando);
+
+// Troca os rotulos pelos indices das instrucoes de destino e remove os NADA
+// (--labels=absolute). Uma passada: cada rotulo guarda onde foi definido e a lista dos
+// desvios para frente que esperam por ele, encadeada nos proprios operandos e corrigida
+// quando o NADA aparece. Retorna 0 ou -1 (rotulo repetido ou nao definido, com mensagem
+// em erros; o codigo fica inutilizavel)
+int resolver_rotulos_mepa(CodigoMepa *codigo, FILE *erros);
+
+// Indice em codigo->instrucoes do destino de cada rotulo (-1 se nao definido); com desvios
+// absolutos, o proprio rotulo, ate num_instrucoes (o fim). Vetor em malloc; NULL sem memoria
+int *posicoes_rotulos_mepa(const CodigoMepa *codigo, int *num_rotulos);
+
+// Formato texto: o mesmo impresso historicamente ("CRVL 0", "DSVF L2", "NADA (L1)");
+// com desvios absolutos, "DSVF 7"
+int escrever_codigo_texto(const CodigoMepa *codigo, FILE *saida);
+
+// Formato binario (--emit=bin):
+//   "MEPA" versao:u8 opcoes:u8
+//   n:varint  n x { opcode:u8 [operando:varint zigzag] [operando2:varint zigzag] }
+//   s:varint  s x { tamanho:varint bytes[tamanho] endereco:varint zigzag }
+// A versao 1 nao tem o byte de opcoes (rotulos simbolicos)
+#define VERSAO_OBJETO_MEPA 2
+#define OBJETO_DESVIOS_ABSOLUTOS 1
+int escrever_objeto_binario(const CodigoMepa *codigo, const TabelaSimbolos *tabela,
+                            const PoolIdentificadores *pool, FILE *saida);
+
+// Altura da pilha de temporarios antes de cada instrucao (-1 se inalcancavel),
+// calculada por fluxo de dados; profundidades pode ser NULL. Retorna 0 ou -1 com mensagem
+// em erros
+int analisar_pilha_mepa(const CodigoMepa *codigo, int *profundidades, int *profundidade_maxima, FILE *erros);
+
+// Le codigo MEPA em texto ou no formato binario (detectado pelo cabecalho).
+// A tabela de simbolos, se presente, e ignorada. Retorna 0 ou -1 com mensagem em erros
+int carregar_codigo_mepa(const char *dados, size_t tamanho, CodigoMepa *codigo, FILE *erros);
+// So o formato binario, lendo tambem a tabela de simbolos para tabela e pool (vazios)
+int carregar_objeto_mepa(const char *dados, size_t tamanho, CodigoMepa *codigo,
+                         TabelaSimbolos *tabela, PoolIdentificadores *pool, FILE *erros);
+
+#endif
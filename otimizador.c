@@ -0,0 +1,89 @@
+#include "otimizador.h"
+
+#include <string.h>
+
+// CRVL x / CRCT 1 / SOMA / ARMZ x
+static int eh_incremento(const InstrucaoMepa *v, int restantes) {
+    return restantes >= 4 &&
+           v[0].opcode == MEPA_CRVL && v[1].opcode == MEPA_CRCT && v[1].operando == 1 &&
+           v[2].opcode == MEPA_SOMA && v[3].opcode == MEPA_ARMZ && v[3].operando == v[0].operando;
+}
+
+static void substituir(InstrucaoMepa *destino, OpcodeMepa opcode, int operando, int operando2) {
+    destino->opcode = opcode;
+    destino->operando = operando;
+    destino->operando2 = operando2;
+}
+
+// Uma passada da esquerda para a direita; retorna 1 se alguma regra foi aplicada
+static int passada_peephole(CodigoMepa *codigo, EstatisticasPeephole *estatisticas) {
+    InstrucaoMepa *v = codigo->instrucoes;
+    int n = codigo->num_instrucoes;
+    int escrita = 0;
+    int mudou = 0;
+
+    for (int i = 0; i < n;) {
+        const InstrucaoMepa *a = &v[i];
+        int restantes = n - i;
+        int linha = a->linha;
+        InstrucaoMepa nova;
+
+        if (eh_incremento(a, restantes)) {
+            substituir(&nova, MEPA_INCR, a[0].operando, 0);
+            estatisticas->fundidas += 4;
+            i += 4;
+        } else if (restantes >= 3 && a[0].opcode == MEPA_CRVL && a[1].opcode == MEPA_CRVL &&
+                   a[2].opcode == MEPA_CMEG) {
+            substituir(&nova, MEPA_CRVL_CRVL_CMEG, a[0].operando, a[1].operando);
+            estatisticas->fundidas += 3;
+            i += 3;
+        } else if (restantes >= 2 && a[0].opcode == MEPA_CRVL && a[1].opcode == MEPA_ARMZ &&
+                   a[0].operando == a[1].operando) {
+            // x := x
+            estatisticas->removidas += 2;
+            i += 2;
+            mudou = 1;
+            continue;
+        } else if (restantes >= 2 && a[0].opcode == MEPA_ARMZ && a[1].opcode == MEPA_CRVL &&
+                   a[0].operando == a[1].operando && !eh_incremento(a + 1, restantes - 1)) {
+            substituir(&nova, MEPA_ARMZ_CRVL, a[0].operando, 0);
+            estatisticas->fundidas += 2;
+            i += 2;
+        } else if (restantes >= 2 && a[0].opcode == MEPA_CRCT && a[1].opcode == MEPA_ARMZ) {
+            substituir(&nova, MEPA_CRCT_ARMZ, a[0].operando, a[1].operando);
+            estatisticas->fundidas += 2;
+            i += 2;
+        } else if (restantes >= 2 && a[0].opcode == MEPA_CRVL && a[1].opcode == MEPA_ARMZ) {
+            substituir(&nova, MEPA_CRVL_ARMZ, a[0].operando, a[1].operando);
+            estatisticas->fundidas += 2;
+            i += 2;
+        } else if (restantes >= 2 && a[0].opcode == MEPA_DSVS && a[1].opcode == MEPA_NADA &&
+                   a[0].operando == a[1].operando) {
+            // Desvio para a instrucao seguinte
+            estatisticas->removidas += 1;
+            i += 1;
+            mudou = 1;
+            continue;
+        } else {
+            v[escrita++] = v[i++];
+            continue;
+        }
+
+        // A superinstrucao fica com a linha da primeira instrucao fundida
+        nova.linha = linha;
+        estatisticas->superinstrucoes++;
+        v[escrita++] = nova;
+        mudou = 1;
+    }
+
+    codigo->num_instrucoes = escrita;
+    return mudou;
+}
+
+void otimizar_peephole(CodigoMepa *codigo, EstatisticasPeephole *estatisticas) {
+    memset(estatisticas, 0, sizeof(*estatisticas));
+    estatisticas->instrucoes_antes = codigo->num_instrucoes;
+    while (passada_peephole(codigo, estatisticas)) {
+    }
+    estatisticas->instrucoes_depois = codigo->num_instrucoes;
+}
@@ -0,0 +1,19 @@
+#ifndef OTIMIZADOR_H
+#define OTIMIZADOR_H
+
+#include "mepa.h"
+
+// Contadores do otimizador peephole
+typedef struct {
+    int instrucoes_antes;
+    int instrucoes_depois;
+    int removidas;
+    int fundidas;
+    int superinstrucoes;
+} EstatisticasPeephole;
+
+// -O1: funde sequencias comuns em superinstrucoes (INCR, CRVL_CRVL_CMEG, ...)
+// e remove pares de carga/armazenamento redundantes. Nunca atravessa um NADA (rotulo)
+void otimizar_peephole(CodigoMepa *codigo, EstatisticasPeephole *estatisticas);
+
+#endif
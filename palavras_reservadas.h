@@ -0,0 +1,74 @@
+#ifndef PALAVRAS_RESERVADAS_H
+#define PALAVRAS_RESERVADAS_H
+
+#include <stddef.h>
+#include <string.h>
+
+// Palavras reservadas da linguagem, compartilhadas pelas duas partes do compilador
+typedef enum {
+    PALAVRA_NENHUMA,
+    PALAVRA_PROGRAM, PALAVRA_INTEGER, PALAVRA_BOOLEAN, PALAVRA_BEGIN,
+    PALAVRA_END, PALAVRA_READ, PALAVRA_WRITE, PALAVRA_IF, PALAVRA_ELIF,
+    PALAVRA_FOR, PALAVRA_SET, PALAVRA_TO, PALAVRA_OF, PALAVRA_TRUE,
+    PALAVRA_FALSE, PALAVRA_AND, PALAVRA_OR, PALAVRA_NOT, PALAVRA_DIV,
+    PALAVRA_MOD,
+    NUM_PALAVRAS_RESERVADAS
+} PalavraReservada;
+
+// Confere o restante do lexema contra a palavra candidata
+#define PALAVRA_SE_IGUAL(texto, palavra) \
+    (memcmp(lexema + 1, (texto) + 1, tamanho - 1) == 0 ? (palavra) : PALAVRA_NENHUMA)
+
+// Reconhecedor gerado em tempo de compilacao: o par (tamanho, primeiro caractere)
+// ja identifica uma unica candidata, entao no maximo um memcmp curto por lexema
+static inline PalavraReservada buscar_palavra_reservada(const char *lexema, size_t tamanho) {
+    switch (tamanho) {
+        case 2:
+            switch (lexema[0]) {
+                case 'i': return PALAVRA_SE_IGUAL("if", PALAVRA_IF);
+                case 't': return PALAVRA_SE_IGUAL("to", PALAVRA_TO);
+                case 'o':
+                    if (lexema[1] == 'f') return PALAVRA_OF;
+                    if (lexema[1] == 'r') return PALAVRA_OR;
+                    return PALAVRA_NENHUMA;
+            }
+            return PALAVRA_NENHUMA;
+        case 3:
+            switch (lexema[0]) {
+                case 'e': return PALAVRA_SE_IGUAL("end", PALAVRA_END);
+                case 'f': return PALAVRA_SE_IGUAL("for", PALAVRA_FOR);
+                case 's': return PALAVRA_SE_IGUAL("set", PALAVRA_SET);
+                case 'a': return PALAVRA_SE_IGUAL("and", PALAVRA_AND);
+                case 'n': return PALAVRA_SE_IGUAL("not", PALAVRA_NOT);
+                case 'd': return PALAVRA_SE_IGUAL("div", PALAVRA_DIV);
+                case 'm': return PALAVRA_SE_IGUAL("mod", PALAVRA_MOD);
+            }
+            return PALAVRA_NENHUMA;
+        case 4:
+            switch (lexema[0]) {
+                case 'r': return PALAVRA_SE_IGUAL("read", PALAVRA_READ);
+                case 'e': return PALAVRA_SE_IGUAL("elif", PALAVRA_ELIF);
+                case 't': return PALAVRA_SE_IGUAL("true", PALAVRA_TRUE);
+            }
+            return PALAVRA_NENHUMA;
+        case 5:
+            switch (lexema[0]) {
+                case 'b': return PALAVRA_SE_IGUAL("begin", PALAVRA_BEGIN);
+                case 'w': return PALAVRA_SE_IGUAL("write", PALAVRA_WRITE);
+                case 'f': return PALAVRA_SE_IGUAL("false", PALAVRA_FALSE);
+            }
+            return PALAVRA_NENHUMA;
+        case 7:
+            switch (lexema[0]) {
+                case 'p': return PALAVRA_SE_IGUAL("program", PALAVRA_PROGRAM);
+                case 'i': return PALAVRA_SE_IGUAL("integer", PALAVRA_INTEGER);
+                case 'b': return PALAVRA_SE_IGUAL("boolean", PALAVRA_BOOLEAN);
+            }
+            return PALAVRA_NENHUMA;
+    }
+    return PALAVRA_NENHUMA;
+}
+
+#undef PALAVRA_SE_IGUAL
+
+#endif
@@ -0,0 +1,193 @@
+#include "perfil_mepa.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memoria.h"
+
+#define MAX_LINHAS_RELATORIO 20
+#define SEM_LACO (-1)
+
+// Uma instrucao executavel com o laco mais interno que a contem
+typedef struct {
+    int laco;
+    int linha;
+    OpcodeMepa opcode;
+    long long contagem;
+} AmostraPerfil;
+
+// Chave agregada (opcode, linha ou rotulo) e seu total, para ordenar o relatorio
+typedef struct {
+    int chave;
+    int linha;          // so para lacos: a linha do for
+    long long contagem;
+} TotalPerfil;
+
+static void *alocar_perfil(size_t tamanho) {
+    void *ptr = calloc(1, tamanho ? tamanho : 1);
+    if (!ptr) memoria_insuficiente();
+    return ptr;
+}
+
+// Um laco e o trecho entre um rotulo e um desvio de volta para ele; cada instrucao fica
+// com o menor trecho que a contem. linhas_lacos recebe a linha do desvio de cada rotulo
+static int *marcar_lacos(const CodigoMepa *codigo, const int *posicoes, int *linhas_lacos) {
+    int n = codigo->num_instrucoes;
+    int *lacos = alocar_perfil((size_t)n * sizeof(int));
+    int *tamanhos = alocar_perfil((size_t)n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        lacos[i] = SEM_LACO;
+        tamanhos[i] = INT_MAX;
+    }
+
+    for (int j = 0; j < n; j++) {
+        const InstrucaoMepa *desvio = &codigo->instrucoes[j];
+        if (desvio->opcode != MEPA_DSVS && desvio->opcode != MEPA_DSVF) continue;
+        if (desvio->operando < 0) continue;
+        int inicio = posicoes[desvio->operando];
+        if (inicio < 0 || inicio > j) continue;
+        linhas_lacos[desvio->operando] = desvio->linha;
+        for (int k = inicio; k <= j; k++) {
+            if (j - inicio < tamanhos[k]) {
+                tamanhos[k] = j - inicio;
+                lacos[k] = desvio->operando;
+            }
+        }
+    }
+
+    free(tamanhos);
+    return lacos;
+}
+
+// As amostras seguem a ordem do ProgramaVM: o NADA nao vira instrucao executavel
+static AmostraPerfil *montar_amostras(const CodigoMepa *codigo, const long long *contagens,
+                                      int *num_amostras, int **linhas_lacos, int *num_rotulos) {
+    int *posicoes = posicoes_rotulos_mepa(codigo, num_rotulos);
+    if (!posicoes) memoria_insuficiente();
+    *linhas_lacos = alocar_perfil((size_t)*num_rotulos * sizeof(int));
+    int *lacos = marcar_lacos(codigo, posicoes, *linhas_lacos);
+    free(posicoes);
+
+    AmostraPerfil *amostras = alocar_perfil((size_t)codigo->num_instrucoes * sizeof(AmostraPerfil));
+    int n = 0;
+    for (int i = 0; i < codigo->num_instrucoes; i++) {
+        const InstrucaoMepa *instrucao = &codigo->instrucoes[i];
+        if (instrucao->opcode == MEPA_NADA) continue;
+        amostras[n].laco = lacos[i];
+        amostras[n].linha = instrucao->linha;
+        amostras[n].opcode = instrucao->opcode;
+        amostras[n].contagem = contagens[n];
+        n++;
+    }
+    free(lacos);
+    *num_amostras = n;
+    return amostras;
+}
+
+static int comparar_totais(const void *a, const void *b) {
+    const TotalPerfil *x = a;
+    const TotalPerfil *y = b;
+    if (x->contagem != y->contagem) return x->contagem < y->contagem ? 1 : -1;
+    return x->chave - y->chave;
+}
+
+// Ordena e imprime os totais nao nulos; limite <= 0 imprime todos
+static void imprimir_totais(FILE *saida, TotalPerfil *totais, int num_totais, int limite,
+                            long long total, int tipo) {
+    qsort(totais, (size_t)num_totais, sizeof(TotalPerfil), comparar_totais);
+    for (int i = 0; i < num_totais && totais[i].contagem > 0 && (limite <= 0 || i < limite); i++) {
+        char nome[32];
+        if (tipo == 0) {
+            snprintf(nome, sizeof(nome), "%s", nome_opcode(totais[i].chave));
+        } else if (tipo == 1) {
+            if (totais[i].chave > 0) snprintf(nome, sizeof(nome), "linha %d", totais[i].chave);
+            else snprintf(nome, sizeof(nome), "linha ?");
+        } else {
+            snprintf(nome, sizeof(nome), "L%d (linha %d)", totais[i].chave, totais[i].linha);
+        }
+        fprintf(saida, "    %-20s %14lld %6.2f%%\n", nome, totais[i].contagem,
+                total ? 100.0 * totais[i].contagem / total : 0.0);
+    }
+}
+
+int escrever_relatorio_perfil(const CodigoMepa *codigo, const long long *contagens, FILE *saida) {
+    int num_amostras, num_rotulos;
+    int *linhas_lacos;
+    AmostraPerfil *amostras = montar_amostras(codigo, contagens, &num_amostras, &linhas_lacos, &num_rotulos);
+
+    int maior_linha = 0;
+    long long total = 0;
+    for (int i = 0; i < num_amostras; i++) {
+        if (amostras[i].linha > maior_linha) maior_linha = amostras[i].linha;
+        total += amostras[i].contagem;
+    }
+
+    TotalPerfil *opcodes = alocar_perfil(NUM_OPCODES_MEPA * sizeof(TotalPerfil));
+    TotalPerfil *linhas = alocar_perfil((size_t)(maior_linha + 1) * sizeof(TotalPerfil));
+    TotalPerfil *lacos = alocar_perfil((size_t)num_rotulos * sizeof(TotalPerfil));
+    for (int o = 0; o < NUM_OPCODES_MEPA; o++) opcodes[o].chave = o;
+    for (int l = 0; l <= maior_linha; l++) linhas[l].chave = l;
+    for (int r = 0; r < num_rotulos; r++) {
+        lacos[r].chave = r;
+        lacos[r].linha = linhas_lacos[r];
+    }
+    for (int i = 0; i < num_amostras; i++) {
+        opcodes[amostras[i].opcode].contagem += amostras[i].contagem;
+        linhas[amostras[i].linha].contagem += amostras[i].contagem;
+        if (amostras[i].laco != SEM_LACO) lacos[amostras[i].laco].contagem += amostras[i].contagem;
+    }
+
+    fprintf(saida, "perfil: %lld instrucoes executadas\n", total);
+    fprintf(saida, "  por opcode:\n");
+    imprimir_totais(saida, opcodes, NUM_OPCODES_MEPA, 0, total, 0);
+    fprintf(saida, "  linhas mais quentes:\n");
+    imprimir_totais(saida, linhas, maior_linha + 1, MAX_LINHAS_RELATORIO, total, 1);
+    fprintf(saida, "  lacos:\n");
+    imprimir_totais(saida, lacos, num_rotulos, 0, total, 2);
+
+    free(opcodes);
+    free(linhas);
+    free(lacos);
+    free(linhas_lacos);
+    free(amostras);
+    return ferror(saida) ? -1 : 0;
+}
+
+static int comparar_pilhas(const void *a, const void *b) {
+    const AmostraPerfil *x = a;
+    const AmostraPerfil *y = b;
+    if (x->laco != y->laco) return x->laco - y->laco;
+    if (x->linha != y->linha) return x->linha - y->linha;
+    return (int)x->opcode - (int)y->opcode;
+}
+
+int escrever_pilhas_perfil(const CodigoMepa *codigo, const long long *contagens,
+                           const char *nome_programa, FILE *saida) {
+    int num_amostras, num_rotulos;
+    int *linhas_lacos;
+    AmostraPerfil *amostras = montar_amostras(codigo, contagens, &num_amostras, &linhas_lacos, &num_rotulos);
+
+    // Instrucoes com o mesmo laco, linha e opcode viram uma unica pilha
+    qsort(amostras, (size_t)num_amostras, sizeof(AmostraPerfil), comparar_pilhas);
+    for (int i = 0; i < num_amostras;) {
+        long long contagem = 0;
+        int j = i;
+        while (j < num_amostras && comparar_pilhas(&amostras[i], &amostras[j]) == 0) {
+            contagem += amostras[j].contagem;
+            j++;
+        }
+        if (contagem > 0) {
+            fprintf(saida, "%s;", nome_programa);
+            if (amostras[i].laco != SEM_LACO) fprintf(saida, "L%d;", amostras[i].laco);
+            if (amostras[i].linha > 0) fprintf(saida, "linha %d;", amostras[i].linha);
+            else fprintf(saida, "linha ?;");
+            fprintf(saida, "%s %lld\n", nome_opcode(amostras[i].opcode), contagem);
+        }
+        i = j;
+    }
+
+    free(linhas_lacos);
+    free(amostras);
+    return ferror(saida) ? -1 : 0;
+}
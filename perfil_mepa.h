@@ -0,0 +1,19 @@
+#ifndef PERFIL_MEPA_H
+#define PERFIL_MEPA_H
+
+#include <stdio.h>
+
+#include "mepa.h"
+
+// Relatorios de uma execucao com ativar_perfil_vm. contagens tem uma posicao por
+// instrucao de codigo que nao e NADA, na mesma ordem (ProgramaVM.contagens)
+
+// Pontos quentes ordenados: por opcode, por linha do fonte e por laco (rotulo do desvio
+// de volta). Retorna 0 ou -1 (erro de escrita)
+int escrever_relatorio_perfil(const CodigoMepa *codigo, const long long *contagens, FILE *saida);
+
+// Pilhas no formato "folded" do flamegraph.pl: programa;laco;linha;opcode contagem
+int escrever_pilhas_perfil(const CodigoMepa *codigo, const long long *contagens,
+                           const char *nome_programa, FILE *saida);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef SERVIDOR_COMPILACAO_H
+#define SERVIDOR_COMPILACAO_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+// Protocolo entre o cliente_compilador e o compiladorparte2 --daemon, por um socket Unix
+// local (SOCK_STREAM), uma conexao por pedido:
+//   pedido:   cabecalho { tamanho:u32 mascara:u32 argc:u32 } argv[0]\0 ... argv[argc - 1]\0
+//             tamanho conta os bytes depois do cabecalho e mascara e o umask do cliente.
+//             O primeiro byte leva por SCM_RIGHTS a entrada, a saida e os erros padrao do
+//             cliente e o seu diretorio atual, nessa ordem
+//   resposta: status:i32, o codigo de saida que o main() teria no cliente
+// A saida e os diagnosticos sao escritos direto nos descritores do cliente. Os inteiros
+// vao na ordem de bytes da maquina: cliente e servidor rodam no mesmo computador
+#define DESCRITORES_PEDIDO 4
+#define MAX_TAMANHO_PEDIDO (1 << 20)
+
+// Caminho do socket: a variavel de ambiente ou, sem ela, o padrao. O padrao fica em
+// $XDG_RUNTIME_DIR, que so o usuario acessa; sem ele, num diretorio do usuario em /tmp com
+// modo 0700, conferido a cada uso: em /tmp outro usuario poderia criar o caminho antes.
+// Os dois lados ainda conferem o uid do outro com SO_PEERCRED, entao nem um caminho
+// escolhido na variavel faz o cliente entregar os descritores a outro usuario
+#define VARIAVEL_SOCKET "MEPA_SERVIDOR"
+#define NOME_SOCKET_PADRAO "compiladorparte2.sock"
+#define FORMATO_DIRETORIO_PADRAO "/tmp/compiladorparte2-%u"
+
+// Sem servidor, o cliente executa o compilador: esta variavel ou o compiladorparte2 do
+// diretorio do cliente
+#define VARIAVEL_COMPILADOR "MEPA_COMPILADOR"
+
+typedef struct {
+    uint32_t tamanho;
+    uint32_t mascara;
+    uint32_t argc;
+} CabecalhoPedido;
+
+// Monta o caminho padrao do socket em destino. criar (o servidor) cria o diretorio em /tmp
+// se preciso. Retorna 0 ou -1 (errno definido; EPERM se o diretorio nao e so do usuario)
+static inline int caminho_socket_padrao(char *destino, size_t tamanho, int criar) {
+    const char *runtime = getenv("XDG_RUNTIME_DIR");
+    int n;
+    if (runtime && runtime[0] == '/') {
+        n = snprintf(destino, tamanho, "%s/%s", runtime, NOME_SOCKET_PADRAO);
+    } else {
+        char diretorio[64];
+        snprintf(diretorio, sizeof(diretorio), FORMATO_DIRETORIO_PADRAO, (unsigned)getuid());
+        if (criar && mkdir(diretorio, 0700) != 0 && errno != EEXIST) return -1;
+        // lstat: um link simbolico com esse nome nao vale
+        struct stat info;
+        if (lstat(diretorio, &info) != 0) return -1;
+        if (!S_ISDIR(info.st_mode) || info.st_uid != getuid() || (info.st_mode & 077) != 0) {
+            errno = EPERM;
+            return -1;
+        }
+        n = snprintf(destino, tamanho, "%s/%s", diretorio, NOME_SOCKET_PADRAO);
+    }
+    if (n < 0 || (size_t)n >= tamanho) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return 0;
+}
+
+// 1 se o processo do outro lado da conexao e do mesmo usuario
+static inline int mesmo_usuario(int conexao) {
+    struct ucred credenciais;
+    socklen_t tamanho = sizeof(credenciais);
+    return getsockopt(conexao, SOL_SOCKET, SO_PEERCRED, &credenciais, &tamanho) == 0 &&
+           tamanho == sizeof(credenciais) && credenciais.uid == getuid();
+}
+
+#endif
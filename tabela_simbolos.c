@@ -0,0 +1,193 @@
+#include "tabela_simbolos.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "memoria.h"
+
+#define SLOT_VAZIO (-1)
+#define TAMANHO_INICIAL_SLOTS 64
+
+static void *realocar(void *ptr, size_t tamanho) {
+    void *novo = realloc(ptr, tamanho);
+    if (!novo) memoria_insuficiente();
+    return novo;
+}
+
+static int *novos_slots(int tamanho) {
+    int *slots = realocar(NULL, (size_t)tamanho * sizeof(int));
+    for (int i = 0; i < tamanho; i++) slots[i] = SLOT_VAZIO;
+    return slots;
+}
+
+// FNV-1a
+static unsigned hash_texto(const char *texto, size_t tamanho) {
+    unsigned h = 2166136261u;
+    for (size_t i = 0; i < tamanho; i++) {
+        h ^= (unsigned char)texto[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Espalha ids consecutivos pela tabela (hash multiplicativo de Fibonacci)
+static unsigned hash_id(int id) {
+    return (unsigned)id * 2654435769u;
+}
+
+void iniciar_pool_identificadores(PoolIdentificadores *pool) {
+    memset(pool, 0, sizeof(*pool));
+    pool->tamanho_slots = TAMANHO_INICIAL_SLOTS;
+    pool->slots = novos_slots(pool->tamanho_slots);
+}
+
+void liberar_pool_identificadores(PoolIdentificadores *pool) {
+    free(pool->caracteres);
+    free(pool->deslocamentos);
+    free(pool->hashes);
+    free(pool->slots);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void limpar_pool_identificadores(PoolIdentificadores *pool) {
+    for (int i = 0; i < pool->tamanho_slots; i++) pool->slots[i] = SLOT_VAZIO;
+    pool->num_ids = 0;
+    pool->tamanho_caracteres = 0;
+    memset(&pool->contadores, 0, sizeof(pool->contadores));
+}
+
+static void crescer_slots_pool(PoolIdentificadores *pool) {
+    int tamanho = pool->tamanho_slots * 2;
+    int *slots = novos_slots(tamanho);
+    for (int id = 0; id < pool->num_ids; id++) {
+        unsigned i = pool->hashes[id] & (unsigned)(tamanho - 1);
+        while (slots[i] != SLOT_VAZIO) i = (i + 1) & (unsigned)(tamanho - 1);
+        slots[i] = id;
+    }
+    free(pool->slots);
+    pool->slots = slots;
+    pool->tamanho_slots = tamanho;
+}
+
+int internar_identificador(PoolIdentificadores *pool, const char *texto, size_t tamanho) {
+    unsigned h = hash_texto(texto, tamanho);
+    unsigned mascara = (unsigned)(pool->tamanho_slots - 1);
+    unsigned i = h & mascara;
+    pool->contadores.consultas++;
+
+    while (pool->slots[i] != SLOT_VAZIO) {
+        int id = pool->slots[i];
+        pool->contadores.sondagens++;
+        if (pool->hashes[id] == h) {
+            const char *existente = pool->caracteres + pool->deslocamentos[id];
+            if (strncmp(existente, texto, tamanho) == 0 && existente[tamanho] == '\0') {
+                return id;
+            }
+        }
+        pool->contadores.colisoes++;
+        i = (i + 1) & mascara;
+    }
+    pool->contadores.sondagens++;
+
+    // As capacidades so mudam depois do realloc: sem memoria o pool continua valido
+    if (pool->num_ids == pool->capacidade_ids) {
+        int capacidade = pool->capacidade_ids ? pool->capacidade_ids * 2 : 64;
+        pool->deslocamentos = realocar(pool->deslocamentos, (size_t)capacidade * sizeof(size_t));
+        pool->hashes = realocar(pool->hashes, (size_t)capacidade * sizeof(unsigned));
+        pool->capacidade_ids = capacidade;
+    }
+    while (pool->tamanho_caracteres + tamanho + 1 > pool->capacidade_caracteres) {
+        size_t capacidade = pool->capacidade_caracteres ? pool->capacidade_caracteres * 2 : 1024;
+        pool->caracteres = realocar(pool->caracteres, capacidade);
+        pool->capacidade_caracteres = capacidade;
+    }
+
+    int id = pool->num_ids++;
+    pool->deslocamentos[id] = pool->tamanho_caracteres;
+    pool->hashes[id] = h;
+    memcpy(pool->caracteres + pool->tamanho_caracteres, texto, tamanho);
+    pool->caracteres[pool->tamanho_caracteres + tamanho] = '\0';
+    pool->tamanho_caracteres += tamanho + 1;
+    pool->slots[i] = id;
+
+    // Fator de carga maximo de 1/2
+    if (pool->num_ids * 2 > pool->tamanho_slots) crescer_slots_pool(pool);
+    return id;
+}
+
+const char *texto_identificador(const PoolIdentificadores *pool, int id) {
+    return pool->caracteres + pool->deslocamentos[id];
+}
+
+void iniciar_tabela_simbolos(TabelaSimbolos *tabela) {
+    memset(tabela, 0, sizeof(*tabela));
+    tabela->tamanho_slots = TAMANHO_INICIAL_SLOTS;
+    tabela->slots = novos_slots(tabela->tamanho_slots);
+}
+
+void liberar_tabela_simbolos(TabelaSimbolos *tabela) {
+    free(tabela->simbolos);
+    free(tabela->slots);
+    memset(tabela, 0, sizeof(*tabela));
+}
+
+void limpar_tabela_simbolos(TabelaSimbolos *tabela) {
+    for (int i = 0; i < tabela->tamanho_slots; i++) tabela->slots[i] = SLOT_VAZIO;
+    tabela->num_simbolos = 0;
+    memset(&tabela->contadores, 0, sizeof(tabela->contadores));
+}
+
+SimboloTabela *procurar_simbolo(TabelaSimbolos *tabela, int id) {
+    unsigned mascara = (unsigned)(tabela->tamanho_slots - 1);
+    unsigned i = hash_id(id) & mascara;
+    tabela->contadores.consultas++;
+    while (tabela->slots[i] != SLOT_VAZIO) {
+        SimboloTabela *simbolo = &tabela->simbolos[tabela->slots[i]];
+        tabela->contadores.sondagens++;
+        if (simbolo->id == id) return simbolo;
+        tabela->contadores.colisoes++;
+        i = (i + 1) & mascara;
+    }
+    tabela->contadores.sondagens++;
+    return NULL;
+}
+
+static void crescer_slots_tabela(TabelaSimbolos *tabela) {
+    int tamanho = tabela->tamanho_slots * 2;
+    int *slots = novos_slots(tamanho);
+    for (int s = 0; s < tabela->num_simbolos; s++) {
+        unsigned i = hash_id(tabela->simbolos[s].id) & (unsigned)(tamanho - 1);
+        while (slots[i] != SLOT_VAZIO) i = (i + 1) & (unsigned)(tamanho - 1);
+        slots[i] = s;
+    }
+    free(tabela->slots);
+    tabela->slots = slots;
+    tabela->tamanho_slots = tamanho;
+}
+
+SimboloTabela *adicionar_simbolo(TabelaSimbolos *tabela, int id, int endereco) {
+    unsigned mascara = (unsigned)(tabela->tamanho_slots - 1);
+    unsigned i = hash_id(id) & mascara;
+    tabela->contadores.consultas++;
+    while (tabela->slots[i] != SLOT_VAZIO) {
+        tabela->contadores.sondagens++;
+        if (tabela->simbolos[tabela->slots[i]].id == id) return NULL;
+        tabela->contadores.colisoes++;
+        i = (i + 1) & mascara;
+    }
+    tabela->contadores.sondagens++;
+
+    if (tabela->num_simbolos == tabela->capacidade) {
+        int capacidade = tabela->capacidade ? tabela->capacidade * 2 : 64;
+        tabela->simbolos = realocar(tabela->simbolos, (size_t)capacidade * sizeof(SimboloTabela));
+        tabela->capacidade = capacidade;
+    }
+
+    int indice = tabela->num_simbolos++;
+    tabela->simbolos[indice].id = id;
+    tabela->simbolos[indice].endereco = endereco;
+    tabela->slots[i] = indice;
+
+    if (tabela->num_simbolos * 2 > tabela->tamanho_slots) crescer_slots_tabela(tabela);
+    return &tabela->simbolos[indice];
+}
@@ -0,0 +1,58 @@
+#ifndef TABELA_SIMBOLOS_H
+#define TABELA_SIMBOLOS_H
+
+#include <stddef.h>
+
+// Acessos a uma tabela hash: sondagens e o total de slots visitados, colisoes os
+// slots ocupados por outra chave no caminho. Zerados junto com a tabela
+typedef struct {
+    long consultas;
+    long sondagens;
+    long colisoes;
+} ContadoresHash;
+
+// Pool de identificadores internados: cada texto distinto recebe um id inteiro
+typedef struct {
+    char *caracteres;
+    size_t tamanho_caracteres;
+    size_t capacidade_caracteres;
+    size_t *deslocamentos;
+    unsigned *hashes;
+    int num_ids;
+    int capacidade_ids;
+    int *slots;
+    int tamanho_slots;
+    ContadoresHash contadores;
+} PoolIdentificadores;
+
+typedef struct {
+    int id;
+    int endereco;
+} SimboloTabela;
+
+// Tabela de simbolos com enderecamento aberto indexada pelo id internado
+typedef struct {
+    SimboloTabela *simbolos;
+    int num_simbolos;
+    int capacidade;
+    int *slots;
+    int tamanho_slots;
+    ContadoresHash contadores;
+} TabelaSimbolos;
+
+void iniciar_pool_identificadores(PoolIdentificadores *pool);
+void liberar_pool_identificadores(PoolIdentificadores *pool);
+// Esvazia o pool mantendo a memoria ja alocada para o proximo arquivo
+void limpar_pool_identificadores(PoolIdentificadores *pool);
+int internar_identificador(PoolIdentificadores *pool, const char *texto, size_t tamanho);
+// O ponteiro vale ate o proximo internar_identificador
+const char *texto_identificador(const PoolIdentificadores *pool, int id);
+
+void iniciar_tabela_simbolos(TabelaSimbolos *tabela);
+void liberar_tabela_simbolos(TabelaSimbolos *tabela);
+void limpar_tabela_simbolos(TabelaSimbolos *tabela);
+SimboloTabela *procurar_simbolo(TabelaSimbolos *tabela, int id);
+// Retorna NULL se o id ja estiver na tabela
+SimboloTabela *adicionar_simbolo(TabelaSimbolos *tabela, int id, int endereco);
+
+#endif
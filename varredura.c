@@ -0,0 +1,125 @@
+#include "varredura.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && !defined(VARREDURA_ESCALAR)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VARREDURA_SIMD 1
+typedef __m256i Vetor;
+#define LARGURA_VETOR 32
+#define carregar(p) _mm256_loadu_si256((const __m256i *)(p))
+#define repetir(c) _mm256_set1_epi8((char)(c))
+#define igual(a, b) _mm256_cmpeq_epi8(a, b)
+#define maior(a, b) _mm256_cmpgt_epi8(a, b)
+#define e_vetor(a, b) _mm256_and_si256(a, b)
+#define ou_vetor(a, b) _mm256_or_si256(a, b)
+#define mascara(v) ((uint32_t)_mm256_movemask_epi8(v))
+#define MASCARA_CHEIA 0xFFFFFFFFu
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VARREDURA_SIMD 1
+typedef __m128i Vetor;
+#define LARGURA_VETOR 16
+#define carregar(p) _mm_loadu_si128((const __m128i *)(p))
+#define repetir(c) _mm_set1_epi8((char)(c))
+#define igual(a, b) _mm_cmpeq_epi8(a, b)
+#define maior(a, b) _mm_cmpgt_epi8(a, b)
+#define e_vetor(a, b) _mm_and_si128(a, b)
+#define ou_vetor(a, b) _mm_or_si128(a, b)
+#define mascara(v) ((uint32_t)_mm_movemask_epi8(v))
+#define MASCARA_CHEIA 0xFFFFu
+#endif
+#endif
+
+// ' ', '\t', '\n', '\v', '\f', '\r'
+static inline int eh_espaco(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+const char *pular_espacos_escalar(const char *p, const char *fim, int *linhas) {
+    while (p < fim && eh_espaco((unsigned char)*p)) {
+        if (*p == '\n') (*linhas)++;
+        p++;
+    }
+    return p;
+}
+
+const char *buscar_fim_comentario_escalar(const char *p, const char *fim, int *linhas) {
+    while (p < fim) {
+        if (*p == '-' && p + 1 < fim && p[1] == '}') return p + 2;
+        if (*p == '\n') (*linhas)++;
+        p++;
+    }
+    return fim;
+}
+
+const char *buscar_nova_linha(const char *p, const char *fim) {
+    // memchr da libc ja compara por vetores
+    const char *nova_linha = memchr(p, '\n', (size_t)(fim - p));
+    return nova_linha ? nova_linha : fim;
+}
+
+#ifdef VARREDURA_SIMD
+
+// Bits dos bytes menores que a posicao n (n < LARGURA_VETOR)
+static inline uint32_t bits_antes(int n) {
+    return (1u << n) - 1u;
+}
+
+const char *pular_espacos(const char *p, const char *fim, int *linhas) {
+    const Vetor espaco = repetir(' ');
+    const Vetor nova_linha = repetir('\n');
+    const Vetor antes_tab = repetir('\t' - 1);
+    const Vetor depois_cr = repetir('\r' + 1);
+
+    while (fim - p >= LARGURA_VETOR) {
+        Vetor bloco = carregar(p);
+        // Comparacao com sinal: bytes >= 0x80 ficam fora do intervalo \t..\r
+        Vetor controle = e_vetor(maior(bloco, antes_tab), maior(depois_cr, bloco));
+        uint32_t espacos = mascara(ou_vetor(igual(bloco, espaco), controle));
+        uint32_t novas_linhas = mascara(igual(bloco, nova_linha));
+        if (espacos != MASCARA_CHEIA) {
+            int primeiro = __builtin_ctz(~espacos);
+            *linhas += __builtin_popcount(novas_linhas & bits_antes(primeiro));
+            return p + primeiro;
+        }
+        *linhas += __builtin_popcount(novas_linhas);
+        p += LARGURA_VETOR;
+    }
+    return pular_espacos_escalar(p, fim, linhas);
+}
+
+const char *buscar_fim_comentario(const char *p, const char *fim, int *linhas) {
+    const Vetor hifen = repetir('-');
+    const Vetor chave = repetir('}');
+    const Vetor nova_linha = repetir('\n');
+
+    // O segundo carregamento le um byte adiante para achar "-}" que cruza o bloco
+    while (fim - p > LARGURA_VETOR) {
+        Vetor bloco = carregar(p);
+        uint32_t fechamentos = mascara(e_vetor(igual(bloco, hifen), igual(carregar(p + 1), chave)));
+        uint32_t novas_linhas = mascara(igual(bloco, nova_linha));
+        if (fechamentos) {
+            int posicao = __builtin_ctz(fechamentos);
+            *linhas += __builtin_popcount(novas_linhas & bits_antes(posicao));
+            return p + posicao + 2;
+        }
+        *linhas += __builtin_popcount(novas_linhas);
+        p += LARGURA_VETOR;
+    }
+    return buscar_fim_comentario_escalar(p, fim, linhas);
+}
+
+#else
+
+const char *pular_espacos(const char *p, const char *fim, int *linhas) {
+    return pular_espacos_escalar(p, fim, linhas);
+}
+
+const char *buscar_fim_comentario(const char *p, const char *fim, int *linhas) {
+    return buscar_fim_comentario_escalar(p, fim, linhas);
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef VARREDURA_H
+#define VARREDURA_H
+
+// Primitivas do analisador lexico para pular espacos e comentarios em blocos de
+// 32 (AVX2) ou 16 (SSE2) bytes. Sem SIMD, ou com -DVARREDURA_ESCALAR, usam as
+// versoes byte a byte. Todas somam em *linhas os '\n' do trecho pulado
+
+// Primeiro caractere em [p, fim) que nao e espaco (isspace no locale "C"), ou fim
+const char *pular_espacos(const char *p, const char *fim, int *linhas);
+
+// Primeiro caractere depois do "-}" que fecha um comentario {- -}, ou fim
+const char *buscar_fim_comentario(const char *p, const char *fim, int *linhas);
+
+// Primeiro '\n' em [p, fim), ou fim
+const char *buscar_nova_linha(const char *p, const char *fim);
+
+// Versoes byte a byte: usadas no final do buffer e como referencia nos testes
+const char *pular_espacos_escalar(const char *p, const char *fim, int *linhas);
+const char *buscar_fim_comentario_escalar(const char *p, const char *fim, int *linhas);
+
+#endif
@@ -0,0 +1,391 @@
+#include "vivacidade.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cada comando ocupa um ponto p do programa, em ordem; o for ocupa tres (atribuicao do
+// inicio, teste e incremento) em volta do corpo. As leituras do ponto p ficam na posicao
+// 2p e a escrita em 2p + 1, entao em "set x to y" a faixa de y pode acabar onde a de x comeca
+typedef struct {
+    Arena *arena;
+    int num_variaveis;
+    int palavras;               // palavras de 64 bits por conjunto de variaveis
+    int *inicio;                // faixa [inicio, fim] de posicoes de cada variavel;
+    int *fim;                   // inicio -1: nunca lida nem escrita
+    int *carimbos;              // anotar: variavel ja vista na coleta de numero carimbo
+    int carimbo;
+    int proximo_ponto;          // percurso final, de tras para frente: pontos ainda nao visitados
+    EstatisticasVivacidade *estatisticas;
+} EstadoVivacidade;
+
+static uint64_t *novo_conjunto(EstadoVivacidade *estado) {
+    return alocar_arena(estado->arena, (size_t)estado->palavras * sizeof(uint64_t) + 1);
+}
+
+static int contem(const uint64_t *conjunto, int variavel) {
+    return (conjunto[variavel >> 6] >> (variavel & 63)) & 1;
+}
+
+static void marcar(uint64_t *conjunto, int variavel, int viva) {
+    uint64_t bit = (uint64_t)1 << (variavel & 63);
+    conjunto[variavel >> 6] = viva ? conjunto[variavel >> 6] | bit : conjunto[variavel >> 6] & ~bit;
+}
+
+// Posicoes negativas vem das passadas ate o ponto fixo, que nao marcam faixas
+static void estender(EstadoVivacidade *estado, int variavel, int posicao) {
+    if (posicao < 0) return;
+    if (estado->inicio[variavel] < 0) {
+        estado->inicio[variavel] = estado->fim[variavel] = posicao;
+    } else if (posicao < estado->inicio[variavel]) {
+        estado->inicio[variavel] = posicao;
+    } else if (posicao > estado->fim[variavel]) {
+        estado->fim[variavel] = posicao;
+    }
+}
+
+static void usar(EstadoVivacidade *estado, uint64_t *vivas, const NoAst *no, int posicao) {
+    if (!no) return;
+    if (no->tipo == NO_VARIAVEL) {
+        marcar(vivas, no->endereco, 1);
+        estender(estado, no->endereco, posicao);
+    } else if (no->tipo == NO_NAO) {
+        usar(estado, vivas, no->unario.operando, posicao);
+    } else if (no_binario(no->tipo)) {
+        usar(estado, vivas, no->binario.esquerda, posicao);
+        usar(estado, vivas, no->binario.direita, posicao);
+    }
+}
+
+static void definir(EstadoVivacidade *estado, uint64_t *vivas, int variavel, int posicao) {
+    marcar(vivas, variavel, 0);
+    estender(estado, variavel, posicao);
+}
+
+// Ponto do proximo comando no percurso final; -1 nas passadas do ponto fixo
+static int ponto(EstadoVivacidade *estado, int final) {
+    return final ? --estado->proximo_ponto : -1;
+}
+
+static void analisar_bloco(EstadoVivacidade *estado, NoAst **primeiro, uint64_t *vivas, int final);
+
+// Variaveis que o laco le ou escreve (contador, limite e corpo), sem repeticao: so elas
+// mudam de estado dentro dele. Com itens NULL so conta
+typedef struct {
+    int *itens;
+    int tamanho;
+} Variaveis;
+
+static void anotar(EstadoVivacidade *estado, Variaveis *variaveis, int variavel) {
+    if (estado->carimbos[variavel] == estado->carimbo) return;
+    estado->carimbos[variavel] = estado->carimbo;
+    if (variaveis->itens) variaveis->itens[variaveis->tamanho] = variavel;
+    variaveis->tamanho++;
+}
+
+static void anotar_expressao(EstadoVivacidade *estado, Variaveis *variaveis, const NoAst *no) {
+    if (!no) return;
+    if (no->tipo == NO_VARIAVEL) {
+        anotar(estado, variaveis, no->endereco);
+    } else if (no->tipo == NO_NAO) {
+        anotar_expressao(estado, variaveis, no->unario.operando);
+    } else if (no_binario(no->tipo)) {
+        anotar_expressao(estado, variaveis, no->binario.esquerda);
+        anotar_expressao(estado, variaveis, no->binario.direita);
+    }
+}
+
+static void anotar_bloco(EstadoVivacidade *estado, Variaveis *variaveis, const NoAst *comandos) {
+    for (const NoAst *no = comandos; no; no = no->proximo) {
+        switch (no->tipo) {
+            case NO_LEIA:
+                anotar(estado, variaveis, no->endereco);
+                break;
+            case NO_ESCREVA:
+                anotar_expressao(estado, variaveis, no->escrita.valor);
+                break;
+            case NO_ATRIBUICAO:
+                anotar(estado, variaveis, no->atribuicao.endereco);
+                anotar_expressao(estado, variaveis, no->atribuicao.valor);
+                break;
+            case NO_PARA:
+                anotar(estado, variaveis, no->para.contador);
+                anotar_expressao(estado, variaveis, no->para.inicio);
+                anotar_expressao(estado, variaveis, no->para.limite);
+                anotar_bloco(estado, variaveis, no->para.corpo);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void anotar_laco(EstadoVivacidade *estado, Variaveis *variaveis, const NoAst *laco) {
+    estado->carimbo++;
+    anotar(estado, variaveis, laco->para.contador);
+    anotar_expressao(estado, variaveis, laco->para.limite);
+    anotar_bloco(estado, variaveis, laco->para.corpo);
+}
+
+// vivas entra com o que vive depois do laco e sai com o que vive antes dele
+static void analisar_para(EstadoVivacidade *estado, NoAst *laco, uint64_t *vivas, int final) {
+    int contador = laco->para.contador;
+    Variaveis locais = { NULL, 0 };
+    anotar_laco(estado, &locais, laco);
+    locais.itens = alocar_arena(estado->arena, (size_t)locais.tamanho * sizeof(int) + 1);
+    locais.tamanho = 0;
+    anotar_laco(estado, &locais, laco);
+
+    // Na cabeca (antes do teste) vive o que vive depois do laco, o que o teste le e o que o
+    // corpo le antes de escrever; o fim do corpo, depois do incremento, volta para a cabeca.
+    // vivas guarda a cabeca durante a iteracao; as variaveis de fora do laco nao mudam
+    unsigned char *cabeca = alocar_arena(estado->arena, (size_t)locais.tamanho + 1);
+    marcar(vivas, contador, 1);
+    usar(estado, vivas, laco->para.limite, -1);
+    for (int k = 0; k < locais.tamanho; k++) cabeca[k] = (unsigned char)contem(vivas, locais.itens[k]);
+    int mudou;
+    do {
+        analisar_bloco(estado, &laco->para.corpo, vivas, 0);
+        mudou = 0;
+        for (int k = 0; k < locais.tamanho; k++) {
+            if (!cabeca[k] && contem(vivas, locais.itens[k])) {
+                cabeca[k] = 1;
+                mudou = 1;
+            }
+            marcar(vivas, locais.itens[k], cabeca[k]);
+        }
+    } while (mudou);
+
+    int incremento = ponto(estado, final);
+    estender(estado, contador, 2 * incremento);
+    estender(estado, contador, 2 * incremento + 1);
+    if (final) {
+        analisar_bloco(estado, &laco->para.corpo, vivas, 1);
+        for (int k = 0; k < locais.tamanho; k++) marcar(vivas, locais.itens[k], cabeca[k]);
+    }
+    int teste = ponto(estado, final);
+    usar(estado, vivas, laco->para.limite, 2 * teste);
+    estender(estado, contador, 2 * teste);
+    // O que vive na cabeca passa pela volta: fica vivo no laco inteiro
+    for (int k = 0; k < locais.tamanho && final; k++) {
+        if (!cabeca[k]) continue;
+        estender(estado, locais.itens[k], 2 * teste);
+        estender(estado, locais.itens[k], 2 * incremento + 1);
+    }
+
+    int atribuicao = ponto(estado, final);
+    definir(estado, vivas, contador, 2 * atribuicao + 1);
+    usar(estado, vivas, laco->para.inicio, 2 * atribuicao);
+}
+
+// Retorna 1 se o comando deve sair do bloco
+static int analisar_comando(EstadoVivacidade *estado, NoAst *no, uint64_t *vivas, int final) {
+    int p;
+    switch (no->tipo) {
+        case NO_LEIA:
+            // A leitura consome a entrada e pode falhar: fica mesmo com o valor morto
+            p = ponto(estado, final);
+            definir(estado, vivas, no->endereco, 2 * p + 1);
+            return 0;
+        case NO_ESCREVA:
+            p = ponto(estado, final);
+            usar(estado, vivas, no->escrita.valor, 2 * p);
+            return 0;
+        case NO_ATRIBUICAO:
+            p = ponto(estado, final);
+            if (!contem(vivas, no->atribuicao.endereco) && !expressao_pode_falhar(no->atribuicao.valor)) {
+                if (final) estado->estatisticas->armazenamentos_removidos++;
+                return 1;
+            }
+            definir(estado, vivas, no->atribuicao.endereco, 2 * p + 1);
+            usar(estado, vivas, no->atribuicao.valor, 2 * p);
+            return 0;
+        case NO_PARA:
+            analisar_para(estado, no, vivas, final);
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+// Percorre o bloco de tras para frente; vivas entra com o que vive depois dele e sai com o
+// que vive antes. Os sets mortos so saem do bloco no percurso final
+static void analisar_bloco(EstadoVivacidade *estado, NoAst **primeiro, uint64_t *vivas, int final) {
+    int n = 0;
+    for (NoAst *no = *primeiro; no; no = no->proximo) n++;
+    if (n == 0) return;
+    NoAst **comandos = alocar_arena(estado->arena, (size_t)n * sizeof(NoAst *));
+    n = 0;
+    for (NoAst *no = *primeiro; no; no = no->proximo) comandos[n++] = no;
+
+    for (int i = n - 1; i >= 0; i--) {
+        if (analisar_comando(estado, comandos[i], vivas, final) && final) comandos[i] = NULL;
+    }
+
+    if (final) {
+        NoAst **ligacao = primeiro;
+        for (int i = 0; i < n; i++) {
+            if (!comandos[i]) continue;
+            *ligacao = comandos[i];
+            ligacao = &comandos[i]->proximo;
+        }
+        *ligacao = NULL;
+    }
+}
+
+static int contar_pontos(const NoAst *comandos) {
+    int pontos = 0;
+    for (const NoAst *no = comandos; no; no = no->proximo) {
+        pontos += no->tipo == NO_PARA ? 3 + contar_pontos(no->para.corpo) : 1;
+    }
+    return pontos;
+}
+
+// Heap de minimo de pares (chave, valor)
+typedef struct {
+    int chave;
+    int valor;
+} Par;
+
+typedef struct {
+    Par *itens;
+    int tamanho;
+} Heap;
+
+static void inserir_heap(Heap *heap, int chave, int valor) {
+    int i = heap->tamanho++;
+    while (i > 0 && heap->itens[(i - 1) / 2].chave > chave) {
+        heap->itens[i] = heap->itens[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->itens[i] = (Par){ chave, valor };
+}
+
+static Par retirar_heap(Heap *heap) {
+    Par topo = heap->itens[0];
+    Par ultimo = heap->itens[--heap->tamanho];
+    int i = 0;
+    for (;;) {
+        int filho = 2 * i + 1;
+        if (filho >= heap->tamanho) break;
+        if (filho + 1 < heap->tamanho && heap->itens[filho + 1].chave < heap->itens[filho].chave) filho++;
+        if (heap->itens[filho].chave >= ultimo.chave) break;
+        heap->itens[i] = heap->itens[filho];
+        i = filho;
+    }
+    heap->itens[i] = ultimo;
+    return topo;
+}
+
+typedef struct {
+    int inicio;
+    int fim;
+    int variavel;
+} Faixa;
+
+static int comparar_faixas(const void *a, const void *b) {
+    const Faixa *x = a;
+    const Faixa *y = b;
+    if (x->inicio != y->inicio) return x->inicio < y->inicio ? -1 : 1;
+    return x->variavel - y->variavel;
+}
+
+// Varredura linear pelas faixas em ordem de inicio: cada uma pega a menor posicao livre, e
+// uma posicao se libera quando a faixa que a ocupa termina antes do inicio da seguinte
+static int atribuir_posicoes(EstadoVivacidade *estado, int *enderecos) {
+    Faixa *faixas = alocar_arena(estado->arena, (size_t)estado->num_variaveis * sizeof(Faixa) + 1);
+    int num_faixas = 0;
+    for (int v = 0; v < estado->num_variaveis; v++) {
+        enderecos[v] = -1;
+        if (estado->inicio[v] >= 0) faixas[num_faixas++] = (Faixa){ estado->inicio[v], estado->fim[v], v };
+    }
+    qsort(faixas, (size_t)num_faixas, sizeof(Faixa), comparar_faixas);
+
+    Heap ocupadas = { alocar_arena(estado->arena, (size_t)num_faixas * sizeof(Par) + 1), 0 };  // (fim, posicao)
+    Heap livres = { alocar_arena(estado->arena, (size_t)num_faixas * sizeof(Par) + 1), 0 };    // (posicao, -)
+    int num_posicoes = 0;
+    for (int i = 0; i < num_faixas; i++) {
+        while (ocupadas.tamanho > 0 && ocupadas.itens[0].chave < faixas[i].inicio) {
+            inserir_heap(&livres, retirar_heap(&ocupadas).valor, 0);
+        }
+        int posicao = livres.tamanho > 0 ? retirar_heap(&livres).chave : num_posicoes++;
+        inserir_heap(&ocupadas, faixas[i].fim, posicao);
+        enderecos[faixas[i].variavel] = posicao;
+    }
+    return num_posicoes;
+}
+
+static void renumerar_expressao(NoAst *no, const int *enderecos) {
+    if (!no) return;
+    if (no->tipo == NO_VARIAVEL) {
+        no->endereco = enderecos[no->endereco];
+    } else if (no->tipo == NO_NAO) {
+        renumerar_expressao(no->unario.operando, enderecos);
+    } else if (no_binario(no->tipo)) {
+        renumerar_expressao(no->binario.esquerda, enderecos);
+        renumerar_expressao(no->binario.direita, enderecos);
+    }
+}
+
+static void renumerar_bloco(NoAst *comandos, const int *enderecos) {
+    for (NoAst *no = comandos; no; no = no->proximo) {
+        switch (no->tipo) {
+            case NO_LEIA:
+                no->endereco = enderecos[no->endereco];
+                break;
+            case NO_ESCREVA:
+                renumerar_expressao(no->escrita.valor, enderecos);
+                break;
+            case NO_ATRIBUICAO:
+                no->atribuicao.endereco = enderecos[no->atribuicao.endereco];
+                renumerar_expressao(no->atribuicao.valor, enderecos);
+                break;
+            case NO_PARA:
+                no->para.contador = enderecos[no->para.contador];
+                renumerar_expressao(no->para.inicio, enderecos);
+                renumerar_expressao(no->para.limite, enderecos);
+                renumerar_bloco(no->para.corpo, enderecos);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+int *compactar_variaveis(ProgramaAst *programa, Arena *arena, EstatisticasVivacidade *estatisticas) {
+    memset(estatisticas, 0, sizeof(*estatisticas));
+    EstadoVivacidade estado;
+    estado.arena = arena;
+    estado.num_variaveis = programa->num_variaveis;
+    estado.palavras = (programa->num_variaveis + 63) / 64;
+    estado.inicio = alocar_arena(arena, (size_t)programa->num_variaveis * sizeof(int) + 1);
+    estado.fim = alocar_arena(arena, (size_t)programa->num_variaveis * sizeof(int) + 1);
+    estado.carimbos = alocar_arena(arena, (size_t)programa->num_variaveis * sizeof(int) + 1);
+    estado.carimbo = 0;
+    for (int v = 0; v < programa->num_variaveis; v++) estado.inicio[v] = -1;
+    estado.proximo_ponto = contar_pontos(programa->comandos) + 1;
+    estado.estatisticas = estatisticas;
+
+    // Nada e lido depois do fim do programa
+    uint64_t *vivas = novo_conjunto(&estado);
+    analisar_bloco(&estado, &programa->comandos, vivas, 1);
+
+    // Vivas no comeco: lidas antes de qualquer escrita, valem o zero do AMEM
+    for (int i = 0; i < estado.palavras; i++) {
+        for (uint64_t bits = vivas[i]; bits; bits &= bits - 1) {
+            estender(&estado, i * 64 + __builtin_ctzll(bits), 0);
+        }
+    }
+
+    int *enderecos = alocar_arena(arena, (size_t)programa->num_variaveis * sizeof(int) + 1);
+    int num_posicoes = atribuir_posicoes(&estado, enderecos);
+    renumerar_bloco(programa->comandos, enderecos);
+
+    estatisticas->posicoes_antes = programa->num_variaveis;
+    estatisticas->posicoes_depois = num_posicoes;
+    for (int v = 0; v < programa->num_variaveis; v++) {
+        if (enderecos[v] < 0) estatisticas->variaveis_removidas++;
+    }
+    programa->num_variaveis = num_posicoes;
+    return enderecos;
+}
@@ -0,0 +1,23 @@
+#ifndef VIVACIDADE_H
+#define VIVACIDADE_H
+
+#include "arena.h"
+#include "ast.h"
+
+// Contadores da analise de vivacidade
+typedef struct {
+    int armazenamentos_removidos;   // sets cujo valor nunca e lido
+    int variaveis_removidas;        // nunca lidas nem escritas depois da remocao
+    int posicoes_antes;             // tamanho do AMEM
+    int posicoes_depois;
+} EstatisticasVivacidade;
+
+// -O1, depois dos outros passes da AST: calcula as variaveis vivas em cada comando (os for
+// iteram ate o ponto fixo), remove os sets cujo valor nunca e lido, desde que a expressao
+// nao possa falhar, e da a cada variavel restante uma posicao do quadro. Variaveis cujas
+// faixas de vida nao se cruzam dividem a mesma posicao. A AST e renumerada no lugar e
+// programa->num_variaveis passa a ser o numero de posicoes.
+// Retorna, na arena, o novo endereco de cada endereco antigo (-1 se a variavel sumiu)
+int *compactar_variaveis(ProgramaAst *programa, Arena *arena, EstatisticasVivacidade *estatisticas);
+
+#endif